@@ -0,0 +1,49 @@
+#include <fmt/core.h>
+#include <sodium/core.h>
+
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "core/crypto/aead_calibration.hpp"
+
+// per packet encrypt and decrypt cost of every AEAD, usage: wato_bench_aead [iterations]
+int main(int aArgc, char** aArgv)
+{
+    if (sodium_init() == -1) {
+        fmt::println(stderr, "cannot initialize lib sodium");
+        return 1;
+    }
+
+    const std::size_t iterations = aArgc > 1 ? std::strtoull(aArgv[1], nullptr, 10) : 200000;
+    const std::size_t sizes[]    = {16, 24, 32, 64, 128, 200, 512, 1200};
+
+    std::vector<AEADTiming> timings;
+    auto                    ranking = RankAEADs(sizes, iterations, &timings);
+
+    fmt::println(
+        "{:<20} {:>6} {:>12} {:>12} {:>10}",
+        "aead",
+        "bytes",
+        "encrypt ns",
+        "decrypt ns",
+        "MB/s");
+    for (const auto& timing : timings) {
+        fmt::println(
+            "{:<20} {:>6} {:>12.1f} {:>12.1f} {:>10.1f}{}",
+            AEADFromID(timing.ID)->Name,
+            timing.MessageBytes,
+            timing.EncryptNs,
+            timing.DecryptNs,
+            timing.MBPerSec(),
+            timing.RoundTrip ? "" : " (round trip failed)");
+    }
+
+    std::string order;
+    for (AEADID id : ranking) {
+        order += order.empty() ? "" : " > ";
+        order += AEADFromID(id)->Name;
+    }
+    fmt::println("\nfastest first: {}", order);
+    return 0;
+}
@@ -0,0 +1,272 @@
+#include <fmt/core.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <optional>
+#include <queue>
+#include <random>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "core/graph.hpp"
+
+using clock_type = std::chrono::steady_clock;
+
+template <>
+struct std::hash<GraphCell> {
+    std::size_t operator()(const GraphCell& aCell) const noexcept
+    {
+        std::size_t hX = std::hash<GraphCell::size_type>{}(aCell.Location.x);
+        std::size_t hY = std::hash<GraphCell::size_type>{}(aCell.Location.y);
+        return hX ^ (hY << 1);
+    }
+};
+
+// the hash set and hash map flow field Graph used before, as the baseline
+struct HashedGraph {
+    GraphCell::size_type                     Width{0};
+    GraphCell::size_type                     Height{0};
+    std::unordered_set<GraphCell>            Obstacles{};
+    std::unordered_map<GraphCell, GraphCell> Paths{};
+    std::optional<GraphCell>                 Dest{};
+
+    bool IsInside(const GraphCell& aCell) const
+    {
+        return aCell.Location.x < Width && aCell.Location.y < Height;
+    }
+
+    std::vector<GraphCell> Neighbours(const GraphCell& aCell) const
+    {
+        std::vector<GraphCell> neighbours;
+        const GraphCell        candidates[8] = {
+            GraphCell(aCell.Location.x, aCell.Location.y - 1),
+            GraphCell(aCell.Location.x, aCell.Location.y + 1),
+            GraphCell(aCell.Location.x + 1, aCell.Location.y),
+            GraphCell(aCell.Location.x - 1, aCell.Location.y),
+            GraphCell(aCell.Location.x + 1, aCell.Location.y - 1),
+            GraphCell(aCell.Location.x - 1, aCell.Location.y - 1),
+            GraphCell(aCell.Location.x + 1, aCell.Location.y + 1),
+            GraphCell(aCell.Location.x - 1, aCell.Location.y + 1),
+        };
+        for (const GraphCell& c : candidates) {
+            if (IsInside(c) && !Obstacles.contains(c)) {
+                neighbours.emplace_back(c);
+            }
+        }
+        return neighbours;
+    }
+
+    void ComputePaths(const GraphCell& aDest)
+    {
+        Dest = aDest;
+        Paths.clear();
+        std::queue<GraphCell> cells;
+        cells.push(aDest);
+        while (!cells.empty()) {
+            GraphCell current = cells.front();
+            cells.pop();
+            for (const GraphCell& neighbour : Neighbours(current)) {
+                if (!Paths.contains(neighbour)) {
+                    cells.push(neighbour);
+                    Paths.emplace(neighbour, current);
+                }
+            }
+        }
+    }
+
+    std::optional<GraphCell> GetNextCell(const GraphCell& aFrom) const
+    {
+        if (!Paths.contains(aFrom) || aFrom == Dest) {
+            return std::nullopt;
+        }
+        return Paths.at(aFrom);
+    }
+};
+
+struct Timing {
+    double ComputeUs;
+    double LookupNs;
+};
+
+// average ComputePaths time, and GetNextCell time over every cell of the grid
+template <typename GraphType>
+static Timing measure(GraphType& aGraph, GraphCell aDest, std::size_t aIterations)
+{
+    const auto width  = GraphCell::size_type(aDest.Location.x * 2);
+    const auto height = GraphCell::size_type(aDest.Location.y * 2);
+
+    auto start = clock_type::now();
+    for (std::size_t i = 0; i < aIterations; ++i) {
+        aGraph.ComputePaths(aDest);
+    }
+    const auto compute = clock_type::now() - start;
+
+    std::size_t found = 0;
+    start             = clock_type::now();
+    for (std::size_t i = 0; i < aIterations; ++i) {
+        for (GraphCell::size_type y = 0; y < height; ++y) {
+            for (GraphCell::size_type x = 0; x < width; ++x) {
+                found += aGraph.GetNextCell(GraphCell(x, y)).has_value();
+            }
+        }
+    }
+    const auto lookup = clock_type::now() - start;
+
+    // keeps the lookups from being optimized out
+    if (found == 0) {
+        fmt::println(stderr, "no path found");
+    }
+
+    const double lookups = double(aIterations) * width * height;
+    return Timing{
+        .ComputeUs = std::chrono::duration<double, std::micro>(compute).count() / aIterations,
+        .LookupNs  = std::chrono::duration<double, std::nano>(lookup).count() / lookups,
+    };
+}
+
+// a fifth of the cells blocked, never the destination
+template <typename Func>
+static void blockRandomCells(GraphCell::size_type aSize, const GraphCell& aDest, Func&& aBlock)
+{
+    std::mt19937                       rng(42);
+    std::uniform_int_distribution<int> coin(0, 4);
+    for (GraphCell::size_type y = 0; y < aSize; ++y) {
+        for (GraphCell::size_type x = 0; x < aSize; ++x) {
+            const GraphCell cell(x, y);
+            if (coin(rng) == 0 && cell != aDest) {
+                aBlock(cell);
+            }
+        }
+    }
+}
+
+struct PlacementTiming {
+    double FullUs;
+    double PlaceUs;
+    double RemoveUs;
+};
+
+// a 3x3 tower placed then removed at random places, the paths repaired after each, against
+// computing them again
+static PlacementTiming measurePlacements(GraphCell::size_type aSize, std::size_t aPlacements)
+{
+    Graph           graph(aSize, aSize, glm::vec2(0.0f));
+    const GraphCell dest(aSize / 2, aSize / 2);
+    blockRandomCells(aSize, dest, [&graph](const GraphCell& aCell) { graph.AddObstacle(aCell); });
+    graph.ComputePaths(dest);
+
+    std::mt19937                                        rng(7);
+    std::uniform_int_distribution<GraphCell::size_type> corner(0, aSize - 3);
+
+    clock_type::duration full{};
+    clock_type::duration place{};
+    clock_type::duration removal{};
+    for (std::size_t i = 0; i < aPlacements; ++i) {
+        const GraphCell at(corner(rng), corner(rng));
+        auto            toggle = [&](bool aAdd) {
+            for (GraphCell::size_type dx = 0; dx < 3; ++dx) {
+                for (GraphCell::size_type dy = 0; dy < 3; ++dy) {
+                    const GraphCell cell(at.Location.x + dx, at.Location.y + dy);
+                    if (aAdd) {
+                        graph.AddObstacle(cell);
+                    } else {
+                        graph.RemoveObstacle(cell);
+                    }
+                }
+            }
+        };
+
+        auto start = clock_type::now();
+        toggle(true);
+        graph.UpdatePaths();
+        place += clock_type::now() - start;
+
+        start = clock_type::now();
+        graph.ComputePaths(dest);
+        full += clock_type::now() - start;
+
+        start = clock_type::now();
+        toggle(false);
+        graph.UpdatePaths();
+        removal += clock_type::now() - start;
+    }
+
+    auto perPlacement = [aPlacements](clock_type::duration aTotal) {
+        return std::chrono::duration<double, std::micro>(aTotal).count() / aPlacements;
+    };
+    return PlacementTiming{
+        .FullUs   = perPlacement(full),
+        .PlaceUs  = perPlacement(place),
+        .RemoveUs = perPlacement(removal),
+    };
+}
+
+// ComputePaths and GetNextCell cost of the flat Graph against the hashed one it replaced, then
+// the cost of a tower placement repaired incrementally, usage: wato_bench_graph [iterations]
+int main(int aArgc, char** aArgv)
+{
+    const std::size_t          iterations = aArgc > 1 ? std::strtoull(aArgv[1], nullptr, 10) : 20;
+    const GraphCell::size_type sizes[]    = {60, 600};
+    const GraphCell::size_type towered[]  = {60, 150, 300, 600};
+
+    fmt::println(
+        "{:<8} {:>8} {:>14} {:>14} {:>12} {:>12}",
+        "grid",
+        "graph",
+        "compute us",
+        "lookup ns",
+        "compute x",
+        "lookup x");
+
+    for (const GraphCell::size_type size : sizes) {
+        Graph       flat(size, size, glm::vec2(0.0f));
+        HashedGraph hashed{.Width = size, .Height = size};
+
+        // the same cells blocked for both
+        const GraphCell dest(size / 2, size / 2);
+        blockRandomCells(size, dest, [&](const GraphCell& aCell) {
+            flat.AddObstacle(aCell);
+            hashed.Obstacles.insert(aCell);
+        });
+
+        const std::size_t runs     = size > 100 ? iterations : iterations * 100;
+        const Timing      before   = measure(hashed, dest, runs);
+        const Timing      after    = measure(flat, dest, runs);
+        const auto        gridName = fmt::format("{}x{}", size, size);
+
+        fmt::println(
+            "{:<8} {:>8} {:>14.1f} {:>14.2f}",
+            gridName,
+            "hashed",
+            before.ComputeUs,
+            before.LookupNs);
+        fmt::println(
+            "{:<8} {:>8} {:>14.1f} {:>14.2f} {:>12.1f} {:>12.1f}",
+            gridName,
+            "flat",
+            after.ComputeUs,
+            after.LookupNs,
+            before.ComputeUs / after.ComputeUs,
+            before.LookupNs / after.LookupNs);
+    }
+
+    fmt::println(
+        "\n{:<8} {:>14} {:>14} {:>14} {:>12}",
+        "grid",
+        "recompute us",
+        "place us",
+        "remove us",
+        "place x");
+    for (const GraphCell::size_type size : towered) {
+        const PlacementTiming timing = measurePlacements(size, iterations * 10);
+        fmt::println(
+            "{:<8} {:>14.1f} {:>14.1f} {:>14.1f} {:>12.1f}",
+            fmt::format("{}x{}", size, size),
+            timing.FullUs,
+            timing.PlaceUs,
+            timing.RemoveUs,
+            timing.FullUs / timing.PlaceUs);
+    }
+    return 0;
+}
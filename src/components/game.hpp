@@ -1,5 +1,8 @@
 #pragma once
 
+#include <optional>
+#include <unordered_map>
+
 #include "core/types.hpp"
 
 struct GameInstance {
@@ -8,4 +11,31 @@ struct GameInstance {
     std::uint32_t  Tick;
     bool           IsOver = false;
     std::string    Record{};
+    // client: oldest tick whose actions the server has not acknowledged, resent until it does
+    std::uint32_t  UnackedInputTick{0};
+    // client: newest snapshot decoded, acknowledged to the server with the inputs
+    std::optional<std::uint32_t> LastSnapshot{};
+    // client: the server's replies reflect the inputs before this tick, later ones are predicted
+    std::uint32_t                AppliedInputTick{0};
+    // every participant simulates the game from the actions, the server replicates no entity
+    bool                         Lockstep{false};
+    // client, lockstep games: first tick its state hash disagreed with the server's
+    std::optional<std::uint32_t> Desync{};
+};
+
+// server: first input tick per player not received yet, repeated older ticks are dropped, and
+// first one the ServerActionSystem has not applied yet, the gold updates reflect the ticks before
+struct ClientInputTicks {
+    std::unordered_map<PlayerID, std::uint32_t> Next;
+    std::unordered_map<PlayerID, std::uint32_t> Applied;
+};
+
+// server: newest snapshot tick each player acknowledged, baseline of its next delta
+struct SnapshotAcks {
+    std::unordered_map<PlayerID, std::uint32_t> Acked;
+};
+
+// server, lockstep games: first diverging tick each player reported
+struct DesyncReports {
+    std::unordered_map<PlayerID, std::uint32_t> Ticks;
 };
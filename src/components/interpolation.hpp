@@ -0,0 +1,114 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <glm/common.hpp>
+#include <glm/ext/vector_float3.hpp>
+#include <optional>
+
+/**
+ * @brief Client: last positions the server replicated for an entity, by server tick
+ */
+struct InterpolationBuffer {
+    struct Sample {
+        std::uint32_t Tick{0};
+        glm::vec3     Position{0.0f};
+    };
+
+    static constexpr std::size_t kCapacity = 8;
+
+    std::array<Sample, kCapacity> Samples{};
+    std::size_t                   Next{0};
+    std::size_t                   Count{0};
+
+    // samples come in tick order, a late one is dropped
+    void Push(std::uint32_t aTick, const glm::vec3& aPosition)
+    {
+        if (Count > 0 && aTick <= newest().Tick) {
+            return;
+        }
+        Samples[Next] = Sample{.Tick = aTick, .Position = aPosition};
+        Next          = (Next + 1) % kCapacity;
+        Count         = std::min(Count + 1, kCapacity);
+    }
+
+    // position at aTick, held at the oldest and newest samples rather than extrapolated
+    [[nodiscard]] std::optional<glm::vec3> At(float aTick) const
+    {
+        if (Count == 0) {
+            return std::nullopt;
+        }
+
+        const Sample* before = &at(0);
+        if (aTick <= float(before->Tick)) {
+            return before->Position;
+        }
+        for (std::size_t idx = 1; idx < Count; ++idx) {
+            const Sample& after = at(idx);
+            if (aTick <= float(after.Tick)) {
+                const float span = float(after.Tick - before->Tick);
+                const float t    = (aTick - float(before->Tick)) / span;
+                return glm::mix(before->Position, after.Position, t);
+            }
+            before = &after;
+        }
+        return before->Position;
+    }
+
+   private:
+    // aIdx-th sample from the oldest
+    [[nodiscard]] const Sample& at(std::size_t aIdx) const
+    {
+        return Samples[(Next + kCapacity - Count + aIdx) % kCapacity];
+    }
+    [[nodiscard]] const Sample& newest() const { return at(Count - 1); }
+};
+
+/**
+ * @brief Client: server tick replicated entities are rendered at, in the registry context
+ *
+ * Runs kDelaySnapshots snapshot intervals behind the newest snapshot so there is usually a
+ * sample on each side to interpolate between, even with one snapshot lost. Advanced with the
+ * frame time and eased towards that target as snapshots come in.
+ */
+struct InterpolationClock {
+    static constexpr float kDelaySnapshots = 2.0f;
+    // further off than this, in ticks, the clock jumps instead of easing
+    static constexpr float kResyncTicks = 30.0f;
+    static constexpr float kEasing      = 0.1f;
+
+    float         Tick{0.0f};
+    std::uint32_t Newest{0};
+    // ticks between the last two snapshots
+    std::uint32_t Interval{1};
+    bool          Started{false};
+
+    void OnSnapshot(std::uint32_t aTick)
+    {
+        if (Started && aTick <= Newest) {
+            return;
+        }
+        // a long gap is an outage, not the send rate
+        if (Started && float(aTick - Newest) <= kResyncTicks) {
+            Interval = aTick - Newest;
+        }
+        Newest = aTick;
+
+        const float target = float(aTick) - kDelaySnapshots * float(Interval);
+        if (!Started || glm::abs(target - Tick) > kResyncTicks) {
+            Tick    = target;
+            Started = true;
+        } else {
+            Tick += (target - Tick) * kEasing;
+        }
+    }
+
+    void Advance(float aTicks)
+    {
+        if (Started) {
+            Tick = std::min(Tick + aTicks, float(Newest));
+        }
+    }
+};
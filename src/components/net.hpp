@@ -1,3 +1,14 @@
 #pragma once
 
+#include <cstdint>
 #include <entt/entity/entity.hpp>
+
+/**
+ * @brief Client: entity shown ahead of the server for an own action of that input tick
+ *
+ * Replaced by the replicated entity when it comes, dropped when the server's replies show it
+ * applied the inputs of that tick without creating it.
+ */
+struct Predicted {
+    std::uint32_t Tick;
+};
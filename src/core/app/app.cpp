@@ -18,7 +18,18 @@
 #include "core/physics/physics.hpp"
 #include "core/physics/physics_event_listener.hpp"
 #include "core/state.hpp"
+#include "core/state_hash.hpp"
 #include "input/action.hpp"
+#include "systems/action.hpp"
+#include "systems/ai.hpp"
+#include "systems/collision.hpp"
+#include "systems/economy.hpp"
+#include "systems/health.hpp"
+#include "systems/physics.hpp"
+#include "systems/projectile.hpp"
+#include "systems/rigid_bodies_update.hpp"
+#include "systems/tower_attack.hpp"
+#include "systems/tower_built.hpp"
 
 using namespace entt::literals;
 
@@ -56,11 +67,33 @@ void Application::StartGameInstance(Registry& aRegistry, const GameInstanceID aG
     SetupObservers(aRegistry);
 }
 
+void Application::RegisterSimulationSystems(FixedSystemExecutor& aExecutor)
+{
+    using namespace std::chrono_literals;
+
+    // in reversed order, entt::scheduler executes processes starting from the end
+    aExecutor.Register<HealthSystem>();
+    aExecutor.Register<EconomySystem>(mGameplayDef.Economy.RedistributionInterval * 1s);
+    aExecutor.Register<CollisionSystem>();
+    aExecutor.Register<PhysicsSystem>();
+    aExecutor.Register<TowerBuiltSystem>();
+    aExecutor.Register<RigidBodiesUpdateSystem>();
+    aExecutor.Register<ProjectileSystem>();
+    aExecutor.Register<TowerAttackSystem>();
+    aExecutor.Register<AiSystem>();
+    aExecutor.Register<ServerActionSystem>();
+}
+
 void Application::StopGameInstance(Registry& aRegistry)
 {
     aRegistry.ctx().erase<Physics>();
     aRegistry.ctx().erase<ActionContextStack>();
     aRegistry.ctx().erase<GameStateBuffer>();
+    aRegistry.ctx().erase<LockstepTurns>();
+    if (auto* hash = aRegistry.ctx().find<StateHash>()) {
+        hash->Unwatch(aRegistry);
+    }
+    aRegistry.ctx().erase<StateHash>();
     aRegistry.ctx().erase<GameInstance>();
 }
 
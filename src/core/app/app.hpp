@@ -57,6 +57,9 @@ class Application
 
     void SetupObservers(Registry& aRegistry);
 
+    // gameplay systems, in the order the server runs them, and lockstep clients too
+    void RegisterSimulationSystems(FixedSystemExecutor& aExecutor);
+
     Options     mOptions;
     GameplayDef mGameplayDef;
 
@@ -65,6 +68,9 @@ class Application
     FrameSystemExecutor mMenuExecutor;
     FrameSystemExecutor mEndGameExecutor;
 
+    // flow field repairs, apart from the executor Run() gets: network loops keep its workers busy
+    tf::Executor mFlowFieldExecutor{1};
+
     std::atomic_bool mRunning;
 
     Logger mLogger;
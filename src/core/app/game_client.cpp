@@ -1,31 +1,40 @@
 #include "core/app/game_client.hpp"
 
 #include <bx/bx.h>
-#include <sodium/runtime.h>
 #include <spdlog/spdlog.h>
 
+#include <algorithm>
 #include <chrono>
 #include <entt/core/fwd.hpp>
-#include <entt/signal/dispatcher.hpp>
 #include <memory>
 #include <span>
 
+#include "components/animator.hpp"
+#include "components/creep.hpp"
 #include "components/game.hpp"
 #include "components/health.hpp"
 #include "components/imgui.hpp"
+#include "components/model_rotation_offset.hpp"
 #include "components/player.hpp"
+#include "components/projectile.hpp"
 #include "components/rigid_body.hpp"
+#include "components/scene_object.hpp"
+#include "components/tower.hpp"
 #include "components/transform3d.hpp"
 #include "core/crypto/key.hpp"
+#include "core/flow_field_jobs.hpp"
 #include "core/gameplay_definitions.hpp"
 #include "core/graph.hpp"
 #include "core/menu/menu.hpp"
 #include "core/net/enet_client.hpp"
+#include "core/net/entity_sync_map.hpp"
 #include "core/net/net.hpp"
 #include "core/net/network_events.hpp"
 #include "core/net/pocketbase.hpp"
 #include "core/physics/physics.hpp"
 #include "core/snapshot.hpp"
+#include "core/state.hpp"
+#include "core/state_hash.hpp"
 #include "core/sys/log.hpp"
 #include "core/types.hpp"
 #include "core/window.hpp"
@@ -37,6 +46,7 @@
 #include "systems/action.hpp"
 #include "systems/animation.hpp"
 #include "systems/input.hpp"
+#include "systems/interpolation.hpp"
 #include "systems/network_response.hpp"
 #include "systems/physics.hpp"
 #include "systems/render.hpp"
@@ -62,6 +72,9 @@ void GameClient::Init()
     window.Init();
     renderer.Init(window);
     netClient.Init();
+    if (const LinkConditions link = mOptions.Link(); link.Active()) {
+        netClient.SetLinkConditioner(link, mOptions.LinkSeed());
+    }
 
     // Register frame-time systems (variable delta)
     // in reversed order, entt::scheduler executes processes starting from the end
@@ -70,6 +83,7 @@ void GameClient::Init()
 #endif
     mFrameExecutor.Register<RenderSystem>();
     mFrameExecutor.Register<RenderImguiSystem>();
+    mFrameExecutor.Register<InterpolationSystem>();
     mFrameExecutor.Register<SimulationSystem>();
     mFrameExecutor.Register<CameraSystem>();
     mFrameExecutor.Register<AnimationSystem>();
@@ -151,6 +165,9 @@ int GameClient::Run(tf::Executor& aExecutor)
 void GameClient::networkThread()
 {
     auto& netClient = GetSingletonComponent<ENetClient&>(mRegistry);
+
+    // reused for every request, the batch copies the bytes out
+    BitOutputArchive archive;
     while (netClient.Running()) {
         if (mDiscTimerStart) {
             if (clock_type::now() - *mDiscTimerStart > 3s) {
@@ -161,12 +178,16 @@ void GameClient::networkThread()
         netClient.ConsumeNetworkRequests([&](NetworkRequest* aEvent) {
             if (aEvent->Type == PacketType::Auth) {
                 netClient.ResetSession();
+                if (auto* auth = std::get_if<AuthRequest>(&aEvent->Payload)) {
+                    auth->PublicKey = netClient.RawPublicKey();
+                }
             }
 
-            BitOutputArchive archive;
+            archive.Clear();
             aEvent->Archive(archive);
-            netClient.Send(archive.Bytes());
+            netClient.Send(archive.Bytes(), DeliveryFor(aEvent->Type));
         });
+        netClient.FlushPending();
         netClient.Poll();
     }
 }
@@ -252,14 +273,63 @@ void GameClient::prepareGridPreview(const glm::vec2& aOffset)
         std::span<const uint8_t>(graph.GridLayout().data(), graph.Width() * graph.Height()));
 }
 
+// lockstep: simulated entities get the looks NetworkResponseSystem gives replicated ones
+static void dressTower(Registry& aRegistry, entt::entity aTower)
+{
+    const auto& def = GetTowerDef(aRegistry, aRegistry.get<Tower>(aTower).Type);
+    aRegistry.emplace<SceneObject>(aTower, def.Model.Object);
+}
+
+static void dressCreep(Registry& aRegistry, entt::entity aCreep)
+{
+    const auto& def = GetCreepDef(aRegistry, aRegistry.get<Creep>(aCreep).Type);
+    aRegistry.emplace<ModelRotationOffset>(aCreep, aRegistry.get<Transform3D>(aCreep).Orientation);
+    aRegistry.emplace<SceneObject>(aCreep, def.Model.Object);
+    aRegistry.emplace<ImguiDrawable>(aCreep, def.Model.Object.Name, true);
+    aRegistry.emplace<Animator>(aCreep, def.Model.Animation);
+}
+
+static void dressProjectile(Registry& aRegistry, entt::entity aProjectile)
+{
+    aRegistry.emplace<ModelRotationOffset>(
+        aProjectile,
+        glm::angleAxis(glm::radians(180.0f), glm::vec3(0, 1, 0)));
+    aRegistry.emplace<SceneObject>(aProjectile, "arrow"_hs);
+}
+
 void GameClient::StartGameInstance(Registry& aRegistry, const NewGameResponse& aGame)
 {
     Application::StartGameInstance(aRegistry, aGame.GameID);
+    GetSingletonComponent<GameInstance&>(aRegistry).Lockstep = aGame.Lockstep;
     LoadResources(aRegistry);
 
     auto&     syncMap = GetSingletonComponent<EntitySyncMap>(aRegistry);
     glm::vec3 localPlayerPos{2.0f, 0.004f, 2.0f};
 
+    // a lockstep client runs the server simulation, starting from the same state
+    if (aGame.Lockstep) {
+        aRegistry.ctx().insert_or_assign(PlayerGraphMap{});
+        aRegistry.ctx().insert_or_assign(FlowFieldJobs{&mFlowFieldExecutor});
+        aRegistry.ctx().insert_or_assign(TaggedActionsType{});
+        aRegistry.ctx().insert_or_assign(LockstepTurns{});
+        aRegistry.ctx().insert_or_assign("ranking"_hs, std::vector<PlayerID>{});
+        aRegistry.group<Player>(entt::get<Health>, entt::exclude<Eliminated>);
+        aRegistry.on_construct<Tower>().connect<&dressTower>();
+        aRegistry.on_construct<Creep>().connect<&dressCreep>();
+        aRegistry.on_construct<Projectile>().connect<&dressProjectile>();
+        aRegistry.ctx().emplace<StateHash>().Watch(aRegistry);
+    } else {
+        aRegistry.ctx().erase<PlayerGraphMap>();
+        aRegistry.ctx().erase<FlowFieldJobs>();
+        aRegistry.ctx().erase<LockstepTurns>();
+        if (auto* hash = aRegistry.ctx().find<StateHash>()) {
+            hash->Unwatch(aRegistry);
+        }
+        aRegistry.on_construct<Tower>().disconnect<&dressTower>();
+        aRegistry.on_construct<Creep>().disconnect<&dressCreep>();
+        aRegistry.on_construct<Projectile>().disconnect<&dressProjectile>();
+    }
+
     for (uint8_t idx = 0; idx < aGame.Players.size(); ++idx) {
         uint8_t sender = idx == 0 ? uint8_t(aGame.Players.size()) - 1 : idx - 1;
 
@@ -289,8 +359,10 @@ void GameClient::StartGameInstance(Registry& aRegistry, const NewGameResponse& a
                 .Params =
                     ColliderParams{
                         .CollisionCategoryBits = Category::Base,
-                        .CollideWithMaskBits =
-                            CollidesWith(PlayerEntitiesCategory(sender), Category::Tower),
+                        .CollideWithMaskBits   = CollidesWith(
+                            PlayerEntitiesCategory(sender),
+                            Category::Terrain,
+                            Category::Tower),
                         .IsTrigger = true,
                         .ShapeParams =
                             BoxShapeParams{
@@ -300,7 +372,16 @@ void GameClient::StartGameInstance(Registry& aRegistry, const NewGameResponse& a
             });
         SpawnTerrain(aRegistry, player, p.MapSize, p.MapWorldOffset);
 
-        syncMap.insert_or_assign(p.ServerEntity, player);
+        if (aGame.Lockstep) {
+            auto [it, inserted] = GetSingletonComponent<PlayerGraphMap>(aRegistry).try_emplace(
+                p.ID,
+                p.MapSize.x * GraphCell::kCellsPerAxis,
+                p.MapSize.y * GraphCell::kCellsPerAxis,
+                p.MapWorldOffset);
+            it->second.ComputePaths(p.Position);
+        }
+
+        syncMap.Insert(p.ServerEntity, player);
         WATO_INFO(
             aRegistry,
             "created player {} (server {}) for player ID {}",
@@ -332,9 +413,14 @@ void GameClient::StartGameInstance(Registry& aRegistry, const NewGameResponse& a
     auto& fixedExec = GetSingletonComponent<FixedSystemExecutor>(aRegistry);
 
     fixedExec.Register<NetworkSyncSystem<ENetClient>>();
-    fixedExec.Register<PhysicsSystem>();
-    fixedExec.Register<RigidBodiesUpdateSystem>();
-    fixedExec.Register<TowerBuiltSystem>();
+    if (aGame.Lockstep) {
+        RegisterSimulationSystems(fixedExec);
+        fixedExec.Register<LockstepTurnSystem>();
+    } else {
+        fixedExec.Register<PhysicsSystem>();
+        fixedExec.Register<RigidBodiesUpdateSystem>();
+        fixedExec.Register<TowerBuiltSystem>();
+    }
     fixedExec.Register<DeterministicActionSystem>();
     fixedExec.Register<NetworkResponseSystem>();
 }
@@ -344,25 +430,28 @@ void GameClient::SendAuthRequest()
     auto& pbase     = mRegistry.ctx().get<PocketBaseClient>();
     auto& netClient = mRegistry.ctx().get<ENetClient&>();
 
-    auto* req = new NetworkRequest{
+    bool queued = netClient.EnqueueRequest(NetworkRequest{
         .Type     = PacketType::Auth,
         .PlayerID = 0,
         .Tick     = 0,
         .Payload =
             AuthRequest{
                 .Token     = pbase.Token,
-                .HasAESNI  = sodium_runtime_has_aesni() != 0,
-                .PublicKey = netClient.RawPublicKey()},
-    };
-    netClient.EnqueueRequest(req);
+                .Ciphers   = SupportedAEADs(),
+                // the network thread sets the public key of the new session
+                .PublicKey = {}},
+    });
+    if (!queued) {
+        WATO_ERR(mRegistry, "request channel full, could not send auth request");
+    }
 }
 
 void GameClient::consumeNetworkResponses()
 {
     struct NetworkResponseVisitor {
-        Registry*         Reg;
-        entt::dispatcher* Dispatcher;
-        GameClient*       Client;
+        Registry*             Reg;
+        NetworkResponseQueue* Responses;
+        GameClient*           Client;
 
         void operator()(const ConnectedResponse&) const
         {
@@ -384,6 +473,10 @@ void GameClient::consumeNetworkResponses()
                 WATO_DBG(*Reg, "got server public key = {}", r->publicKey);
                 Reg->ctx().get<ENetClient&>().SetServerPK(KeyFromB64<32>(r->publicKey));
                 Client->SendAuthRequest();
+            } else if (aResp.Error == ServerError::NoCommonCipher) {
+                WATO_ERR(*Reg, "server supports none of our ciphers");
+            } else if (aResp.Error == ServerError::SessionKeys) {
+                WATO_ERR(*Reg, "server could not derive session keys from our public key");
             }
         }
 
@@ -396,25 +489,27 @@ void GameClient::consumeNetworkResponses()
 
         void operator()(SyncPayload& aResp) const
         {
-            Dispatcher->enqueue<SyncPayloadEvent>(
-                SyncPayloadEvent{.Reg = Reg, .Payload = std::move(aResp)});
+            Responses->Syncs.push_back(std::move(aResp));
         }
 
         void operator()(const RigidBodyUpdateResponse& aUpdate) const
         {
-            Dispatcher->enqueue<RigidBodyUpdateEvent>(
-                RigidBodyUpdateEvent{.Reg = Reg, .Response = aUpdate});
+            Responses->Bodies.push_back(aUpdate);
         }
 
         void operator()(const HealthUpdateResponse& aUpdate) const
         {
-            Dispatcher->enqueue<HealthUpdateEvent>(
-                HealthUpdateEvent{.Reg = Reg, .Response = aUpdate});
+            Responses->Health.push_back(aUpdate);
+        }
+
+        void operator()(SnapshotResponse& aResp) const
+        {
+            Responses->Snapshots.push_back(std::move(aResp));
         }
 
         void operator()(const GoldUpdateResponse& aResp) const
         {
-            Dispatcher->enqueue(GoldUpdateEvent{.Reg = Reg, .Response = aResp});
+            Responses->Gold.push_back(aResp);
         }
 
         void operator()(const CommonIncomeUpdateResponse& aResp) const
@@ -442,19 +537,55 @@ void GameClient::consumeNetworkResponses()
         void operator()(const AuthResponse& aResp) const
         {
             if (aResp.Success) {
-                WATO_INFO(*Reg, "authenticated as player {}", aResp.ID);
+                WATO_INFO(
+                    *Reg,
+                    "authenticated as player {}, using {}",
+                    aResp.ID,
+                    AEADFromID(aResp.Cipher)->Name);
             } else {
                 WATO_ERR(*Reg, "authentication failed");
             }
         }
 
+        void operator()(const InputAckResponse& aResp) const
+        {
+            // never move the input window back
+            if (auto* instance = Reg->ctx().find<GameInstance>()) {
+                instance->UnackedInputTick = std::max(instance->UnackedInputTick, aResp.NextTick);
+            }
+        }
+
+        void operator()(const NetworkStatsResponse& aResp) const
+        {
+            Reg->ctx().insert_or_assign(aResp);
+        }
+
+        void operator()(LockstepTurn& aTurn) const
+        {
+            auto* turns = Reg->ctx().find<LockstepTurns>();
+            if (!turns) {
+                return;
+            }
+            const uint32_t tick = aTurn.Tick;
+            if (!turns->Push(std::move(aTurn))) {
+                WATO_ERR(
+                    *Reg,
+                    "lockstep turn {} out of order, expected {}",
+                    tick,
+                    turns->Received + 1);
+            }
+        }
+
+        // consumed by the network thread, never enqueued
+        void operator()(const HandshakeCookieResponse&) const {}
+
         void operator()(std::monostate) const {}
     };
 
     auto& netClient  = GetSingletonComponent<ENetClient>(mRegistry);
-    auto& dispatcher = mRegistry.ctx().get<entt::dispatcher>("net_dispatcher"_hs);
+    auto& responses = GetSingletonComponent<NetworkResponseQueue>(mRegistry);
 
-    NetworkResponseVisitor visitor{&mRegistry, &dispatcher, this};
+    NetworkResponseVisitor visitor{&mRegistry, &responses, this};
 
     netClient.ConsumeNetworkResponses(
         [&](NetworkResponse* aEvent) { std::visit(visitor, aEvent->Payload); });
@@ -10,7 +10,9 @@
 #include "core/menu/imgui_menu.hpp"
 #include "core/menu/menu.hpp"
 #include "core/net/enet_client.hpp"
+#include "core/net/entity_sync_map.hpp"
 #include "core/net/net.hpp"
+#include "core/net/network_events.hpp"
 #include "core/net/pocketbase.hpp"
 #include "core/physics/physics_event_listener.hpp"
 #include "imgui_hud.hpp"
@@ -111,10 +113,8 @@ class GameClient : public Application
         mRegistry.ctx().emplace<ShaderCache>();
         mRegistry.ctx().emplace<ModelCache>();
         mRegistry.ctx().emplace<EntitySyncMap>();
+        mRegistry.ctx().emplace<NetworkResponseQueue>();
         mRegistry.ctx().emplace<PocketBaseClient>(mOptions.BackendAddr(), mLogger);
-
-        // Create dispatcher for network events
-        mRegistry.ctx().emplace_as<entt::dispatcher>("net_dispatcher"_hs);
     }
     void networkThread();
     void consumeNetworkResponses();
@@ -5,6 +5,7 @@
 #include <sodium/runtime.h>
 #include <spdlog/spdlog.h>
 
+#include <algorithm>
 #include <glaze/glaze.hpp>
 #include <thread>
 #include <utility>
@@ -14,27 +15,21 @@
 #include "components/player.hpp"
 #include "components/spawner.hpp"
 #include "components/transform3d.hpp"
+#include "core/flow_field_jobs.hpp"
+#include "core/net/interest.hpp"
 #include "core/net/net.hpp"
 #include "core/net/pocketbase.hpp"
 #include "core/physics/physics.hpp"
 #include "core/snapshot.hpp"
+#include "core/state_hash.hpp"
 #include "core/sys/log.hpp"
 #include "core/sys/signal.hpp"
 #include "core/types.hpp"
 #include "input/action.hpp"
 #include "registry/registry.hpp"
-#include "systems/action.hpp"
-#include "systems/ai.hpp"
-#include "systems/collision.hpp"
-#include "systems/economy.hpp"
-#include "systems/health.hpp"
 #include "systems/physics.hpp"
-#include "systems/projectile.hpp"
-#include "systems/rigid_bodies_update.hpp"
 #include "systems/sync.hpp"
 #include "systems/system.hpp"
-#include "systems/tower_attack.hpp"
-#include "systems/tower_built.hpp"
 
 void GameServer::Init()
 {
@@ -97,29 +92,26 @@ std::vector<PlayerInitData> GameServer::StartGameInstance(
     std::vector<PlayerID> aPlayerIDs)
 {
     Application::StartGameInstance(aRegistry, aGameID);
+    GetSingletonComponent<GameInstance&>(aRegistry).Lockstep = mOptions.Lockstep();
 
     aRegistry.ctx().emplace<PlayerGraphMap>();
+    aRegistry.ctx().emplace<FlowFieldJobs>(&mFlowFieldExecutor);
     // aRegistry.ctx().emplace<ActionContextStack>().back().State = ActionContext::State::Server;
     aRegistry.ctx().emplace<PocketBaseClient&>(mPBClient);
     // init groups when registry is empty to get the most performance
     aRegistry.group<Player>(entt::get<Health>, entt::exclude<Eliminated>);
+    // lockstep clients check their state against it
+    if (mOptions.Lockstep()) {
+        aRegistry.ctx().emplace<StateHash>().Watch(aRegistry);
+    }
 
     auto playerInitData = spawnPlayers(aRegistry, aPlayerIDs);
 
     auto& fixedExec = GetSingletonComponent<FixedSystemExecutor>(aRegistry);
 
-    using namespace std::chrono_literals;
-    fixedExec.Register<NetworkSyncSystem<ENetServer>>();
-    fixedExec.Register<HealthSystem>();
-    fixedExec.Register<EconomySystem>(mGameplayDef.Economy.RedistributionInterval * 1s);
-    fixedExec.Register<CollisionSystem>();
-    fixedExec.Register<PhysicsSystem>();
-    fixedExec.Register<TowerBuiltSystem>();
-    fixedExec.Register<RigidBodiesUpdateSystem>();
-    fixedExec.Register<ProjectileSystem>();
-    fixedExec.Register<TowerAttackSystem>();
-    fixedExec.Register<AiSystem>();
-    fixedExec.Register<ServerActionSystem>();
+    fixedExec.Register<NetworkSyncSystem<ENetServer>>(
+        GameTick(GameTick::period::den / mOptions.SnapshotRate()));
+    RegisterSimulationSystems(fixedExec);
 
     return playerInitData;
 }
@@ -128,24 +120,19 @@ void GameServer::ConsumeNetworkRequests()
 {
     struct RequestVisitor {
         std::unordered_map<GameInstanceID, Registry>* GameInstances;
+        ENetServer*                                   Server;
         spdlog::logger*                               Log;
         NetworkRequest*                               Event;
 
         void operator()(const SyncPayload& aReq) const
         {
-            if (!GameInstances->contains(aReq.GameID)) {
-                Log->warn("got event for non existing game {}", aReq.GameID);
-                return;
-            }
-
-            Registry& registry = (*GameInstances)[aReq.GameID];
-            if (IsPlayerEliminated(registry, Event->PlayerID)) {
-                Log->debug("got event for eliminated player {}", Event->PlayerID);
+            Registry* registry = playerRegistry(aReq.GameID);
+            if (registry == nullptr) {
                 return;
             }
 
             const ActionsType& incoming      = aReq.State.Actions;
-            auto&              taggedActions = GetSingletonComponent<TaggedActionsType>(registry);
+            auto&              taggedActions = GetSingletonComponent<TaggedActionsType>(*registry);
 
             Log->debug(
                 "got {} actions from player {}: {}",
@@ -157,12 +144,88 @@ void GameServer::ConsumeNetworkRequests()
             }
         }
 
+        void operator()(const InputPayload& aReq) const
+        {
+            Registry* registry = playerRegistry(aReq.GameID);
+            if (registry == nullptr) {
+                return;
+            }
+
+            auto& taggedActions = GetSingletonComponent<TaggedActionsType>(*registry);
+            auto& next          = registry->ctx().emplace<ClientInputTicks>().Next[Event->PlayerID];
+
+            // inputs are sorted by tick, those below next were applied from an earlier packet
+            for (const auto& input : aReq.Inputs) {
+                if (input.Tick < next) {
+                    continue;
+                }
+
+                Log->debug(
+                    "got {} actions from player {} for tick {}: {}",
+                    input.Actions.size(),
+                    Event->PlayerID,
+                    input.Tick,
+                    input.Actions);
+                for (const auto& action : input.Actions) {
+                    taggedActions.push_back({Event->PlayerID, action});
+                }
+                next = input.Tick + 1;
+            }
+
+            // unreliable snapshots and their acks may be reordered, keep the newest
+            if (aReq.SnapshotAck) {
+                auto& acked = registry->ctx().emplace<SnapshotAcks>().Acked[Event->PlayerID];
+                acked       = std::max(acked, *aReq.SnapshotAck);
+            }
+            if (aReq.View) {
+                registry->ctx().emplace<InterestMap>().Players[Event->PlayerID].Camera =
+                    *aReq.View;
+            }
+            // repeated with every input, reported once
+            if (aReq.Desync
+                && registry->ctx()
+                       .emplace<DesyncReports>()
+                       .Ticks.try_emplace(Event->PlayerID, *aReq.Desync)
+                       .second) {
+                Log->error(
+                    "player {} diverged from game {} at tick {}",
+                    Event->PlayerID,
+                    aReq.GameID,
+                    *aReq.Desync);
+            }
+
+            // ack even when nothing was new, the previous ack may have been lost
+            Server->SendResponse(
+                Event->PlayerID,
+                PacketType::InputAck,
+                registry->ctx().get<GameInstance>().Tick,
+                InputAckResponse{.NextTick = next});
+        }
+
         void operator()(const AuthRequest&) const {}
         void operator()(const std::monostate&) const {}
+
+       private:
+        Registry* playerRegistry(GameInstanceID aGameID) const
+        {
+            if (!GameInstances->contains(aGameID)) {
+                Log->warn("got event for non existing game {}", aGameID);
+                return nullptr;
+            }
+
+            Registry& registry = (*GameInstances)[aGameID];
+            if (IsPlayerEliminated(registry, Event->PlayerID)) {
+                Log->debug("got event for eliminated player {}", Event->PlayerID);
+                return nullptr;
+            }
+            return &registry;
+        }
     };
 
     mServer.ConsumeNetworkRequests([&](NetworkRequest* aEvent) {
-        std::visit(RequestVisitor{&mGameInstances, mLogger.get(), aEvent}, aEvent->Payload);
+        std::visit(
+            RequestVisitor{&mGameInstances, &mServer, mLogger.get(), aEvent},
+            aEvent->Payload);
     });
 
     mPBGameChan.Drain([&](PBSSE<GameRecord>* aEvent) {
@@ -193,16 +256,17 @@ void GameServer::ConsumeNetworkRequests()
 
             for (const auto& p : playerInitData) {
                 mLogger->debug("Sending network response for game {}, player {}", *gameID, p.ID);
-                mServer.EnqueueResponse(new NetworkResponse{
-                    .Type     = PacketType::NewGame,
-                    .PlayerID = p.ID,
-                    .Tick     = 0,
-                    .Payload  = NewGameResponse{
-                         .GameID         = *gameID,
-                         .YourPlayerID   = p.ID,
-                         .StartingIncome = mGameplayDef.Economy.StartingIncome,
-                         .Players        = playerInitData,
-                    }});
+                mServer.SendResponse(
+                    p.ID,
+                    PacketType::NewGame,
+                    0,
+                    NewGameResponse{
+                        .GameID         = *gameID,
+                        .YourPlayerID   = p.ID,
+                        .StartingIncome = mGameplayDef.Economy.StartingIncome,
+                        .Players        = playerInitData,
+                        .Lockstep       = mOptions.Lockstep(),
+                    });
             }
         }
     });
@@ -217,25 +281,26 @@ int GameServer::Run(tf::Executor& aExecutor)
     auto prevTime = clock_type::now();
     mRunning      = true;
 
-    aExecutor.silent_async([&]() {
-        while (mRunning) {
-            mServer.ProcessAuthResults();
-            mServer.ConsumeNetworkResponses([&](NetworkResponse* aEvent) {
-                BitOutputArchive archive;
-                if (!aEvent->Archive(archive)) {
-                    mLogger->error("could not archive response {}", *aEvent);
-                }
+    // one network thread per shard, each owning its host and peers
+    for (std::size_t idx = 0; idx < mServer.ShardCount(); ++idx) {
+        aExecutor.silent_async([&, idx]() {
+            ENetServerShard& shard = mServer.Shard(idx);
+
+            while (mRunning) {
+                shard.ProcessAuthResults();
+                shard.ProcessRetiring();
+                shard.ProcessOutgoing();
+                // everything produced since the last service loop goes out as one packet per peer
+                shard.FlushPending();
+                shard.Poll();
+            }
+        });
+    }
 
-                mLogger->trace("sending {}", *aEvent);
-                if (!mServer.Send(aEvent->PlayerID, archive.Bytes())) {
-                    mLogger->error("player {} is not connected", aEvent->PlayerID);
-                }
-            });
-            mServer.Poll();
-        }
-    });
+    constexpr auto kTargetFrameTime   = std::chrono::duration<double>(kTimeStep);
+    constexpr auto kNetStatsLogPeriod = std::chrono::seconds(10);
 
-    constexpr auto kTargetFrameTime = std::chrono::duration<double>(kTimeStep);
+    auto lastNetStatsLog = prevTime;
 
     while (mRunning) {
         if (gShutdownRequested.load()) {
@@ -247,6 +312,11 @@ int GameServer::Run(tf::Executor& aExecutor)
         std::chrono::duration<float> dt = (t - prevTime);
         prevTime                        = t;
 
+        if (t - lastNetStatsLog >= kNetStatsLogPeriod) {
+            lastNetStatsLog = t;
+            logNetworkTotals();
+        }
+
         mPBClient.Update();
         ConsumeNetworkRequests();
         // Update each game instance independently
@@ -268,6 +338,39 @@ int GameServer::Run(tf::Executor& aExecutor)
 
 void GameServer::Stop() { mRunning = false; }
 
+void GameServer::logNetworkTotals()
+{
+    const NetTotals net = mServer.NetworkTotals();
+
+    mLogger->info(
+        "network: {} peers, in {} msgs / {} bytes, out {} msgs / {} bytes, {} retransmits, "
+        "max rtt {}ms, max loss {:.1f}%, {} channel overflows",
+        net.Peers,
+        net.PacketsIn,
+        net.BytesIn,
+        net.PacketsOut,
+        net.BytesOut,
+        net.Retransmits,
+        net.MaxRTT,
+        net.MaxPacketLoss * 100.0f,
+        net.ChannelOverflows);
+
+    const AuthTokenCache& tokens = mServer.Tokens();
+    mLogger->info(
+        "auth tokens: {} cached, {} verified by the backend, {} coalesced",
+        tokens.Hits(),
+        tokens.Misses(),
+        tokens.Coalesced());
+
+    const HandshakeDrops drops = mServer.HandshakeDropTotals();
+    mLogger->info(
+        "handshakes dropped: {} rate limited, {} bad cookie, {} too many pending, {} seal failed",
+        drops[HandshakeDrop::RateLimited],
+        drops[HandshakeDrop::BadCookie],
+        drops[HandshakeDrop::TooManyPending],
+        drops[HandshakeDrop::SealOpenFailed]);
+}
+
 std::vector<PlayerInitData> GameServer::spawnPlayers(
     Registry&                 aRegistry,
     std::span<const PlayerID> aPlayerIDs)
@@ -341,6 +444,11 @@ std::vector<PlayerInitData> GameServer::spawnPlayers(
             .MapWorldOffset = offset,
         });
 
+        aRegistry.ctx().emplace<InterestMap>().Players[id].Map = ViewRegion{
+            .Min = offset,
+            .Max = offset + glm::vec2(size),
+        };
+
         offset.x += float(size.x) + 5.0f;
     }
 
@@ -18,8 +18,16 @@ class GameServer : public Application
     explicit GameServer(char** aArgv)
         : Application("server", aArgv),
           mPBClient(mOptions.BackendAddr(), mLogger, ""),
-          mServer(mOptions.ServerAddr, mLogger, mPBClient)
+          mServer(
+              mOptions.ServerAddr,
+              mLogger,
+              mPBClient,
+              mOptions.SendBudget(),
+              mOptions.NetShards(),
+              mOptions.MaxPeers())
     {
+        mServer.SetLinkConditions(mOptions.Link(), mOptions.LinkSeed());
+        mServer.SetDecodeWorkers(mOptions.DecodeWorkers());
     }
     explicit GameServer(
         const Options&     aOptions,
@@ -27,8 +35,16 @@ class GameServer : public Application
         const std::string& aAdminPassword)
         : Application("server", aOptions),
           mPBClient(mOptions.BackendAddr(), mLogger),
-          mServer(mOptions.ServerAddr, mLogger, mPBClient)
+          mServer(
+              mOptions.ServerAddr,
+              mLogger,
+              mPBClient,
+              mOptions.SendBudget(),
+              mOptions.NetShards(),
+              mOptions.MaxPeers())
     {
+        mServer.SetLinkConditions(mOptions.Link(), mOptions.LinkSeed());
+        mServer.SetDecodeWorkers(mOptions.DecodeWorkers());
         mAdminEmail    = aAdminEmail;
         mAdminPassword = aAdminPassword;
     }
@@ -65,6 +81,8 @@ class GameServer : public Application
     std::vector<PlayerInitData> createGameInstance(
         GameInstanceID        aGameID,
         std::vector<PlayerID> aPlayerIDs);
+    // periodic server side view of the network health
+    void logNetworkTotals();
     tf::Taskflow mNetTaskflow;
 
     PocketBaseClient                             mPBClient;
@@ -1,5 +1,6 @@
 #include "core/crypto/aead.hpp"
 
+#include <sodium/crypto_aead_aegis128l.h>
 #include <sodium/crypto_aead_aegis256.h>
 #include <sodium/crypto_aead_xchacha20poly1305.h>
 
@@ -11,10 +12,27 @@ AEADHandle AEGIS256Handle()
         .KeyBytes     = crypto_aead_aegis256_KEYBYTES,
         .NonceBytes   = crypto_aead_aegis256_NPUBBYTES,
         .AuthTagBytes = crypto_aead_aegis256_ABYTES,
+        .ID           = AEADID::AEGIS256,
+        .Name         = "AEGIS-256",
     };
     return &kAEGIS256;
 }
 
+AEADHandle AEGIS128LHandle()
+{
+    // 16 bytes key: the first half of the session key
+    static const AEAD kAEGIS128L = {
+        .Encrypt      = crypto_aead_aegis128l_encrypt,
+        .Decrypt      = crypto_aead_aegis128l_decrypt,
+        .KeyBytes     = crypto_aead_aegis128l_KEYBYTES,
+        .NonceBytes   = crypto_aead_aegis128l_NPUBBYTES,
+        .AuthTagBytes = crypto_aead_aegis128l_ABYTES,
+        .ID           = AEADID::AEGIS128L,
+        .Name         = "AEGIS-128L",
+    };
+    return &kAEGIS128L;
+}
+
 AEADHandle XChaCha20Poly1305IETFHandle()
 {
     static const AEAD kXChaCha20Poly1305IETF = {
@@ -23,6 +41,28 @@ AEADHandle XChaCha20Poly1305IETFHandle()
         .KeyBytes     = crypto_aead_xchacha20poly1305_ietf_KEYBYTES,
         .NonceBytes   = crypto_aead_xchacha20poly1305_ietf_NPUBBYTES,
         .AuthTagBytes = crypto_aead_xchacha20poly1305_ietf_ABYTES,
+        .ID           = AEADID::XChaCha20Poly1305,
+        .Name         = "XChaCha20-Poly1305",
     };
     return &kXChaCha20Poly1305IETF;
 }
+
+AEADHandle AEADFromID(AEADID aID)
+{
+    switch (aID) {
+        case AEADID::XChaCha20Poly1305:
+            return XChaCha20Poly1305IETFHandle();
+        case AEADID::AEGIS256:
+            return AEGIS256Handle();
+        case AEADID::AEGIS128L:
+            return AEGIS128LHandle();
+        default:
+            return nullptr;
+    }
+}
+
+AEADMask SupportedAEADs()
+{
+    return AEADBit(AEADID::XChaCha20Poly1305) | AEADBit(AEADID::AEGIS256)
+           | AEADBit(AEADID::AEGIS128L);
+}
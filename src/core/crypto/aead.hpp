@@ -2,6 +2,22 @@
 
 #include <array>
 #include <cstddef>
+#include <cstdint>
+
+// wire identifiers, never reorder
+enum class AEADID : std::uint8_t {
+    XChaCha20Poly1305,
+    AEGIS256,
+    AEGIS128L,
+    Count,
+};
+
+// set of AEADID, one bit each
+using AEADMask = std::uint8_t;
+
+constexpr AEADMask AEADBit(AEADID aID) { return AEADMask(1U << std::uint8_t(aID)); }
+
+inline constexpr AEADMask kAllAEADs = AEADMask(AEADBit(AEADID::Count) - 1);
 
 struct AEAD {
     int (*Encrypt)(
@@ -28,9 +44,19 @@ struct AEAD {
     std::size_t KeyBytes;
     std::size_t NonceBytes;
     std::size_t AuthTagBytes;
+
+    AEADID      ID;
+    const char* Name;
 };
 
 using AEADHandle = const AEAD*;
 
 AEADHandle AEGIS256Handle();
+AEADHandle AEGIS128LHandle();
 AEADHandle XChaCha20Poly1305IETFHandle();
+
+// nullptr for an unknown identifier
+AEADHandle AEADFromID(AEADID aID);
+
+// every AEAD this build can use, libsodium falls back to software AEGIS without AES-NI
+AEADMask SupportedAEADs();
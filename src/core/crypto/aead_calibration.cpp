@@ -0,0 +1,108 @@
+#include "core/crypto/aead_calibration.hpp"
+
+#include <sodium/crypto_kx.h>
+#include <sodium/randombytes.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <utility>
+
+#include "core/crypto/session.hpp"
+
+AEADTiming MeasureAEAD(AEADHandle aAEAD, std::size_t aMessageBytes, std::size_t aIterations)
+{
+    using clock_type = std::chrono::steady_clock;
+
+    unsigned char key[crypto_kx_SESSIONKEYBYTES];
+    unsigned char nonce[MAX_NONCE_BYTES]{};
+    randombytes_buf(key, sizeof(key));
+
+    std::vector<unsigned char> plain(aMessageBytes);
+    std::vector<unsigned char> cipher(aMessageBytes + aAEAD->AuthTagBytes);
+    std::vector<unsigned char> opened(aMessageBytes);
+    randombytes_buf(plain.data(), plain.size());
+
+    unsigned long long len{};
+    const std::size_t  iterations = std::max<std::size_t>(aIterations, 1);
+
+    // counter nonces like CryptoSession, the last message is kept for the decrypt pass
+    auto start = clock_type::now();
+    for (std::size_t i = 0; i < iterations; ++i) {
+        std::memcpy(nonce, &i, sizeof(i));
+        aAEAD->Encrypt(
+            cipher.data(),
+            &len,
+            plain.data(),
+            plain.size(),
+            nullptr,
+            0,
+            nullptr,
+            nonce,
+            key);
+    }
+    const auto encrypt = clock_type::now() - start;
+
+    int failures = 0;
+    start        = clock_type::now();
+    for (std::size_t i = 0; i < iterations; ++i) {
+        failures += aAEAD->Decrypt(
+            opened.data(),
+            &len,
+            nullptr,
+            cipher.data(),
+            cipher.size(),
+            nullptr,
+            0,
+            nonce,
+            key);
+    }
+    const auto decrypt = clock_type::now() - start;
+
+    const double perMessage = 1.0 / double(iterations);
+    return AEADTiming{
+        .ID           = aAEAD->ID,
+        .MessageBytes = aMessageBytes,
+        .EncryptNs    = std::chrono::duration<double, std::nano>(encrypt).count() * perMessage,
+        .DecryptNs    = std::chrono::duration<double, std::nano>(decrypt).count() * perMessage,
+        .RoundTrip    = failures == 0,
+    };
+}
+
+std::vector<AEADID> RankAEADs(
+    std::span<const std::size_t> aSizes,
+    std::size_t                  aIterations,
+    std::vector<AEADTiming>*     aTimings)
+{
+    std::vector<std::pair<double, AEADID>> costs;
+
+    const AEADMask supported = SupportedAEADs();
+    for (std::uint8_t id = 0; id < std::uint8_t(AEADID::Count); ++id) {
+        if (!(supported & AEADBit(AEADID(id)))) {
+            continue;
+        }
+
+        double cost   = 0.0;
+        bool   usable = true;
+        for (std::size_t size : aSizes) {
+            const AEADTiming timing = MeasureAEAD(AEADFromID(AEADID(id)), size, aIterations);
+
+            cost   += timing.EncryptNs + timing.DecryptNs;
+            usable  = usable && timing.RoundTrip;
+            if (aTimings) {
+                aTimings->push_back(timing);
+            }
+        }
+        if (usable) {
+            costs.emplace_back(cost, AEADID(id));
+        }
+    }
+
+    std::ranges::sort(costs);
+
+    std::vector<AEADID> ranking;
+    for (const auto& [cost, id] : costs) {
+        ranking.push_back(id);
+    }
+    return ranking;
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+#include <span>
+#include <vector>
+
+#include "core/crypto/aead.hpp"
+
+// per message cost of one AEAD for one message size
+struct AEADTiming {
+    AEADID      ID;
+    std::size_t MessageBytes;
+    double      EncryptNs;
+    double      DecryptNs;
+    // messages opened back to the plaintext, an AEAD failing this is never picked
+    bool        RoundTrip;
+
+    [[nodiscard]] double MBPerSec() const
+    {
+        return double(MessageBytes) * 1e3 / (EncryptNs + DecryptNs) * 0.5;
+    }
+};
+
+// sizes of our typical packets, from a lone input to a full state batch
+inline constexpr std::size_t kCalibrationSizes[] = {24, 64, 200, 1200};
+
+/**
+ * @brief Time aIterations encryptions then decryptions of aMessageBytes bytes with aAEAD
+ */
+AEADTiming MeasureAEAD(AEADHandle aAEAD, std::size_t aMessageBytes, std::size_t aIterations);
+
+/**
+ * @brief Supported AEADs, fastest first over aSizes
+ *
+ * Ranks by the summed encrypt and decrypt cost of one message of each size, so that the small
+ * packets making most of the traffic weigh as much as full ones. Every measurement is appended
+ * to aTimings if given.
+ */
+std::vector<AEADID> RankAEADs(
+    std::span<const std::size_t> aSizes,
+    std::size_t                  aIterations,
+    std::vector<AEADTiming>*     aTimings = nullptr);
@@ -37,7 +37,9 @@ class CryptoKeys
     using Public = PublicKey::Key;
     using Secret = std::array<unsigned char, crypto_kx_SECRETKEYBYTES>;
 
-    CryptoKeys() { crypto_kx_keypair(mPublic.data(), mSecret.data()); }
+    CryptoKeys() { Regenerate(); }
+
+    void Regenerate() { crypto_kx_keypair(mPublic.data(), mSecret.data()); }
 
     const std::string ExportPublicKey() const
     {
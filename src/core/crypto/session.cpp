@@ -1,20 +1,100 @@
 #include "core/crypto/session.hpp"
 
-byte_view CryptoSession::Encrypt(byte_view aBytes)
+#include <sodium/crypto_generichash.h>
+#include <sodium/randombytes.h>
+#include <sodium/utils.h>
+
+CryptoSession::salt_type CryptoSession::MakeSalt()
+{
+    salt_type salt{};
+    randombytes_buf(salt.data(), salt.size());
+    return salt;
+}
+
+// BLAKE2b keyed with the key exchange session key, over the salt
+static bool saltKey(unsigned char* aKey, const CryptoSession::salt_type& aSalt)
+{
+    unsigned char salted[crypto_kx_SESSIONKEYBYTES]{};
+    const int     ret = crypto_generichash(
+        salted,
+        sizeof(salted),
+        aSalt.data(),
+        aSalt.size(),
+        aKey,
+        crypto_kx_SESSIONKEYBYTES);
+    std::memcpy(aKey, salted, sizeof(salted));
+    sodium_memzero(salted, sizeof(salted));
+    return ret == 0;
+}
+
+void CryptoSession::Init(
+    const CryptoKeys&  aSelf,
+    CryptoKeys::Public aPub,
+    AEADID             aCipher,
+    bool               aServer,
+    const salt_type&   aSalt)
 {
+    mAEAD    = AEADFromID(aCipher);
+    mOffered = 0;
+    if (aServer) {
+        mValid =
+            (crypto_kx_server_session_keys(
+                 mRX,
+                 mTX,
+                 aSelf.RawPublicKey().data(),
+                 aSelf.RawSecretKey().data(),
+                 aPub.data())
+             == 0);
+    } else {
+        mValid =
+            (crypto_kx_client_session_keys(
+                 mRX,
+                 mTX,
+                 aSelf.RawPublicKey().data(),
+                 aSelf.RawSecretKey().data(),
+                 aPub.data())
+             == 0);
+    }
+    mValid = mValid && saltKey(mRX, aSalt) && saltKey(mTX, aSalt) && mAEAD != nullptr;
+    mTXCounters.fill(0);
+    for (ReplayWindow& window : mReplay) {
+        window.Reset();
+    }
+}
+
+void CryptoSession::expandNonce(AEADHandle aAEAD, std::uint64_t aCounter, unsigned char* aNonce)
+{
+    // counter in the first bytes, zero padded up to the AEAD nonce size
+    std::memset(aNonce, 0, aAEAD->NonceBytes);
+    for (std::size_t idx = 0; idx < kCounterBytes; ++idx) {
+        aNonce[idx] = static_cast<unsigned char>(aCounter >> (8 * idx));
+    }
+}
+
+byte_view CryptoSession::Encrypt(byte_view aBytes, std::uint8_t aChannel)
+{
+    mBuffer.resize(aBytes.size() + Overhead());
+
+    return EncryptInto(aBytes, mBuffer, aChannel) ? mBuffer : byte_view{};
+}
+
+bool CryptoSession::EncryptInto(byte_view aBytes, std::span<uint8_t> aOut, std::uint8_t aChannel)
+{
+    if (aOut.size() != aBytes.size() + Overhead() || aChannel >= kChannels) {
+        return false;
+    }
+
     unsigned char      nonce[MAX_NONCE_BYTES]{};
     unsigned long long cipherTextLen{};
 
-    // TODO: counter/replay protection in nonce
-    randombytes_buf(nonce, mAEAD->NonceBytes);
+    const std::uint64_t counter = channelCounter(aChannel, mTXCounters[aChannel]++);
+    expandNonce(mAEAD, counter, nonce);
 
-    // [nonce | ciphertext + tag]
-    mBuffer.resize(mAEAD->NonceBytes + aBytes.size() + mAEAD->AuthTagBytes);
-
-    std::memcpy(mBuffer.data(), nonce, mAEAD->NonceBytes);
+    // [counter | ciphertext + tag]
+    std::memcpy(aOut.data(), nonce, kCounterBytes);
 
     int ret = mAEAD->Encrypt(
-        mBuffer.data() + mAEAD->NonceBytes,
+        aOut.data() + kCounterBytes,
         &cipherTextLen,
         aBytes.data(),
         aBytes.size(),
@@ -24,30 +104,75 @@ byte_view CryptoSession::Encrypt(byte_view aBytes)
         nonce,
         mTX);
 
-    return ret == 0 ? mBuffer : byte_view{};
+    return ret == 0;
 }
 
 byte_view CryptoSession::Decrypt(byte_view aBytes)
 {
-    const auto minSize = mAEAD->NonceBytes + mAEAD->AuthTagBytes;
-    if (aBytes.size() < minSize + 1) return {};
+    if (aBytes.size() < kCounterBytes + 1) return {};
+
+    std::uint64_t counter = 0;
+    for (std::size_t idx = 0; idx < kCounterBytes; ++idx) {
+        counter |= std::uint64_t(aBytes[idx]) << (8 * idx);
+    }
+    const std::size_t channel = counter >> kCounterShift;
+    if (channel >= kChannels) {
+        return {};
+    }
+    ReplayWindow& replay = mReplay[channel];
+    if (!replay.Check(counter)) {
+        ++mReplayed;
+        return {};
+    }
+
+    byte_view cipherText = aBytes.subspan(kCounterBytes);
 
-    byte_view nonce      = aBytes.subspan(0, mAEAD->NonceBytes);
-    byte_view cipherText = aBytes.subspan(mAEAD->NonceBytes, aBytes.size() - mAEAD->NonceBytes);
+    bool opened = false;
+    if (Negotiating()) {
+        for (std::uint8_t id = 0; id < std::uint8_t(AEADID::Count) && !opened; ++id) {
+            if (!(mOffered & AEADBit(AEADID(id)))) {
+                continue;
+            }
+            if (AEADHandle aead = AEADFromID(AEADID(id)); decryptWith(aead, counter, cipherText)) {
+                mAEAD    = aead;
+                mOffered = 0;
+                opened   = true;
+            }
+        }
+    } else {
+        opened = decryptWith(mAEAD, counter, cipherText);
+    }
+    if (!opened) {
+        return {};
+    }
+
+    // only authenticated counters move the window
+    replay.Accept(counter);
+    return mBuffer;
+}
+
+bool CryptoSession::decryptWith(AEADHandle aAEAD, std::uint64_t aCounter, byte_view aCipherText)
+{
+    if (aCipherText.size() < aAEAD->AuthTagBytes + 1) {
+        return false;
+    }
+
+    unsigned char nonce[MAX_NONCE_BYTES]{};
+    expandNonce(aAEAD, aCounter, nonce);
 
     unsigned long long decryptedLen{};
 
-    mBuffer.resize(cipherText.size() - mAEAD->AuthTagBytes);
+    mBuffer.resize(aCipherText.size() - aAEAD->AuthTagBytes);
 
-    int ret = mAEAD->Decrypt(
+    int ret = aAEAD->Decrypt(
         mBuffer.data(),
         &decryptedLen,
         nullptr,
-        cipherText.data(),
-        cipherText.size(),
+        aCipherText.data(),
+        aCipherText.size(),
         nullptr,
         0,
-        nonce.data(),
+        nonce,
         mRX);
-    return ret == 0 ? mBuffer : byte_view{};
+    return ret == 0;
 }
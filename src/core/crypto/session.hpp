@@ -1,8 +1,9 @@
 #pragma once
 
 #include <sodium/crypto_kx.h>
-#include <sodium/randombytes.h>
 
+#include <array>
+#include <cstdint>
 #include <cstring>
 #include <span>
 #include <vector>
@@ -13,45 +14,157 @@
 
 #define MAX_NONCE_BYTES 32U
 
-class CryptoSession
+/**
+ * @brief Sliding window of the packet counters received, rejects duplicates and stale packets
+ *
+ * One per ENet channel: packets of a channel arrive about in the order they were sent, a reliable
+ * one ENet held back behind a retransmission does not fall behind the unreliable traffic.
+ */
+class ReplayWindow
 {
    public:
-    void Init(const CryptoKeys& aSelf, CryptoKeys::Public aPub, bool aHasAESNI, bool aServer)
+    static constexpr std::uint64_t kSize = 1024;
+
+    void Reset()
+    {
+        mHighest = 0;
+        mSeen.fill(0);
+        mAny = false;
+    }
+
+    // whether aCounter may be accepted, does not record it
+    [[nodiscard]] bool Check(std::uint64_t aCounter) const noexcept
+    {
+        if (!mAny || aCounter > mHighest) {
+            return true;
+        }
+        if (mHighest - aCounter >= kSize) {
+            return false;
+        }
+        return !test(aCounter);
+    }
+
+    // record an authenticated counter, must have passed Check
+    void Accept(std::uint64_t aCounter) noexcept
     {
-        mAEGIS = aHasAESNI;
-        mAEAD  = aHasAESNI ? AEGIS256Handle() : XChaCha20Poly1305IETFHandle();
-        if (aServer) {
-            mValid =
-                (crypto_kx_server_session_keys(
-                     mRX,
-                     mTX,
-                     aSelf.RawPublicKey().data(),
-                     aSelf.RawSecretKey().data(),
-                     aPub.data())
-                 == 0);
-        } else {
-            mValid =
-                (crypto_kx_client_session_keys(
-                     mRX,
-                     mTX,
-                     aSelf.RawPublicKey().data(),
-                     aSelf.RawSecretKey().data(),
-                     aPub.data())
-                 == 0);
+        if (!mAny) {
+            mAny     = true;
+            mHighest = aCounter;
+        } else if (aCounter > mHighest) {
+            const std::uint64_t advance = aCounter - mHighest;
+            if (advance >= kSize) {
+                mSeen.fill(0);
+            } else {
+                for (std::uint64_t c = mHighest + 1; c <= aCounter; ++c) {
+                    clear(c);
+                }
+            }
+            mHighest = aCounter;
         }
+        set(aCounter);
+    }
+
+   private:
+    static constexpr std::size_t kWords = kSize / 64;
+
+    bool test(std::uint64_t aCounter) const noexcept
+    {
+        return (mSeen[(aCounter / 64) % kWords] >> (aCounter % 64)) & 1U;
+    }
+    void set(std::uint64_t aCounter) noexcept
+    {
+        mSeen[(aCounter / 64) % kWords] |= std::uint64_t(1) << (aCounter % 64);
+    }
+    void clear(std::uint64_t aCounter) noexcept
+    {
+        mSeen[(aCounter / 64) % kWords] &= ~(std::uint64_t(1) << (aCounter % 64));
     }
 
+    std::array<std::uint64_t, kWords> mSeen{};
+    std::uint64_t                     mHighest{0};
+    bool                              mAny{false};
+};
+
+/**
+ * @brief AEAD session derived from a key exchange and a salt drawn by the server
+ *
+ * Nonces are a per direction and per ENet channel packet counter, only the 8 counter bytes go on
+ * the wire: the channel in the high byte, the channel counter in the others. Both sides derive
+ * distinct keys per direction from the key exchange, each then hashed with the salt the server
+ * draws for every connection: a reused client key pair or a replayed handshake still gets fresh
+ * keys, counters restarting at 0 never reuse a nonce under the same key.
+ */
+class CryptoSession
+{
+   public:
+    // little endian packet counter prefixed to every message
+    static constexpr std::size_t kCounterBytes = sizeof(std::uint64_t);
+    static constexpr std::size_t kSaltBytes    = 16;
+    // ENet channels with their own counter and replay window
+    static constexpr std::size_t kChannels     = 2;
+
+    using salt_type = std::array<uint8_t, kSaltBytes>;
+
+    // server side, a fresh random salt for a connection
+    static salt_type MakeSalt();
+
+    void Init(
+        const CryptoKeys&  aSelf,
+        CryptoKeys::Public aPub,
+        AEADID             aCipher,
+        bool               aServer,
+        const salt_type&   aSalt);
+
     bool Valid() const { return mValid; }
     void Reset() { mValid = false; }
 
-    byte_view Encrypt(byte_view aBytes);
+    /**
+     * @brief Client side, before the server picked one of aOffered
+     *
+     * The first message authenticating under any offered AEAD settles the session on it.
+     */
+    void Offer(AEADMask aOffered) { mOffered = aOffered; }
+    [[nodiscard]] bool   Negotiating() const { return mOffered != 0; }
+    [[nodiscard]] AEADID Cipher() const { return mAEAD->ID; }
+
+    [[nodiscard]] std::uint64_t Replayed() const noexcept { return mReplayed; }
+
+    // bytes added to a message by Encrypt
+    [[nodiscard]] std::size_t Overhead() const { return kCounterBytes + mAEAD->AuthTagBytes; }
+
+    // aChannel is the ENet channel the message is sent on
+    byte_view Encrypt(byte_view aBytes, std::uint8_t aChannel = 0);
+    /**
+     * @brief Encrypt aBytes into aOut, which must be exactly Overhead() bytes larger
+     *
+     * @return false if aOut has the wrong size, aChannel is not a session channel or encryption
+     * failed
+     */
+    bool EncryptInto(byte_view aBytes, std::span<uint8_t> aOut, std::uint8_t aChannel = 0);
     byte_view Decrypt(byte_view aBytes);
 
    private:
+    // bits of the wire counter below the channel
+    static constexpr unsigned kCounterShift = 56;
+
+    static constexpr std::uint64_t channelCounter(std::uint8_t aChannel, std::uint64_t aCounter)
+    {
+        return (std::uint64_t(aChannel) << kCounterShift)
+               | (aCounter & ((std::uint64_t(1) << kCounterShift) - 1));
+    }
+
+    static void expandNonce(AEADHandle aAEAD, std::uint64_t aCounter, unsigned char* aNonce);
+
+    bool decryptWith(AEADHandle aAEAD, std::uint64_t aCounter, byte_view aCipherText);
+
     unsigned char mRX[crypto_kx_SESSIONKEYBYTES]{}, mTX[crypto_kx_SESSIONKEYBYTES]{};
-    AEADHandle    mAEAD;
+    AEADHandle    mAEAD{nullptr};
     bool          mValid{false};
-    bool          mAEGIS{false};
+    AEADMask      mOffered{0};
+
+    std::array<std::uint64_t, kChannels> mTXCounters{};
+    std::array<ReplayWindow, kChannels>  mReplay{};
+    std::uint64_t                        mReplayed{0};
 
     std::vector<uint8_t> mBuffer{};
 };
@@ -0,0 +1,66 @@
+#include "core/flow_field_jobs.hpp"
+
+#include <algorithm>
+
+void FlowFieldJobs::Submit(PlayerID aPlayer, const Graph& aGraph, std::uint32_t aTick)
+{
+    Job job{
+        .Player   = aPlayer,
+        .Tick     = aTick + kDelay,
+        .Changes  = aGraph.PendingChanges(),
+        .Repaired = acquire(aPlayer, aGraph),
+        .Done     = {},
+    };
+
+    if (mExecutor != nullptr) {
+        job.Done = mExecutor->async([graph = job.Repaired]() { graph->UpdatePaths(); });
+    } else {
+        job.Repaired->UpdatePaths();
+    }
+    mJobs.push_back(std::move(job));
+}
+
+std::size_t FlowFieldJobs::Publish(PlayerGraphMap& aGraphs, std::uint32_t aTick)
+{
+    std::size_t published = 0;
+
+    while (!mJobs.empty() && mJobs.front().Tick <= aTick) {
+        Job job = std::move(mJobs.front());
+        mJobs.pop_front();
+
+        if (job.Done.valid()) {
+            job.Done.wait();
+        }
+
+        auto it = aGraphs.find(job.Player);
+        if (it == aGraphs.end()) {
+            mBuffers.erase(job.Player);
+            continue;
+        }
+        it->second.AdoptPaths(*job.Repaired, job.Changes);
+        mBuffers[job.Player].push_back(std::move(job.Repaired));
+
+        // later copies of this graph were taken with these changes pending too
+        for (Job& later : mJobs) {
+            if (later.Player == job.Player) {
+                later.Changes -= std::min(later.Changes, job.Changes);
+            }
+        }
+        ++published;
+    }
+    return published;
+}
+
+std::shared_ptr<Graph> FlowFieldJobs::acquire(PlayerID aPlayer, const Graph& aGraph)
+{
+    auto&                  free = mBuffers[aPlayer];
+    std::shared_ptr<Graph> graph;
+    if (free.empty()) {
+        graph = std::make_shared<Graph>(aGraph.Width(), aGraph.Height(), glm::vec2{0.0f, 0.0f});
+    } else {
+        graph = std::move(free.back());
+        free.pop_back();
+    }
+    graph->CopyPathsFrom(aGraph);
+    return graph;
+}
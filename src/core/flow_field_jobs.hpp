@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <map>
+#include <memory>
+#include <taskflow/core/executor.hpp>
+#include <vector>
+
+#include "core/graph.hpp"
+#include "core/types.hpp"
+
+/**
+ * @brief Player graph paths repaired on a worker, published at a fixed tick
+ *
+ * The obstacles of a tower built at tick T are toggled on the player Graph right away but creeps
+ * keep following its old paths: a copy is repaired on the executor and its paths replace them at
+ * T + kDelay. Publish() waits for a repair that is not done by then, the tick paths change on does
+ * not depend on worker timing and lockstep clients stay in sync with the server.
+ *
+ * Copies go to buffers of the player reused once published, only the obstacles, paths and pending
+ * changes are copied into them and a repair does not allocate once as many were in flight.
+ *
+ * Without an executor repairs run in Submit(), and are published at T + kDelay all the same.
+ */
+class FlowFieldJobs
+{
+   public:
+    // ticks between a tower being built and creeps going around it
+    static constexpr std::uint32_t kDelay = 6;
+
+    explicit FlowFieldJobs(tf::Executor* aExecutor = nullptr) : mExecutor(aExecutor) {}
+
+    // repair the paths of a copy of aGraph, the graph of aPlayer, to publish at aTick + kDelay
+    void Submit(PlayerID aPlayer, const Graph& aGraph, std::uint32_t aTick);
+
+    // hand the repairs due at aTick to the graphs of aGraphs, returns how many were published
+    std::size_t Publish(PlayerGraphMap& aGraphs, std::uint32_t aTick);
+
+    [[nodiscard]] std::size_t Pending() const noexcept { return mJobs.size(); }
+
+   private:
+    // a free buffer of aPlayer, or a new one, holding the obstacles and paths of aGraph
+    std::shared_ptr<Graph> acquire(PlayerID aPlayer, const Graph& aGraph);
+
+    struct Job {
+        PlayerID      Player;
+        std::uint32_t Tick;
+        // pending changes of the player graph the copy was taken with
+        std::size_t            Changes;
+        // shared with the worker, a dropped job does not pull the graph from under it
+        std::shared_ptr<Graph> Repaired;
+        std::future<void>      Done;
+    };
+
+    tf::Executor*   mExecutor;
+    // in tick order, every job is due kDelay ticks after it was submitted
+    std::deque<Job> mJobs;
+    // published copies per player, their buffers hold the paths the graphs had before
+    std::map<PlayerID, std::vector<std::shared_ptr<Graph>>> mBuffers;
+};
@@ -1,66 +1,245 @@
 #include "core/graph.hpp"
 
-#include <queue>
+#include <algorithm>
 
 Graph::grid_preview_type Graph::GridLayout() const
 {
-    Graph::grid_preview_type grid(mWidth * mHeight, 0);
+    Graph::grid_preview_type grid(Cells(), 0);
 
-    for (const GraphCell& obstacle : mObstacles) {
-        grid[Index(obstacle)] = 255;
+    for (index_type idx = 0; idx < Cells(); ++idx) {
+        if (isObstacle(idx)) {
+            grid[idx] = 255;
+        }
     }
 
     return grid;
 }
 
-Graph::obstacles_type Graph::Neighbours(const GraphCell& aCell)
+void Graph::ComputePaths(const GraphCell& aDest)
 {
-    Graph::obstacles_type neighbours;
-
-    // https://www.redblobgames.com/pathfinding/a-star/implementation.html#troubleshooting-ugly-path
-    GraphCell candidates[8] = {
-        // N, S, E, W
-        GraphCell(aCell.Location.x, aCell.Location.y - 1),
-        GraphCell(aCell.Location.x, aCell.Location.y + 1),
-        GraphCell(aCell.Location.x + 1, aCell.Location.y),
-        GraphCell(aCell.Location.x - 1, aCell.Location.y),
-        // NE, NW, SE, SW
-        GraphCell(aCell.Location.x + 1, aCell.Location.y - 1),
-        GraphCell(aCell.Location.x - 1, aCell.Location.y - 1),
-        GraphCell(aCell.Location.x + 1, aCell.Location.y + 1),
-        GraphCell(aCell.Location.x - 1, aCell.Location.y + 1),
-    };
-
-    for (const GraphCell& c : candidates) {
-        if (IsInside(c) && !mObstacles.contains(c)) {
-            neighbours.emplace_back(c);
-        }
+    mDest = aDest;
+    mChanged.clear();
+    std::ranges::fill(mDistances, kUnreachable);
+    std::ranges::fill(mSteps, kNoStep);
+
+    if (!IsInside(aDest)) {
+        return;
     }
 
-    return neighbours;
+    std::size_t head = 0;
+    std::size_t tail = 0;
+
+    mQueue[tail++]           = Index(aDest);
+    mDistances[Index(aDest)] = 0;
+
+    // a cell is dequeued once every cell one step closer is known, its step is chosen then
+    while (head < tail) {
+        const index_type    current  = mQueue[head++];
+        const distance_type distance = mDistances[current];
+        std::uint8_t        step     = kNoStep;
+
+        forEachNeighbour(current, [&](enum Direction aDir, index_type aNeighbour) {
+            if (isObstacle(aNeighbour)) {
+                return;
+            }
+            const distance_type neighbourDistance = mDistances[aNeighbour];
+            if (neighbourDistance == kUnreachable) {
+                mDistances[aNeighbour] = distance + 1;
+                mQueue[tail++]         = aNeighbour;
+            } else if (step == kNoStep && neighbourDistance + 1 == distance) {
+                step = std::uint8_t(aDir);
+            }
+        });
+        mSteps[current] = step;
+    }
 }
 
-void Graph::ComputePaths(const GraphCell& aDest)
+void Graph::ComputePaths(const glm::vec3 aWorldPosition)
 {
-    mDest = aDest;
-    mPaths.clear();
-    std::queue<GraphCell> cells;
-
-    cells.push(aDest);
-
-    while (!cells.empty()) {
-        GraphCell current = cells.front();
-        cells.pop();
-        for (const GraphCell& neighbour : Neighbours(current)) {
-            if (!mPaths.contains(neighbour)) {
-                cells.push(neighbour);
-                mPaths.emplace(neighbour, current);
+    return ComputePaths(CellFromWorld(aWorldPosition));
+}
+
+void Graph::UpdatePaths()
+{
+    if (mChanged.empty()) {
+        return;
+    }
+    if (!mDest || !IsInside(*mDest)) {
+        mChanged.clear();
+        return;
+    }
+
+    mTouched.clear();
+    invalidateDependents(Index(*mDest));
+    propagateDecreases(mTouched.size());
+
+    // a step only depends on the cell and its neighbours
+    for (const index_type cell : mTouched) {
+        mSteps[cell] = nextStep(cell);
+        forEachNeighbour(cell, [this](enum Direction, index_type aNeighbour) {
+            if (!mMarks[aNeighbour]) {
+                mSteps[aNeighbour] = nextStep(aNeighbour);
+            }
+        });
+    }
+    for (const index_type cell : mTouched) {
+        mMarks[cell] = 0;
+    }
+    mChanged.clear();
+}
+
+void Graph::CopyPathsFrom(const Graph& aGraph)
+{
+    if (Cells() != aGraph.Cells()) {
+        mQueue.resize(aGraph.Cells());
+        mMarks.assign(aGraph.Cells(), 0);
+    }
+    mWidth       = aGraph.mWidth;
+    mHeight      = aGraph.mHeight;
+    mWorldOffset = aGraph.mWorldOffset;
+    mDest        = aGraph.mDest;
+
+    // no allocation once the buffers are the size of aGraph ones
+    mObstacles.assign(aGraph.mObstacles.begin(), aGraph.mObstacles.end());
+    mDistances.assign(aGraph.mDistances.begin(), aGraph.mDistances.end());
+    mSteps.assign(aGraph.mSteps.begin(), aGraph.mSteps.end());
+    mChanged.assign(aGraph.mChanged.begin(), aGraph.mChanged.end());
+}
+
+void Graph::AdoptPaths(Graph& aRepaired, std::size_t aChanges)
+{
+    mDistances.swap(aRepaired.mDistances);
+    mSteps.swap(aRepaired.mSteps);
+    mChanged.erase(
+        mChanged.begin(),
+        mChanged.begin() + std::ptrdiff_t(std::min(aChanges, mChanged.size())));
+}
+
+std::uint8_t Graph::nextStep(index_type aIndex) const
+{
+    const distance_type distance = mDistances[aIndex];
+    std::uint8_t        step     = kNoStep;
+
+    // same choice as ComputePaths makes when it dequeues the cell
+    if (distance != kUnreachable && distance != 0) {
+        forEachNeighbour(aIndex, [&](enum Direction aDir, index_type aNeighbour) {
+            const distance_type neighbourDistance = mDistances[aNeighbour];
+            if (step == kNoStep && !isObstacle(aNeighbour) && neighbourDistance != kUnreachable
+                && neighbourDistance + 1 == distance) {
+                step = std::uint8_t(aDir);
             }
+        });
+    }
+    return step;
+}
+
+void Graph::touch(index_type aIndex)
+{
+    if (!mMarks[aIndex]) {
+        mMarks[aIndex] = 1;
+        mTouched.push_back(aIndex);
+    }
+}
+
+// the sorted seeds and the FIFO, whose distances never decrease, merged by distance
+bool Graph::popLowest(std::size_t& aSeedHead, std::size_t& aFifoHead, entry_type& aEntry) const
+{
+    const bool seeds = aSeedHead < mSeeds.size();
+    const bool fifo  = aFifoHead < mFifo.size();
+    if (!seeds && !fifo) {
+        return false;
+    }
+    if (seeds && (!fifo || mSeeds[aSeedHead].second <= mFifo[aFifoHead].second)) {
+        aEntry = mSeeds[aSeedHead++];
+    } else {
+        aEntry = mFifo[aFifoHead++];
+    }
+    return true;
+}
+
+/**
+ * Cells newly blocked lose their distance, and so does every cell left without a free neighbour
+ * one step closer. Cells are visited by increasing old distance, so the neighbours a cell could
+ * still go through are settled when it is checked. The others keep a path as short as before.
+ */
+void Graph::invalidateDependents(index_type aDest)
+{
+    mSeeds.clear();
+    mFifo.clear();
+
+    for (const index_type cell : mChanged) {
+        touch(cell);
+        if (cell != aDest && isObstacle(cell) && mDistances[cell] != kUnreachable) {
+            mSeeds.emplace_back(cell, mDistances[cell]);
+            mDistances[cell] = kUnreachable;
         }
     }
+    std::ranges::sort(mSeeds, {}, &entry_type::second);
+
+    std::size_t seedHead = 0;
+    std::size_t fifoHead = 0;
+    entry_type  entry;
+    while (popLowest(seedHead, fifoHead, entry)) {
+        const distance_type level = entry.second;
+
+        forEachNeighbour(entry.first, [&](enum Direction, index_type aNeighbour) {
+            if (mDistances[aNeighbour] != level + 1) {
+                return;
+            }
+            // cells closer that lost their distance are unreachable by now
+            bool supported = false;
+            forEachNeighbour(aNeighbour, [&](enum Direction, index_type aSupport) {
+                supported = supported || mDistances[aSupport] == level;
+            });
+            if (!supported) {
+                touch(aNeighbour);
+                mDistances[aNeighbour] = kUnreachable;
+                mFifo.emplace_back(aNeighbour, level + 1);
+            }
+        });
+    }
 }
 
-void Graph::ComputePaths(const glm::vec3 aWorldPosition)
+/**
+ * The cells that lost their distance and the freed ones take the best of their neighbours, then
+ * the improvements spread by increasing distance, as in the BFS.
+ */
+void Graph::propagateDecreases(std::size_t aCandidates)
 {
-    return ComputePaths(CellFromWorld(aWorldPosition));
+    mSeeds.clear();
+    mFifo.clear();
+
+    for (std::size_t idx = 0; idx < aCandidates; ++idx) {
+        const index_type cell = mTouched[idx];
+        if (isObstacle(cell) || mDistances[cell] == 0) {
+            continue;
+        }
+        distance_type best = kUnreachable;
+        forEachNeighbour(cell, [&](enum Direction, index_type aNeighbour) {
+            best = std::min(best, mDistances[aNeighbour]);
+        });
+        if (best != kUnreachable && best + 1 < mDistances[cell]) {
+            mDistances[cell] = best + 1;
+            mSeeds.emplace_back(cell, best + 1);
+        }
+    }
+    std::ranges::sort(mSeeds, {}, &entry_type::second);
+
+    std::size_t seedHead = 0;
+    std::size_t fifoHead = 0;
+    entry_type  entry;
+    while (popLowest(seedHead, fifoHead, entry)) {
+        const auto [cell, distance] = entry;
+        // improved again since it was queued
+        if (mDistances[cell] != distance) {
+            continue;
+        }
+        forEachNeighbour(cell, [&](enum Direction, index_type aNeighbour) {
+            if (!isObstacle(aNeighbour) && distance + 1 < mDistances[aNeighbour]) {
+                touch(aNeighbour);
+                mDistances[aNeighbour] = distance + 1;
+                mFifo.emplace_back(aNeighbour, distance + 1);
+            }
+        });
+    }
 }
@@ -4,12 +4,15 @@
 #include <fmt/ranges.h>
 #include <spdlog/spdlog.h>
 
+#include <algorithm>
+#include <array>
+#include <cstdint>
 #include <glm/vec2.hpp>
 #include <glm/vec3.hpp>
+#include <limits>
 #include <map>
 #include <optional>
-#include <unordered_map>
-#include <unordered_set>
+#include <utility>
 #include <vector>
 
 #include "core/types.hpp"
@@ -36,32 +39,55 @@ struct GraphCell {
     vec_type Location;
 };
 
-template <>
-struct std::hash<GraphCell> {
-    std::size_t operator()(const GraphCell& aCell) const noexcept
-    {
-        std::size_t hX = std::hash<GraphCell::size_type>{}(aCell.Location.x);
-        std::size_t hY = std::hash<GraphCell::size_type>{}(aCell.Location.y);
-        return hX ^ (hY << 1);
-    }
-};
-
+/**
+ * @brief Flow field of a player map, every cell knows its next step toward a destination
+ *
+ * Flat arrays indexed by Index(): an obstacle bitset, the distance in steps of each cell to the
+ * destination and the direction of its next step, so looking a step up is a bounds check and a
+ * load. The step of a cell goes to the first neighbour one step closer, in N, S, E, W, NE, NW,
+ * SE, SW order, it only depends on the distances and not on the order the BFS visited cells.
+ *
+ * Obstacles toggled once paths are computed are recorded, UpdatePaths() then repairs the field
+ * around them only, to the same result as computing it again. Until then the steps stay the ones
+ * computed before, FlowFieldJobs repairs a copy off the tick and hands its paths back.
+ */
 class Graph
 {
     using size_type         = GraphCell::size_type;
     using grid_preview_type = std::vector<GraphCell::grid_preview_type>;
-    using obstacles_type    = std::vector<GraphCell>;
-    using paths_type        = std::unordered_map<GraphCell, GraphCell>;
 
    public:
-    enum class Direction { Left, Right, Up, Down, UpRight, UpLeft, DownRight, DownLeft };
+    using index_type    = std::uint32_t;
+    using distance_type = std::uint32_t;
+
+    static constexpr distance_type kUnreachable = std::numeric_limits<distance_type>::max();
+
+    enum class Direction : std::uint8_t {
+        Left,
+        Right,
+        Up,
+        Down,
+        UpRight,
+        UpLeft,
+        DownRight,
+        DownLeft
+    };
+
     Graph(const size_type aW, const size_type aH, const glm::vec2& aWorldOffset)
-        : mWidth(aW), mHeight(aH), mWorldOffset(aWorldOffset)
+        : mWidth(aW),
+          mHeight(aH),
+          mObstacles((std::size_t(aW) * aH + 63) / 64, 0),
+          mDistances(std::size_t(aW) * aH, kUnreachable),
+          mSteps(std::size_t(aW) * aH, kNoStep),
+          mQueue(std::size_t(aW) * aH),
+          mMarks(std::size_t(aW) * aH, 0),
+          mWorldOffset(aWorldOffset)
     {
     }
 
-    constexpr size_type Width() const { return mWidth; }
-    constexpr size_type Height() const { return mHeight; }
+    constexpr size_type  Width() const { return mWidth; }
+    constexpr size_type  Height() const { return mHeight; }
+    constexpr index_type Cells() const { return index_type(mWidth) * mHeight; }
 
     /// World-space bounds check. Safe to call with any float — no UB cast.
     constexpr bool IsInside(float aX, float aZ) const
@@ -84,9 +110,9 @@ class Graph
         return IsInside(aCell.Location.x, aCell.Location.y);
     }
 
-    constexpr size_type Index(const GraphCell& aCell) const
+    constexpr index_type Index(const GraphCell& aCell) const
     {
-        return SafeU16(aCell.Location.y) * mWidth + aCell.Location.x;
+        return index_type(aCell.Location.y) * mWidth + aCell.Location.x;
     }
 
     GraphCell CellFromWorld(float aX, float aZ) const
@@ -102,7 +128,7 @@ class Graph
         return CellFromWorld(aPoint.x, aPoint.z);
     }
 
-    constexpr std::optional<Graph::Direction> Direction(
+    static constexpr std::optional<Graph::Direction> Direction(
         const GraphCell& aFrom,
         const GraphCell& aTo)
     {
@@ -121,7 +147,6 @@ class Graph
     }
 
     grid_preview_type GridLayout() const;
-    obstacles_type    Neighbours(const GraphCell& aCell);
 
     /**
      * @brief using a simple Flood Field/BFS algorithm, compute the Path from any cell to the
@@ -130,30 +155,155 @@ class Graph
     void ComputePaths(const GraphCell& aDest);
     void ComputePaths(const glm::vec3 aWorldPosition);
 
+    /**
+     * @brief repair the paths to the current destination after obstacles were added or removed,
+     * only re-propagating distances through the cells whose distance changes
+     */
+    void UpdatePaths();
+
+    // obstacles toggled since the paths were computed, UpdatePaths() repairs them
+    std::size_t PendingChanges() const { return mChanged.size(); }
+
+    /**
+     * @brief copy the obstacles, paths, destination and pending changes of aGraph into this graph,
+     * reusing its buffers, without the UpdatePaths() scratch buffers
+     */
+    void CopyPathsFrom(const Graph& aGraph);
+
+    /**
+     * @brief take the paths of aRepaired, a copy of this graph whose paths were repaired once the
+     * first aChanges pending changes were made, the changes made since stay pending
+     */
+    void AdoptPaths(Graph& aRepaired, std::size_t aChanges);
+
     std::optional<GraphCell> GetNextCell(const GraphCell& aFrom) const
     {
-        if (!mPaths.contains(aFrom) || aFrom == mDest) {
+        if (!IsInside(aFrom)) {
             return std::nullopt;
         }
-        return std::make_optional(mPaths.at(aFrom));
+        const std::uint8_t step = mSteps[Index(aFrom)];
+        if (step >= kNoStep) {
+            return std::nullopt;
+        }
+        const auto [dx, dy] = kOffsets[step];
+        return GraphCell(size_type(aFrom.Location.x + dx), size_type(aFrom.Location.y + dy));
     }
     std::optional<GraphCell> GetNextCell(const glm::vec3& aWorldPos) const
     {
         return GetNextCell(CellFromWorld(aWorldPos));
     }
 
-    void AddObstacle(const GraphCell& aCell) { mObstacles.emplace(aCell); }
-    void RemoveObstacle(const GraphCell& aCell) { mObstacles.erase(aCell); }
+    // steps from aCell to the destination, kUnreachable when there is no path
+    distance_type Distance(const GraphCell& aCell) const
+    {
+        return IsInside(aCell) ? mDistances[Index(aCell)] : kUnreachable;
+    }
+
+    bool IsObstacle(const GraphCell& aCell) const
+    {
+        return IsInside(aCell) && isObstacle(Index(aCell));
+    }
+
+    void AddObstacle(const GraphCell& aCell)
+    {
+        if (IsInside(aCell) && !isObstacle(Index(aCell))) {
+            toggleObstacle(Index(aCell));
+        }
+    }
+    void RemoveObstacle(const GraphCell& aCell)
+    {
+        if (IsInside(aCell) && isObstacle(Index(aCell))) {
+            toggleObstacle(Index(aCell));
+        }
+    }
 
     bool GridDirty = false;
 
    private:
+    // mSteps of cells without a next step: unreachable ones, obstacles and the destination
+    static constexpr std::uint8_t kNoStep = 8;
+
+    // cell offset of each Direction
+    static constexpr std::array<std::pair<int, int>, 8> kOffsets = {{
+        {-1, 0},
+        {1, 0},
+        {0, -1},
+        {0, 1},
+        {1, -1},
+        {-1, -1},
+        {1, 1},
+        {-1, 1},
+    }};
+
+    // https://www.redblobgames.com/pathfinding/a-star/implementation.html#troubleshooting-ugly-path
+    static constexpr std::array<enum Direction, 8> kNeighbours = {
+        // N, S, E, W
+        Direction::Up,
+        Direction::Down,
+        Direction::Right,
+        Direction::Left,
+        // NE, NW, SE, SW
+        Direction::UpRight,
+        Direction::UpLeft,
+        Direction::DownRight,
+        Direction::DownLeft,
+    };
+
+    using entry_type = std::pair<index_type, distance_type>;
+
+    bool isObstacle(index_type aIndex) const
+    {
+        return (mObstacles[aIndex / 64] >> (aIndex % 64)) & 1;
+    }
+
+    void toggleObstacle(index_type aIndex)
+    {
+        mObstacles[aIndex / 64] ^= std::uint64_t(1) << (aIndex % 64);
+        if (mDest) {
+            mChanged.push_back(aIndex);
+        }
+    }
+
+    std::uint8_t nextStep(index_type aIndex) const;
+    void         touch(index_type aIndex);
+    bool popLowest(std::size_t& aSeedHead, std::size_t& aFifoHead, entry_type& aEntry) const;
+    void invalidateDependents(index_type aDest);
+    void propagateDecreases(std::size_t aCandidates);
+
+    // calls aFunc(direction, index) for the neighbours of aIndex inside the grid, in kNeighbours
+    // order
+    template <typename Func>
+    void forEachNeighbour(index_type aIndex, Func&& aFunc) const
+    {
+        const int x = int(aIndex % mWidth);
+        const int y = int(aIndex / mWidth);
+        for (const enum Direction dir : kNeighbours) {
+            const auto [dx, dy] = kOffsets[std::size_t(dir)];
+            const int nx        = x + dx;
+            const int ny        = y + dy;
+            if (nx >= 0 && nx < mWidth && ny >= 0 && ny < mHeight) {
+                aFunc(dir, index_type(ny) * mWidth + index_type(nx));
+            }
+        }
+    }
+
     size_type mWidth;
     size_type mHeight;
 
-    std::unordered_set<GraphCell> mObstacles;
-    paths_type                    mPaths;
-    std::optional<GraphCell>      mDest;
+    std::vector<std::uint64_t> mObstacles;
+    std::vector<distance_type> mDistances;
+    std::vector<std::uint8_t>  mSteps;
+    // BFS queue, every cell is queued once at most
+    std::vector<index_type>    mQueue;
+    std::optional<GraphCell>   mDest;
+
+    // UpdatePaths: cells toggled since the paths were computed, and scratch buffers, mMarks flags
+    // the cells of mTouched
+    std::vector<index_type>   mChanged;
+    std::vector<index_type>   mTouched;
+    std::vector<std::uint8_t> mMarks;
+    std::vector<entry_type>   mSeeds;
+    std::vector<entry_type>   mFifo;
 
     glm::vec2 mWorldOffset;
 
@@ -197,24 +347,28 @@ struct fmt::formatter<GraphCell> : fmt::formatter<std::string> {
 
 template <>
 struct fmt::formatter<Graph> : fmt::formatter<std::string> {
-    auto format(Graph aObj, format_context& aCtx) const -> decltype(aCtx.out())
+    auto format(const Graph& aObj, format_context& aCtx) const -> decltype(aCtx.out())
     {
+        const auto paths = std::ranges::count_if(aObj.mSteps, [](std::uint8_t aStep) {
+            return aStep < Graph::kNoStep;
+        });
         auto o = fmt::format_to(
             aCtx.out(),
             "{}x{} grid, {} paths:\n",
             aObj.mWidth,
             aObj.mHeight,
-            aObj.mPaths.size());
+            paths);
+        std::vector<GraphCell> obstacles;
         for (GraphCell::size_type y = 0; y < aObj.mHeight; ++y) {
             for (GraphCell::size_type x = 0; x < aObj.mWidth; ++x) {
                 GraphCell c(x, y);
-                if (aObj.mObstacles.contains(c)) {
+                if (aObj.IsObstacle(c)) {
+                    obstacles.push_back(c);
                     o = fmt::format_to(o, "{}", 1);
                 } else if (aObj.mDest == c) {
                     o = fmt::format_to(o, "*");
-                } else if (aObj.mPaths.contains(c)) {
-                    const GraphCell& to  = aObj.mPaths.at(c);
-                    const auto&      dir = aObj.Direction(c, to);
+                } else if (const auto to = aObj.GetNextCell(c)) {
+                    const auto& dir = Graph::Direction(c, *to);
                     if (dir) {
                         o = fmt::format_to(o, "{}", *dir);
                     } else {
@@ -226,7 +380,7 @@ struct fmt::formatter<Graph> : fmt::formatter<std::string> {
             }
             o = fmt::format_to(o, "\n");
         }
-        return fmt::format_to(o, "obstacles: {}", fmt::join(aObj.mObstacles, ", "));
+        return fmt::format_to(o, "obstacles: {}", fmt::join(obstacles, ", "));
     }
 };
 
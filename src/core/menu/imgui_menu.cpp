@@ -6,6 +6,7 @@
 #include "components/player.hpp"
 #include "core/menu/menu.hpp"
 #include "core/menu/menu_events.hpp"
+#include "core/net/net.hpp"
 #include "core/net/pocketbase.hpp"
 #include "core/window.hpp"
 #include "imgui/imgui_helper.h"
@@ -216,7 +217,38 @@ void ImGuiMenu::renderLobby(Registry& aRegistry)
     renderStatusMsg(aRegistry);
 }
 
-void ImGuiMenu::renderInGame(const Registry& aRegistry) {}
+void ImGuiMenu::renderInGame(const Registry& aRegistry)
+{
+    const auto* stats = aRegistry.ctx().find<NetworkStatsResponse>();
+    if (stats == nullptr) {
+        return;
+    }
+
+    ImGui::SetNextWindowPos(ImVec2(10.0f, 10.0f), ImGuiCond_FirstUseEver);
+    ImGui::Begin("Network", nullptr, ImGuiWindowFlags_AlwaysAutoResize);
+
+    ImGui::Text("RTT: %u ms (+/- %u ms)", stats->RTT, stats->RTTVariance);
+    ImGui::Text("Loss: %.1f%%", double(stats->PacketLoss) * 100.0);
+    ImGui::Text(
+        "Reliable in flight: %u (%u bytes)",
+        stats->ReliableInFlight,
+        stats->ReliableBytesInFlight);
+    ImGui::Text("Retransmits: %llu", static_cast<unsigned long long>(stats->Retransmits));
+
+    if (ImGui::CollapsingHeader("Traffic per packet type")) {
+        for (const auto& traffic : stats->Traffic) {
+            ImGui::Text(
+                "type %u: in %llu (%llu B), out %llu (%llu B)",
+                unsigned(traffic.Type),
+                static_cast<unsigned long long>(traffic.PacketsIn),
+                static_cast<unsigned long long>(traffic.BytesIn),
+                static_cast<unsigned long long>(traffic.PacketsOut),
+                static_cast<unsigned long long>(traffic.BytesOut));
+        }
+    }
+
+    ImGui::End();
+}
 void ImGuiMenu::renderEndGame(const Registry& aRegistry)
 {
     auto& ranking = aRegistry.ctx().get<std::vector<PlayerID>>("ranking"_hs);
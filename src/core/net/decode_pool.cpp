@@ -0,0 +1,119 @@
+#include "core/net/decode_pool.hpp"
+
+#include <spdlog/spdlog.h>
+
+#include "core/net/packet_batch.hpp"
+#include "core/snapshot.hpp"
+
+DecodePool::DecodePool(std::size_t aWorkers, Logger aLogger) : mLogger(aLogger)
+{
+    for (std::size_t idx = 0; idx < aWorkers; ++idx) {
+        mWorkers.push_back(std::make_unique<Worker>());
+    }
+    // started once every worker exists, Post may then be called right away
+    for (auto& worker : mWorkers) {
+        worker->Thread = std::jthread(
+            [this, w = worker.get()](std::stop_token aStop) { run(*w, aStop); });
+    }
+}
+
+DecodePool::~DecodePool()
+{
+    for (auto& worker : mWorkers) {
+        worker->Thread.request_stop();
+        worker->Signal.fetch_add(1, std::memory_order_release);
+        worker->Signal.notify_one();
+    }
+    for (auto& worker : mWorkers) {
+        if (worker->Thread.joinable()) {
+            worker->Thread.join();
+        }
+        worker->Jobs.Drain([](DecodeJob* aJob) { release(*aJob); });
+    }
+}
+
+bool DecodePool::Post(DecodeJob&& aJob)
+{
+    Worker& worker = *mWorkers[aJob.ID % mWorkers.size()];
+    if (!worker.Jobs.TrySend(std::move(aJob))) {
+        return false;
+    }
+    worker.Signal.fetch_add(1, std::memory_order_release);
+    worker.Signal.notify_one();
+    return true;
+}
+
+std::uint64_t DecodePool::Overflows() const noexcept
+{
+    std::uint64_t overflows = 0;
+    for (const auto& worker : mWorkers) {
+        overflows += worker->Jobs.Overflows() + worker->Requests.Overflows();
+    }
+    return overflows;
+}
+
+void DecodePool::run(Worker& aWorker, std::stop_token aStop)
+{
+    while (!aStop.stop_requested()) {
+        const std::uint32_t seen = aWorker.Signal.load(std::memory_order_acquire);
+
+        const std::size_t done = aWorker.Jobs.Drain([&](DecodeJob* aJob) {
+            decode(aWorker, *aJob);
+            release(*aJob);
+        });
+        if (done == 0) {
+            // a post after the drain changed the signal, wait returns at once
+            aWorker.Signal.wait(seen, std::memory_order_acquire);
+        }
+    }
+}
+
+void DecodePool::decode(Worker& aWorker, DecodeJob& aJob)
+{
+    if (aJob.Retire || aJob.Packet == nullptr) {
+        return;
+    }
+
+    PeerState* state = aJob.State;
+    byte_view  raw{aJob.Packet->data, aJob.Packet->dataLength};
+    byte_view  decrypted = state->SecureSession.Decrypt(raw);
+    if (decrypted.empty()) {
+        mLogger->error("Could not decrypt data from player {}", aJob.ID);
+        return;
+    }
+
+    auto handler = [&](byte_view aMsg) {
+        BitInputArchive archive(aMsg);
+        NetworkRequest  ev;
+
+        if (!ev.Archive(archive)) {
+            mLogger->critical("cannot decode packet");
+            return;
+        }
+        if (ev.Type == PacketType::Auth) {
+            mLogger->warn("ignoring auth request of authenticated player {}", aJob.ID);
+            return;
+        }
+
+        ev.PlayerID = aJob.ID;
+        state->Traffic.CountIn(ev.Type, aMsg.size());
+        if (!aWorker.Requests.TrySend(std::move(ev))) {
+            mLogger->warn("request channel full, dropping request from player {}", aJob.ID);
+        }
+    };
+    if (!PacketBatch::ForEach(decrypted, handler)) {
+        mLogger->error("malformed packet batch from player {}", aJob.ID);
+    }
+}
+
+void DecodePool::release(DecodeJob& aJob)
+{
+    if (aJob.Packet != nullptr) {
+        enet_packet_destroy(aJob.Packet);
+        aJob.Packet = nullptr;
+    }
+    if (aJob.Retire) {
+        delete aJob.State;
+        aJob.State = nullptr;
+    }
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <enet.h>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <stop_token>
+#include <thread>
+#include <vector>
+
+#include "core/net/enet_base.hpp"
+#include "core/net/net.hpp"
+#include "core/queue/ring_channel.hpp"
+#include "core/sys/log.hpp"
+
+/**
+ * @brief Received packet handed over by a network thread, or a peer to retire
+ */
+struct DecodeJob {
+    // owned by the job, destroyed once decoded
+    ENetPacket* Packet{nullptr};
+    PeerState*  State{nullptr};
+    PlayerID    ID{0};
+    // no packet: delete State, after every packet of the peer posted before
+    bool        Retire{false};
+};
+
+/**
+ * @brief Workers decrypting and decoding the packets of authenticated peers
+ *
+ * A peer always hashes to the same worker and each worker handles its jobs in order, so requests
+ * of one player reach the game thread in the order they were received. Workers only touch the
+ * receiving half of the peer session, the network thread keeps encrypting concurrently.
+ */
+class DecodePool
+{
+   public:
+    static constexpr std::size_t kJobCapacity     = 1024;
+    static constexpr std::size_t kRequestCapacity = 1024;
+
+    DecodePool(std::size_t aWorkers, Logger aLogger);
+    DecodePool(DecodePool&&)                 = delete;
+    DecodePool(const DecodePool&)            = delete;
+    DecodePool& operator=(DecodePool&&)      = delete;
+    DecodePool& operator=(const DecodePool&) = delete;
+    ~DecodePool();
+
+    // network thread, false if the worker of aJob.ID is full: the job is left untouched
+    bool Post(DecodeJob&& aJob);
+
+    // game thread
+    template <typename Func>
+    void ConsumeRequests(Func&& aHandler)
+    {
+        for (auto& worker : mWorkers) {
+            worker->Requests.Drain(aHandler);
+        }
+    }
+
+    [[nodiscard]] std::size_t   Size() const noexcept { return mWorkers.size(); }
+    [[nodiscard]] std::uint64_t Overflows() const noexcept;
+
+   private:
+    struct Worker {
+        SpscRingChannel<DecodeJob, kJobCapacity>          Jobs;
+        SpscRingChannel<NetworkRequest, kRequestCapacity> Requests;
+
+        // bumped on every post, the worker sleeps on it when idle
+        std::atomic<std::uint32_t> Signal{0};
+        std::jthread               Thread;
+    };
+
+    void        run(Worker& aWorker, std::stop_token aStop);
+    void        decode(Worker& aWorker, DecodeJob& aJob);
+    static void release(DecodeJob& aJob);
+
+    std::vector<std::unique_ptr<Worker>> mWorkers;
+    Logger                               mLogger;
+};
@@ -23,6 +23,9 @@ inline constexpr const std::string peerDataStr(const ENetEvent& aEvent)
     return peerData;
 }
 
+// conditioner of the host serviced by this thread: ENet intercept callbacks carry no user data
+static thread_local LinkConditioner<ENetAddress>* tConditioner = nullptr;
+
 ENetBase::~ENetBase() { enet_deinitialize(); }
 
 void ENetBase::Init()
@@ -32,14 +35,18 @@ void ENetBase::Init()
     }
 }
 
-bool ENetBase::Send(ENetPeer* aPeer, std::span<const uint8_t> aData, bool aEncrypt)
+bool ENetBase::Send(
+    ENetPeer*                aPeer,
+    std::span<const uint8_t> aData,
+    bool                     aEncrypt,
+    Delivery                 aDelivery)
 {
     if (aPeer == nullptr) {
         mLogger->debug("client peer not initialized");
         return false;
     }
 
-    byte_buffer data;
+    ENetPacket* packet = nullptr;
     if (aEncrypt) {
         auto* state = static_cast<PeerState*>(aPeer->data);
         if (!state || !state->SecureSession.Valid()) {
@@ -47,27 +54,124 @@ bool ENetBase::Send(ENetPeer* aPeer, std::span<const uint8_t> aData, bool aEncry
             return false;
         }
 
-        byte_view enc = state->SecureSession.Encrypt(aData);
-        if (enc.empty()) {
+        // allocated once at its final size, the ciphertext is written straight into it
+        const std::size_t size = aData.size() + state->SecureSession.Overhead();
+        packet                 = enet_packet_create(nullptr, size, DeliveryFlags(aDelivery));
+        if (packet == nullptr) {
+            return false;
+        }
+
+        const enet_uint8 channel = DeliveryChannel(aDelivery);
+        if (!state->SecureSession.EncryptInto(aData, {packet->data, packet->dataLength}, channel)) {
             mLogger->error("Could not encrypt peer data");
+            enet_packet_destroy(packet);
             return false;
         }
-        data = byte_buffer(enc.begin(), enc.end());
     } else {
-        data = byte_buffer(aData.begin(), aData.end());
+        packet = enet_packet_create(aData.data(), aData.size(), DeliveryFlags(aDelivery));
+        if (packet == nullptr) {
+            return false;
+        }
     }
 
-    ENetPacket* packet = enet_packet_create(data.data(), data.size(), ENET_PACKET_FLAG_RELIABLE);
-
-    if (-1 == enet_peer_send(aPeer, 0, packet)) {
+    if (-1 == enet_peer_send(aPeer, DeliveryChannel(aDelivery), packet)) {
         enet_packet_destroy(packet);
         return false;
     }
 
-    enet_host_flush(mHost.get());
     return true;
 }
 
+bool ENetBase::SendPending(ENetPeer* aPeer)
+{
+    auto* state = static_cast<PeerState*>(aPeer->data);
+    if (!state || state->Pending.Empty()) {
+        return true;
+    }
+
+    bool sent = Send(aPeer, state->Pending.Bytes());
+    state->Pending.Clear();
+    return sent;
+}
+
+std::size_t ENetBase::SendPendingState(ENetPeer* aPeer, std::size_t aBudget)
+{
+    auto* state = static_cast<PeerState*>(aPeer->data);
+    if (!state || state->PendingState.Empty()) {
+        return 0;
+    }
+
+    PacketBatch& batch = state->StateBatch;
+
+    auto send = [&]() {
+        if (!batch.Empty() && !Send(aPeer, batch.Bytes(), true, Delivery::Unreliable)) {
+            mLogger->warn("could not send state updates to {}", *aPeer);
+        }
+        batch.Clear();
+    };
+
+    std::size_t spent = state->PendingState.Drain(aBudget, [&](byte_view aMsg) {
+        if (!batch.Append(aMsg)) {
+            send();
+            batch.Append(aMsg);
+        }
+    });
+    send();
+
+    return spent;
+}
+
+void ENetBase::SetLinkConditioner(const LinkConditions& aConditions, std::uint64_t aSeed)
+{
+    if (!mHost) {
+        throw std::runtime_error("host is not initialized");
+    }
+
+    mConditioner = std::make_unique<LinkConditioner<ENetAddress>>(aConditions, aSeed);
+    // every received datagram is held by the conditioner, deliverConditioned feeds it back
+    mHost->intercept = [](ENetHost* aHost, auto*) -> int {
+        if (tConditioner == nullptr) {
+            return 0;
+        }
+        tConditioner->Submit(
+            LinkConditioner<ENetAddress>::clock_type::now(),
+            aHost->receivedAddress,
+            byte_view(aHost->receivedData, aHost->receivedDataLength));
+        return 1;
+    };
+    mLogger->warn(
+        "link conditioner enabled: {}ms +/- {}ms, {:.1f}% loss, {:.1f}% reordered, {} B/s",
+        aConditions.Latency.count(),
+        aConditions.Jitter.count(),
+        aConditions.LossChance * 100.0,
+        aConditions.ReorderChance * 100.0,
+        aConditions.BandwidthBytesPerSec);
+}
+
+void ENetBase::deliverConditioned()
+{
+    ENetHost* host    = mHost.get();
+    tConditioner      = mConditioner.get();
+    host->serviceTime = enet_time_get();
+
+    mConditioner->Deliver(
+        LinkConditioner<ENetAddress>::clock_type::now(),
+        [host](const ENetAddress& aFrom, byte_buffer& aData) {
+            host->receivedAddress    = aFrom;
+            host->receivedData       = aData.data();
+            host->receivedDataLength = aData.size();
+            // events are queued on the peers and dispatched by the next enet_host_service
+            enet_protocol_handle_incoming_commands(host, nullptr);
+        });
+}
+
+void ENetBase::Flush()
+{
+    if (mHost) {
+        enet_host_flush(mHost.get());
+    }
+}
+
 void ENetBase::Poll()
 {
     // TODO: not propagated if thrown in thread
@@ -76,6 +180,10 @@ void ENetBase::Poll()
     }
     ENetEvent event;
 
+    if (mConditioner) {
+        deliverConditioned();
+    }
+
     /* Wait up to x milliseconds for an event. (WARNING: blocking) */
     while (enet_host_service(mHost.get(), &event, 5) > 0) {
         switch (event.type) {
@@ -113,6 +221,10 @@ void ENetBase::Poll()
                     break;
                 }
 
+                if (Offload(event)) {
+                    break;
+                }
+
                 if (state->SecureSession.Valid()) {
                     byte_view raw{event.packet->data, event.packet->dataLength};
                     byte_view decrypted = state->SecureSession.Decrypt(raw);
@@ -2,13 +2,21 @@
 
 #include <bx/spscqueue.h>
 
+#include <array>
 #include <atomic>
+#include <chrono>
+#include <cstdint>
 #include <entt/signal/dispatcher.hpp>
 #include <entt/signal/emitter.hpp>
+#include <limits>
+#include <memory>
 
 #include "core/crypto/session.hpp"
+#include "core/net/link_conditioner.hpp"
 #include "core/net/net.hpp"
-#include "core/queue/channel.hpp"
+#include "core/net/net_stats.hpp"
+#include "core/net/packet_batch.hpp"
+#include "core/queue/ring_channel.hpp"
 #include "core/sys/log.hpp"
 #include "registry/registry.hpp"
 
@@ -18,13 +26,37 @@ struct PeerState {
 
     CryptoSession SecureSession{};
     PublicKey     PeerPK{};
+    // drawn by the server on connect and handed with the cookie, mixed into the session keys
+    CryptoSession::salt_type SessionSalt{};
+
+    // messages waiting for the next flush, sent as one encrypted packet
+    PacketBatch Pending{};
+    // unreliable state updates waiting for the next flush, superseded per entity
+    LatestStateQueue PendingState{};
+    PacketBatch      StateBatch{};
+    // server side send budget left, in bytes, may go negative after a large reliable batch
+    std::int64_t SendCredit{0};
+    // server side, messages decoded from and queued for the peer
+    PeerTraffic Traffic{};
+    // server side, unauthenticated peers are dropped some time after connecting
+    std::chrono::steady_clock::time_point ConnectedAt{};
+
+    // client side, echoed in front of the sealed handshake, which is kept to be sent again
+    // should the server hand a new cookie
+    decltype(HandshakeCookieResponse::Cookie) Cookie{};
+    bool                                      HasCookie{false};
+    byte_buffer                               SealedHandshake{};
 };
 
 class ENetBase
 {
    public:
-    using channel_response_t = Channel<NetworkResponse>;
-    using channel_request_t  = Channel<NetworkRequest>;
+    // bounded in place channels, sized for a wave of messages between two drains
+    static constexpr std::size_t kRequestCapacity  = 1024;
+    static constexpr std::size_t kResponseCapacity = 4096;
+
+    using channel_response_t = SpscRingChannel<NetworkResponse, kResponseCapacity>;
+    using channel_request_t  = SpscRingChannel<NetworkRequest, kRequestCapacity>;
 
     ENetBase(Logger aLogger) : mRunning(true), mLogger(aLogger) {}
     ENetBase(Logger aLogger, bool aRunning) : mRunning(aRunning), mLogger(aLogger) {}
@@ -53,11 +85,67 @@ class ENetBase
         mReqChannel.Drain(aHandler);
     }
 
-    void EnqueueResponse(NetworkResponse* aEvent) { mRespChannel.Send(aEvent); }
-    void EnqueueRequest(NetworkRequest* aEvent) { mReqChannel.Send(aEvent); }
+    // false when the channel is full, the message is dropped and counted as an overflow
+    bool EnqueueResponse(NetworkResponse&& aEvent)
+    {
+        return mRespChannel.TrySend(std::move(aEvent));
+    }
+    bool EnqueueRequest(NetworkRequest&& aEvent) { return mReqChannel.TrySend(std::move(aEvent)); }
+
+    [[nodiscard]] std::uint64_t ResponseOverflows() const noexcept
+    {
+        return mRespChannel.Overflows();
+    }
+    [[nodiscard]] std::uint64_t RequestOverflows() const noexcept
+    {
+        return mReqChannel.Overflows();
+    }
+
+    /**
+     * @brief Impair every datagram this host receives, for tests and benchmarks over loopback
+     *
+     * Call after Init and before polling. Conditioning both ends of a connection impairs both
+     * directions.
+     */
+    void SetLinkConditioner(const LinkConditions& aConditions, std::uint64_t aSeed);
 
    protected:
-    bool Send(ENetPeer* aPeer, std::span<const uint8_t> aData, bool aEncrypt = true);
+    /**
+     * @brief Encrypt and queue a packet on the peer, does not flush the host
+     */
+    bool Send(
+        ENetPeer*                aPeer,
+        std::span<const uint8_t> aData,
+        bool                     aEncrypt  = true,
+        Delivery                 aDelivery = Delivery::Reliable);
+
+    /**
+     * @brief Send the peer's pending reliable batch as a single packet, if any
+     */
+    bool SendPending(ENetPeer* aPeer);
+
+    /**
+     * @brief Send the peer's most urgent state updates as unreliable packets, within aBudget
+     *
+     * @return number of message bytes sent, deferred updates stay queued
+     */
+    std::size_t SendPendingState(
+        ENetPeer*   aPeer,
+        std::size_t aBudget = std::numeric_limits<std::size_t>::max());
+
+    // push all queued packets to the socket
+    void Flush();
+
+    /**
+     * @brief Take over a received packet before it is decrypted, for decoding elsewhere
+     *
+     * @return true if the packet was taken, it is then neither decrypted nor destroyed here
+     */
+    virtual bool Offload(ENetEvent& aEvent)
+    {
+        BX_UNUSED(aEvent);
+        return false;
+    }
 
     virtual void OnConnect(ENetEvent& aEvent)                  = 0;
     virtual void OnReceive(ENetEvent& aEvent, byte_view aData) = 0;
@@ -69,10 +157,16 @@ class ENetBase
     enet_host_ptr        mHost;
     bx::DefaultAllocator mAlloc;
 
+    std::unique_ptr<LinkConditioner<ENetAddress>> mConditioner;
+
     channel_request_t  mReqChannel;
     channel_response_t mRespChannel;
 
     Logger mLogger;
 
     CryptoKeys mKeys;
+
+   private:
+    // hand the conditioned datagrams that are due over to ENet
+    void deliverConditioned();
 };
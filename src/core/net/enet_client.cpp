@@ -2,7 +2,6 @@
 
 #include <enet.h>
 #include <fmt/core.h>
-#include <sodium/runtime.h>
 #include <spdlog/spdlog.h>
 
 #include <stdexcept>
@@ -62,33 +61,96 @@ void ENetClient::ForceDisconnect()
     mRunning   = false;
 }
 
-void ENetClient::Send(std::span<const uint8_t> aData)
+void ENetClient::Send(std::span<const uint8_t> aData, Delivery aDelivery)
 {
     if (!mPeer || !mPeer->data) return;
 
     auto* state = static_cast<PeerState*>(mPeer->data);
 
+    if (aDelivery == Delivery::Unreliable) {
+        // only the input stream is unreliable, each input request supersedes the previous one
+        state->PendingState.Put(kClientInputKey, aData);
+        return;
+    }
+
+    if (!state->Pending.Append(aData)) {
+        FlushPending();
+        state->Pending.Append(aData);
+    }
+}
+
+void ENetClient::FlushPending()
+{
+    if (!mPeer || !mPeer->data) return;
+
+    auto* state = static_cast<PeerState*>(mPeer->data);
+    if (state->Pending.Empty() && state->PendingState.Empty()) return;
+
     if (!state->SecureSession.Valid()) {
+        // unreliable requests wait for the session, only reliable ones can open it
+        if (state->Pending.Empty()) return;
+
+        // the server opens no sealed box before we echo the cookie it sent on connect
+        if (!state->HasCookie) return;
+
         // Handshake: sealed box with server's public key
-        byte_view enc = state->PeerPK.Encrypt(aData);
+        byte_view enc = state->PeerPK.Encrypt(state->Pending.Bytes());
+        state->Pending.Clear();
         if (enc.empty()) {
             mLogger->error("Could not seal handshake data");
             return;
         }
+        state->SealedHandshake.assign(enc.begin(), enc.end());
 
-        ENetPacket* packet = enet_packet_create(enc.data(), enc.size(), ENET_PACKET_FLAG_RELIABLE);
-        if (-1 == enet_peer_send(mPeer, 0, packet)) {
-            enet_packet_destroy(packet);
+        if (!sendHandshake(*state)) {
             return;
         }
-        enet_host_flush(mHost.get());
 
-        // Init session keys for subsequent AEAD traffic
-        bool hasAESNI = sodium_runtime_has_aesni() != 0;
-        state->SecureSession.Init(mKeys, state->PeerPK.Raw(), hasAESNI, false);
+        // Init session keys for subsequent AEAD traffic, the server answers with the AEAD it
+        // picked among those offered in the auth request
+        state->SecureSession.Init(
+            mKeys,
+            state->PeerPK.Raw(),
+            AEADID::XChaCha20Poly1305,
+            false,
+            state->SessionSalt);
+        state->SecureSession.Offer(SupportedAEADs());
         state->AwaitingHandshake = true;
+    } else if (state->AwaitingHandshake) {
+        // requests wait for the auth response, it settles the AEAD they are encrypted with
+        return;
     } else {
-        ENetBase::Send(mPeer, aData);
+        if (!SendPending(mPeer)) {
+            mLogger->error("Could not send pending requests");
+        }
+        SendPendingState(mPeer);
+    }
+
+    Flush();
+}
+
+bool ENetClient::sendHandshake(const PeerState& aState)
+{
+    byte_buffer packet(aState.Cookie.begin(), aState.Cookie.end());
+    packet.insert(packet.end(), aState.SealedHandshake.begin(), aState.SealedHandshake.end());
+    return ENetBase::Send(mPeer, packet, false);
+}
+
+void ENetClient::onCookie(const HandshakeCookieResponse& aCookie)
+{
+    auto* state = static_cast<PeerState*>(mPeer->data);
+    if (!state) return;
+
+    state->Cookie      = aCookie.Cookie;
+    state->SessionSalt = aCookie.Salt;
+    state->HasCookie   = true;
+
+    // a new cookie while waiting for the auth response means ours was refused
+    if (state->AwaitingHandshake && !state->SealedHandshake.empty()) {
+        mLogger->debug("handshake cookie refreshed, sending handshake again");
+        if (sendHandshake(*state)) {
+            Flush();
+        }
     }
 }
 
@@ -96,30 +158,45 @@ void ENetClient::OnConnect(ENetEvent& aEvent)
 {
     BX_UNUSED(aEvent);
     // TODO: better player ID handling
-    mRespChannel.Send(new NetworkResponse{
-        .Type     = PacketType::Connected,
-        .PlayerID = 0,
-        .Tick     = 0,
-        .Payload  = ConnectedResponse{},
-    });
+    if (!EnqueueResponse(NetworkResponse{
+            .Type     = PacketType::Connected,
+            .PlayerID = 0,
+            .Tick     = 0,
+            .Payload  = ConnectedResponse{},
+        })) {
+        mLogger->error("response channel full, dropping connected response");
+    }
     mConnected = true;
 }
 
 void ENetClient::OnReceive(ENetEvent& aEvent, byte_view aData)
 {
-    BitInputArchive archive(aData, true);
-    auto*           ev = new NetworkResponse;
-
-    if (!ev->Archive(archive)) {
-        mLogger->error(
-            "failed to deserialize NetworkResponse (packet size: {} bytes)",
-            aEvent.packet->dataLength);
-        delete ev;
-        return;
-    }
+    auto handler = [&](byte_view aMsg) {
+        BitInputArchive archive(aMsg, true);
+        NetworkResponse ev;
+
+        if (!ev.Archive(archive)) {
+            mLogger->error(
+                "failed to deserialize NetworkResponse (message size: {} bytes, packet size: {} "
+                "bytes)",
+                aMsg.size(),
+                aEvent.packet->dataLength);
+            return;
+        }
 
-    mLogger->trace("received {}", *ev);
-    EnqueueResponse(ev);
+        mLogger->trace("received {}", ev);
+        if (const auto* cookie = std::get_if<HandshakeCookieResponse>(&ev.Payload)) {
+            onCookie(*cookie);
+            return;
+        }
+        if (!EnqueueResponse(std::move(ev))) {
+            mLogger->error("response channel full, dropping response");
+        }
+    };
+
+    if (!PacketBatch::ForEach(aData, handler)) {
+        mLogger->error("malformed packet batch ({} bytes)", aEvent.packet->dataLength);
+    }
 }
 
 void ENetClient::OnDisconnect(ENetEvent& aEvent)
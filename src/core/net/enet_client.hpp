@@ -22,22 +22,28 @@ class ENetClient : public ENetBase
     void Disconnect();
     void ForceDisconnect();
 
-    void Send(std::span<const uint8_t> aData);
+    // queue an archived request, sent on the next FlushPending
+    void Send(std::span<const uint8_t> aData, Delivery aDelivery = Delivery::Reliable);
+    void FlushPending();
 
     [[nodiscard]] bool Connected() const noexcept { return mConnected; }
 
+    // Must be called from the network thread, changes on ResetSession
     const CryptoKeys::Public RawPublicKey() const { return mKeys.RawPublicKey(); }
 
     void SetServerPK(const CryptoKeys::Public& aPubKey) { mServerPK = PublicKey(aPubKey); }
 
-    // Must be called from the network thread
+    // Must be called from the network thread, a new session needs a new key pair since
+    // AEAD nonces are counters restarting at 0
     void ResetSession()
     {
+        mKeys.Regenerate();
         if (mPeer != nullptr && mPeer->data != nullptr) {
             auto* state = static_cast<PeerState*>(mPeer->data);
             state->SecureSession.Reset();
             state->PeerPK            = mServerPK;
             state->AwaitingHandshake = false;
+            state->SealedHandshake.clear();
         }
     }
 
@@ -56,6 +62,13 @@ class ENetClient : public ENetBase
     std::atomic_bool mConnected;
 
    private:
+    static constexpr LatestStateQueue::key_type kClientInputKey = 0;
+
+    // cookie followed by the sealed handshake, in clear
+    bool sendHandshake(const PeerState& aState);
+    // handled on the network thread, the game never sees cookies
+    void onCookie(const HandshakeCookieResponse& aCookie);
+
     ENetPeer* mPeer;
 
     ::PublicKey mServerPK{};
@@ -1,15 +1,16 @@
 #include "core/net/enet_server.hpp"
 
-#include <bx/spscqueue.h>
 #include <enet.h>
-#include <sodium/runtime.h>
 #include <spdlog/spdlog.h>
 
+#include <algorithm>
+#include <chrono>
 #include <expected>
 #include <span>
 #include <stdexcept>
 
 #include "components/player.hpp"
+#include "core/crypto/aead_calibration.hpp"
 #include "core/net/net.hpp"
 #include "core/net/pocketbase.hpp"
 #include "core/snapshot.hpp"
@@ -17,8 +18,6 @@
 
 void ENetServer::Init()
 {
-    ENetBase::Init();
-
     const std::size_t pos  = mServerAddr.find(':');
     enet_uint16       port = 7777;
     std::string       host = mServerAddr;
@@ -39,23 +38,116 @@ void ENetServer::Init()
         }
     }
 
-    mHost = enet_host_ptr{enet_host_create(&address, 128, 2, 0, 0)};
+    // fastest first on this machine, the server pays for every peer while a client has only one
+    std::vector<AEADTiming> timings;
+    mCiphers = RankAEADs(kCalibrationSizes, kCalibrationIterations, &timings);
+    for (const auto& timing : timings) {
+        mLogger->debug(
+            "{} {}B: encrypt {:.0f}ns, decrypt {:.0f}ns, {:.0f}MB/s",
+            AEADFromID(timing.ID)->Name,
+            timing.MessageBytes,
+            timing.EncryptNs,
+            timing.DecryptNs,
+            timing.MBPerSec());
+    }
+    if (mCiphers.empty()) {
+        mLogger->error("no usable AEAD");
+        return;
+    }
+    mLogger->info("preferred AEAD: {}", AEADFromID(mCiphers.front())->Name);
+
+    const bool reusePort = mShardCount > 1;
+
+    mShards.clear();
+    for (std::size_t idx = 0; idx < mShardCount; ++idx) {
+        auto shard = std::make_unique<ENetServerShard>(
+            idx,
+            address,
+            mMaxPeers,
+            reusePort,
+            mKeys,
+            mCiphers,
+            mLogger,
+            mTokens,
+            mSendBudget);
+
+        shard->Init();
+        if (!shard->IsInit()) {
+            mShards.clear();
+            return;
+        }
+        if (mLink.Active()) {
+            shard->SetLinkConditioner(mLink, mLinkSeed + idx);
+        }
+        shard->StartDecodeWorkers(mDecodeWorkers);
+        mShards.push_back(std::move(shard));
+    }
+    mLogger->info(
+        "created ENet server at {}:{}, {} shard(s) of {} peers",
+        host,
+        port,
+        mShardCount,
+        mMaxPeers);
+}
+
+void ENetServerShard::Init()
+{
+    ENetBase::Init();
+
+    // created unbound so that SO_REUSEPORT can be set before binding the shared port
+    mHost = enet_host_ptr{
+        enet_host_create(nullptr, mMaxPeers, std::size_t(Delivery::Count), 0, 0)};
 
     if (!mHost) {
         mLogger->error("An error occurred while trying to create an ENet server host.");
         return;
     }
-    mLogger->info("created ENet server at {}:{}", host, port);
+
+    if (mReusePort) {
+#ifdef SO_REUSEPORT
+        int enable = 1;
+        if (0 != setsockopt(mHost->socket, SOL_SOCKET, SO_REUSEPORT, &enable, sizeof(enable))) {
+            mLogger->error("could not enable SO_REUSEPORT on shard {}", mIndex);
+            mHost.reset();
+            return;
+        }
+#else
+        mLogger->error("SO_REUSEPORT is not available, cannot run more than one shard");
+        mHost.reset();
+        return;
+#endif
+    }
+
+    if (enet_socket_bind(mHost->socket, &mAddress) < 0) {
+        mLogger->error("could not bind ENet server shard {}", mIndex);
+        mHost.reset();
+        return;
+    }
+    if (enet_socket_get_address(mHost->socket, &mHost->address) < 0) {
+        mHost->address = mAddress;
+    }
+
+    mLogger->debug("created ENet server shard {} with {} peers", mIndex, mMaxPeers);
 }
 
-void ENetServer::OnConnect(ENetEvent& aEvent)
+void ENetServerShard::OnConnect(ENetEvent& aEvent)
 {
-    auto* state       = new PeerState{.ID = 0};
-    aEvent.peer->data = state;
+    if (!mHandshakes.BeginPending()) {
+        mHandshakes.Count(HandshakeDrop::TooManyPending);
+        mLogger->debug("{} pending handshakes, refusing {}", mHandshakes.Pending(), *aEvent.peer);
+        enet_peer_disconnect_now(aEvent.peer, 0);
+        return;
+    }
+
+    auto* state        = new PeerState{.ID = 0};
+    state->ConnectedAt = clock_type::now();
+    state->SessionSalt = CryptoSession::MakeSalt();
+    aEvent.peer->data  = state;
     mLogger->info("peer connected, awaiting auth");
+    sendCookie(aEvent.peer);
 }
 
-void ENetServer::OnReceive(ENetEvent& aEvent, byte_view aData)
+void ENetServerShard::OnReceive(ENetEvent& aEvent, byte_view aData)
 {
     if (aData.empty()) {
         return;
@@ -63,80 +155,440 @@ void ENetServer::OnReceive(ENetEvent& aEvent, byte_view aData)
 
     auto* state = static_cast<PeerState*>(aEvent.peer->data);
 
-    // Pre-session: sealed box from client handshake
+    // Pre-session: cookie then sealed box from client handshake, the cheap checks come first
     if (state && !state->SecureSession.Valid()) {
-        byte_view decrypted = mKeys.Decrypt(aData);
-        if (decrypted.empty()) {
-            mLogger->error("Could not open sealed handshake");
-            BitOutputArchive out;
-            NetworkResponse  resp{
-                 .Type     = PacketType::Nack,
-                 .PlayerID = 0,
-                 .Tick     = 0,
-                 .Payload  = ErrorResponse{.Error = ServerError::HandshakeOpenSeal}};
-
-            if (!resp.Archive(out)) {
-                mLogger->error("Could not archive error response");
-                return;
-            }
+        const auto         now     = clock_type::now();
+        const ENetAddress& address = aEvent.peer->address;
 
-            if (!ENetBase::Send(aEvent.peer, out.Bytes(), false)) {
-                mLogger->error("Could send error response");
-                return;
+        if (aData.size() <= HandshakeGuard::kCookieBytes
+            || !mHandshakes.CheckCookie(
+                address,
+                aData.first(HandshakeGuard::kCookieBytes),
+                now)) {
+            mHandshakes.Count(HandshakeDrop::BadCookie);
+            mLogger->debug("bad handshake cookie from {}", *aEvent.peer);
+            // the previous one may have expired, nothing is opened until the new one comes back
+            if (mHandshakes.Allow(address, now)) {
+                sendCookie(aEvent.peer);
             }
             return;
         }
+        if (!mHandshakes.Allow(address, now)) {
+            mHandshakes.Count(HandshakeDrop::RateLimited);
+            mLogger->debug("handshake rate limited for {}", *aEvent.peer);
+            return;
+        }
+
+        byte_view decrypted = mKeys.Decrypt(aData.subspan(HandshakeGuard::kCookieBytes));
+        if (decrypted.empty()) {
+            mHandshakes.Count(HandshakeDrop::SealOpenFailed);
+            mLogger->error("Could not open sealed handshake");
+            sendError(aEvent.peer, ServerError::HandshakeOpenSeal);
+            return;
+        }
         aData = decrypted;
     }
 
+    auto handler = [&](byte_view aMsg) { onMessage(aEvent.peer, state, aMsg); };
+    if (!PacketBatch::ForEach(aData, handler)) {
+        mLogger->error("malformed packet batch from {}", *aEvent.peer);
+    }
+}
+
+void ENetServerShard::onMessage(ENetPeer* aPeer, PeerState* aState, byte_view aData)
+{
     BitInputArchive archive(aData);
-    auto*           ev = new NetworkRequest;
+    NetworkRequest  ev;
 
-    if (!ev->Archive(archive)) {
+    if (!ev.Archive(archive)) {
         mLogger->critical("cannot decode packet");
-        delete ev;
         return;
     }
 
-    if (ev->Type == PacketType::Auth) {
-        auto  auth = std::get<AuthRequest>(ev->Payload);
-        auto* peer = aEvent.peer;
-
-        mPBClient.RefreshToken(
-            [peer,
-             &chan    = mAuthResultChan,
-             logger   = mLogger,
-             hasAESNI = auth.HasAESNI,
-             pub      = auth.PublicKey](std::expected<LoginResult, PBError> aResult) {
-                if (aResult) {
-                    auto playerID = IDFromHexString<PlayerID>(aResult->record.id);
-                    if (playerID) {
-                        chan.Send(new AuthResult{
-                            .Peer        = peer,
-                            .ID          = *playerID,
-                            .AccountName = aResult->record.accountName,
-                            .HasAESNI    = hasAESNI,
-                            .PublicKey   = pub});
-                        return;
-                    }
+    if (ev.Type == PacketType::Auth) {
+        auto auth = std::get<AuthRequest>(ev.Payload);
+
+        // answered right away for a token verified recently, the result is still posted so that
+        // peers are always registered from ProcessAuthResults
+        mTokens.Resolve(
+            auth.Token,
+            [aPeer,
+             &chan   = mAuthResultChan,
+             logger  = mLogger,
+             ciphers = auth.Ciphers,
+             pub     = auth.PublicKey](const AuthTokenCache::result_type& aResult) {
+                if (!aResult) {
+                    logger->warn("auth verification failed: {}", aResult.error());
+                    return;
+                }
+
+                bool queued = chan.TrySend(AuthResult{
+                    .Peer        = aPeer,
+                    .ID          = aResult->ID,
+                    .AccountName = aResult->AccountName,
+                    .Ciphers     = ciphers,
+                    .PublicKey   = pub});
+                if (!queued) {
+                    logger->error("auth channel full, dropping player {}", aResult->ID);
                 }
-                logger->warn("auth verification failed: {}", aResult.error().Message);
-            },
-            auth.Token);
-        delete ev;
+            });
         return;
     }
 
-    if (!state || state->ID == 0) {
+    if (!aState || aState->ID == 0) {
         mLogger->warn("dropping packet from unauthenticated peer");
-        delete ev;
         return;
     }
-    ev->PlayerID = state->ID;
-    mReqChannel.Send(ev);
+    ev.PlayerID = aState->ID;
+    aState->Traffic.CountIn(ev.Type, aData.size());
+    if (!EnqueueRequest(std::move(ev))) {
+        mLogger->warn("request channel full, dropping request from player {}", aState->ID);
+    }
+}
+
+std::optional<AEADID> ENetServerShard::pickCipher(AEADMask aOffered) const
+{
+    for (AEADID id : mCiphers) {
+        if (aOffered & AEADBit(id)) {
+            return id;
+        }
+    }
+    return std::nullopt;
+}
+
+void ENetServerShard::sendError(ENetPeer* aPeer, ServerError aError)
+{
+    NetworkResponse resp{
+        .Type     = PacketType::Nack,
+        .PlayerID = 0,
+        .Tick     = 0,
+        .Payload  = ErrorResponse{.Error = aError}};
+
+    if (!sendClear(aPeer, resp)) {
+        mLogger->error("Could not send error response");
+    }
+}
+
+void ENetServerShard::sendCookie(ENetPeer* aPeer)
+{
+    const auto*     state  = static_cast<PeerState*>(aPeer->data);
+    const auto      cookie = mHandshakes.Cookie(aPeer->address, clock_type::now());
+    NetworkResponse resp{
+        .Type     = PacketType::HandshakeCookie,
+        .PlayerID = 0,
+        .Tick     = 0,
+        .Payload  = HandshakeCookieResponse{.Cookie = cookie, .Salt = state->SessionSalt}};
+
+    if (!sendClear(aPeer, resp)) {
+        mLogger->error("Could not send handshake cookie");
+    }
+}
+
+bool ENetServerShard::sendClear(ENetPeer* aPeer, NetworkResponse& aResp)
+{
+    mArchive.Clear();
+    if (!aResp.Archive(mArchive)) {
+        return false;
+    }
+
+    // no session yet: sent in clear, outside of the peer batch
+    PacketBatch batch;
+    batch.Append(mArchive.Bytes());
+    if (!ENetBase::Send(aPeer, batch.Bytes(), false)) {
+        return false;
+    }
+    Flush();
+    return true;
+}
+
+bool ENetServerShard::Queue(PlayerID aID, PacketType aType, byte_view aData)
+{
+    auto it = mConnectedPeers.find(aID);
+    if (it == mConnectedPeers.end()) {
+        return false;
+    }
+
+    ENetPeer* peer  = it->second;
+    auto*     state = static_cast<PeerState*>(peer->data);
+    if (!state) {
+        return false;
+    }
+
+    if (!state->Pending.Append(aData)) {
+        // batch is full, send it now and start a new one
+        state->SendCredit -= std::int64_t(state->Pending.Bytes().size());
+        if (!SendPending(peer)) {
+            return false;
+        }
+        state->Pending.Append(aData);
+    }
+    state->Traffic.CountOut(aType, aData.size());
+    return true;
+}
+
+bool ENetServerShard::QueueStateUpdate(
+    PlayerID                        aID,
+    PacketType                      aType,
+    LatestStateQueue::key_type      aKey,
+    byte_view                       aData,
+    LatestStateQueue::priority_type aWeight)
+{
+    auto it = mConnectedPeers.find(aID);
+    if (it == mConnectedPeers.end()) {
+        return false;
+    }
+
+    auto* state = static_cast<PeerState*>(it->second->data);
+    if (!state) {
+        return false;
+    }
+
+    state->PendingState.Put(aKey, aData, aWeight);
+    state->Traffic.CountOut(aType, aData.size());
+    return true;
+}
+
+void ENetServer::BroadcastResponse(
+    const std::span<const PlayerID>                  aPlayers,
+    PacketType                                       aType,
+    uint32_t                                         aTick,
+    NetworkResponsePayload                           aPayload,
+    std::span<const LatestStateQueue::priority_type> aWeights)
+{
+    if (aPlayers.empty()) {
+        return;
+    }
+
+    NetworkResponse resp{
+        .Type     = aType,
+        .PlayerID = 0,
+        .Tick     = aTick,
+        .Payload  = std::move(aPayload),
+    };
+
+    mArchive.Clear();
+    if (!resp.Archive(mArchive)) {
+        mLogger->error("could not archive response {}", resp);
+        return;
+    }
+
+    const auto bytes  = mArchive.Bytes();
+    auto       shared = std::make_shared<const byte_buffer>(bytes.begin(), bytes.end());
+    auto       key    = SupersedeKey(resp);
+
+    // players not routed yet may be on any shard, a shard skips recipients it does not own
+    for (auto& shard : mShards) {
+        OutgoingResponse out{.Bytes = shared, .Key = key, .Type = aType, .Tick = aTick};
+
+        for (std::size_t i = 0; i < aPlayers.size(); ++i) {
+            auto route = mPlayerShards.find(aPlayers[i]);
+            if (route != mPlayerShards.end() && route->second != shard->Index()) {
+                continue;
+            }
+
+            out.Weights[out.RecipientCount]      = aWeights.empty() ? 1 : aWeights[i];
+            out.Recipients[out.RecipientCount++] = aPlayers[i];
+
+            if (out.RecipientCount == OutgoingResponse::kMaxRecipients) {
+                postTo(*shard, out);
+                out.RecipientCount = 0;
+            }
+        }
+
+        if (out.RecipientCount > 0) {
+            postTo(*shard, out);
+        }
+    }
+}
+
+void ENetServer::verifyToken(
+    PocketBaseClient&             aPBClient,
+    const std::string&            aToken,
+    AuthTokenCache::callback_type aDone)
+{
+    aPBClient.RefreshToken(
+        [done = std::move(aDone)](std::expected<LoginResult, PBError> aResult) {
+            if (!aResult) {
+                done(std::unexpected(aResult.error().Message));
+                return;
+            }
+
+            auto playerID = IDFromHexString<PlayerID>(aResult->record.id);
+            if (!playerID) {
+                done(std::unexpected("invalid player ID '" + aResult->record.id + "'"));
+                return;
+            }
+            done(VerifiedToken{.ID = *playerID, .AccountName = aResult->record.accountName});
+        },
+        aToken);
+}
+
+void ENetServer::postTo(ENetServerShard& aShard, const OutgoingResponse& aOut)
+{
+    if (!aShard.Post(aOut)) {
+        mLogger->error(
+            "outgoing channel of shard {} full, dropping packet type {} at tick {}",
+            aShard.Index(),
+            uint16_t(aOut.Type),
+            aOut.Tick);
+    }
+}
+
+void ENetServerShard::ProcessOutgoing()
+{
+    mOutgoingChan.Drain([this](OutgoingResponse* aOut) {
+        const byte_view bytes(*aOut->Bytes);
+
+        for (std::size_t i = 0; i < aOut->RecipientCount; ++i) {
+            const PlayerID id = aOut->Recipients[i];
+
+            bool queued = false;
+            if (aOut->Key) {
+                queued = QueueStateUpdate(id, aOut->Type, *aOut->Key, bytes, aOut->Weights[i]);
+            } else {
+                queued = Queue(id, aOut->Type, bytes);
+            }
+            if (!queued) {
+                mLogger->debug("player {} is not connected to shard {}", id, mIndex);
+            }
+        }
+        mLogger->trace(
+            "queued packet type {} at tick {} for {} players",
+            uint16_t(aOut->Type),
+            aOut->Tick,
+            aOut->RecipientCount);
+    });
+}
+
+void ENetServerShard::FlushPending()
+{
+    using tick_type = std::chrono::duration<double, std::ratio<1, 60>>;
+
+    const auto   now     = clock_type::now();
+    const double elapsed = std::chrono::duration_cast<tick_type>(now - mLastFlush).count();
+    const auto   budget  = std::int64_t(mSendBudget);
+    const auto   refill  = std::int64_t(double(mSendBudget) * elapsed);
+    mLastFlush           = now;
+
+    if (now - mLastStats >= kStatsInterval) {
+        mLastStats = now;
+        sampleStats();
+    }
+
+    bool sent = false;
+
+    for (auto& [id, peer] : mConnectedPeers) {
+        auto* state = static_cast<PeerState*>(peer->data);
+        if (!state) {
+            continue;
+        }
+
+        // credit is capped to one tick worth so an idle peer cannot burst
+        state->SendCredit = std::min(state->SendCredit + refill, budget);
+
+        if (!state->Pending.Empty()) {
+            state->SendCredit -= std::int64_t(state->Pending.Bytes().size());
+            if (!SendPending(peer)) {
+                mLogger->error("could not send pending batch to player {}", id);
+            }
+            sent = true;
+        }
+
+        if (!state->PendingState.Empty() && state->SendCredit > 0) {
+            std::size_t spent = SendPendingState(peer, std::size_t(state->SendCredit));
+            state->SendCredit -= std::int64_t(spent);
+            sent               = sent || spent > 0;
+        }
+    }
+
+    if (sent) {
+        Flush();
+    }
+}
+
+void ENetServerShard::sampleStats()
+{
+    // a stats update deferred by a congested link should not wait behind a whole wave of entities
+    constexpr LatestStateQueue::priority_type kStatsWeight = 8;
+    constexpr uint32_t                        kMaxRTT      = 60000;
+
+    NetTotals totals{
+        .ChannelOverflows =
+            RequestOverflows() + mOutgoingChan.Overflows() + mAuthResultChan.Overflows()
+            + (mDecodePool ? mDecodePool->Overflows() : 0),
+    };
+
+    for (auto& [id, peer] : mConnectedPeers) {
+        auto* state = static_cast<PeerState*>(peer->data);
+        if (!state) {
+            continue;
+        }
+
+        const float loss = float(peer->packetLoss) / float(ENET_PEER_PACKET_LOSS_SCALE);
+
+        // ENet counts a reliable packet lost each time it times out and is resent
+        NetworkStatsResponse stats{
+            .RTT                   = std::min<uint32_t>(peer->roundTripTime, kMaxRTT),
+            .RTTVariance           = std::min<uint32_t>(peer->roundTripTimeVariance, kMaxRTT),
+            .PacketLoss            = std::min(loss, 1.0f),
+            .ReliableInFlight      = uint32_t(enet_list_size(&peer->sentReliableCommands)),
+            .ReliableBytesInFlight = peer->reliableDataInTransit,
+            .Retransmits           = enet_peer_get_packets_lost(peer),
+            .Traffic               = state->Traffic.Summary(),
+        };
+
+        const auto in  = PeerTraffic::Total(state->Traffic.In);
+        const auto out = PeerTraffic::Total(state->Traffic.Out);
+
+        totals.Peers         += 1;
+        totals.PacketsIn     += in.Packets;
+        totals.BytesIn       += in.Bytes;
+        totals.PacketsOut    += out.Packets;
+        totals.BytesOut      += out.Bytes;
+        totals.Retransmits   += stats.Retransmits;
+        totals.MaxRTT         = std::max(totals.MaxRTT, stats.RTT);
+        totals.MaxPacketLoss  = std::max(totals.MaxPacketLoss, stats.PacketLoss);
+
+        mLogger->debug(
+            "player {}: rtt {}ms +/- {}ms, loss {:.1f}%, {} reliable in flight, {} retransmits",
+            id,
+            stats.RTT,
+            stats.RTTVariance,
+            stats.PacketLoss * 100.0f,
+            stats.ReliableInFlight,
+            stats.Retransmits);
+
+        NetworkResponse resp{
+            .Type     = PacketType::NetworkStats,
+            .PlayerID = 0,
+            .Tick     = 0,
+            .Payload  = std::move(stats),
+        };
+        mArchive.Clear();
+        if (!resp.Archive(mArchive)) {
+            mLogger->error("could not archive network stats of player {}", id);
+            continue;
+        }
+        QueueStateUpdate(id, resp.Type, kNetworkStatsKey, mArchive.Bytes(), kStatsWeight);
+    }
+
+    mTotals.Publish(totals);
+
+    // a peer that never authenticates would hold its pending slot for as long as it pings
+    const auto now = clock_type::now();
+    for (std::size_t idx = 0; idx < mHost->peerCount; ++idx) {
+        ENetPeer* peer  = &mHost->peers[idx];
+        auto*     state = static_cast<PeerState*>(peer->data);
+        if (peer->state == ENET_PEER_STATE_CONNECTED && state && state->ID == 0
+            && now - state->ConnectedAt > HandshakeGuard::kPendingTimeout) {
+            mLogger->debug("{} did not authenticate in time", *peer);
+            enet_peer_disconnect(peer, 0);
+        }
+    }
+    mHandshakes.Prune(now);
 }
 
-void ENetServer::ProcessAuthResults()
+void ENetServerShard::ProcessAuthResults()
 {
     mAuthResultChan.Drain([this](AuthResult* aResult) {
         if (aResult->Peer->state != ENET_PEER_STATE_CONNECTED) {
@@ -144,19 +596,44 @@ void ENetServer::ProcessAuthResults()
             return;
         }
 
-        auto* state   = static_cast<PeerState*>(aResult->Peer->data);
-        state->ID     = aResult->ID;
-        bool canAEGIS = aResult->HasAESNI && (sodium_runtime_has_aesni() != 0);
+        auto cipher = pickCipher(aResult->Ciphers);
+        if (!cipher) {
+            mLogger->warn("player {} offered no supported cipher", aResult->ID);
+            sendError(aResult->Peer, ServerError::NoCommonCipher);
+            return;
+        }
+
+        auto* state = static_cast<PeerState*>(aResult->Peer->data);
+        if (state->ID != 0) {
+            // the session may be in use by a decode worker, it is never rekeyed in place
+            mLogger->warn("player {} is already authenticated", state->ID);
+            return;
+        }
 
-        state->SecureSession.Init(mKeys, aResult->PublicKey, canAEGIS, true);
+        // still pending until the session is up, a failed peer is pruned like any other
+        state->SecureSession.Init(mKeys, aResult->PublicKey, *cipher, true, state->SessionSalt);
         if (!state->SecureSession.Valid()) {
-            mLogger->error("cannot compute server session keys");
+            mLogger->error("cannot compute server session keys for player {}", aResult->ID);
+            sendError(aResult->Peer, ServerError::SessionKeys);
+            enet_peer_disconnect_later(aResult->Peer, 0);
             return;
         }
+        state->ID = aResult->ID;
+        mHandshakes.EndPending();
         state->AwaitingHandshake = true;
 
         mConnectedPeers[aResult->ID] = aResult->Peer;
         mAccountNames[aResult->ID]   = aResult->AccountName;
+
+        // lets the game thread route this player's responses to this shard
+        if (!EnqueueRequest(NetworkRequest{
+                .Type     = PacketType::Connected,
+                .PlayerID = aResult->ID,
+                .Tick     = 0,
+                .Payload  = std::monostate{},
+            })) {
+            mLogger->error("request channel full, player {} will not be routed", aResult->ID);
+        }
         mLogger->info(
             "player {} ({}) authenticated and registered",
             aResult->ID,
@@ -166,33 +643,97 @@ void ENetServer::ProcessAuthResults()
             .Type     = PacketType::Auth,
             .PlayerID = aResult->ID,
             .Tick     = 0,
-            .Payload  = AuthResponse{.ID = aResult->ID, .HasAESNI = canAEGIS, .Success = true}};
-        BitOutputArchive archive;
-        resp.Archive(archive);
-        Send(resp.PlayerID, archive.Bytes());
+            .Payload  = AuthResponse{.ID = aResult->ID, .Cipher = *cipher, .Success = true}};
+        mArchive.Clear();
+        resp.Archive(mArchive);
+        Queue(resp.PlayerID, resp.Type, mArchive.Bytes());
     });
 }
 
-void ENetServer::OnDisconnect(ENetEvent& aEvent)
+void ENetServerShard::OnDisconnect(ENetEvent& aEvent)
 {
     if (auto* state = static_cast<PeerState*>(aEvent.peer->data)) {
         mLogger->info("player {} disconnected", state->ID);
-        mConnectedPeers.erase(state->ID);
-        mAccountNames.erase(state->ID);
-        delete state;
-        aEvent.peer->data = nullptr;
+        releasePeer(aEvent.peer);
     }
 }
 
-void ENetServer::OnDisconnectTimeout(ENetEvent& aEvent)
+void ENetServerShard::OnDisconnectTimeout(ENetEvent& aEvent)
 {
     if (auto* state = static_cast<PeerState*>(aEvent.peer->data)) {
         mLogger->warn("player {} timed out", state->ID);
-        mConnectedPeers.erase(state->ID);
-        mAccountNames.erase(state->ID);
+        releasePeer(aEvent.peer);
+    }
+}
+
+void ENetServerShard::releasePeer(ENetPeer* aPeer)
+{
+    auto* state = static_cast<PeerState*>(aPeer->data);
+    mConnectedPeers.erase(state->ID);
+    mAccountNames.erase(state->ID);
+    aPeer->data = nullptr;
+
+    if (state->ID == 0) {
+        mHandshakes.EndPending();
+    }
+    if (!mDecodePool || state->ID == 0) {
         delete state;
-        aEvent.peer->data = nullptr;
+        return;
+    }
+
+    // queued behind the peer's packets, the worker deletes the state after decoding them, on a
+    // full queue the shard retries from its loop instead of stalling the network thread
+    DecodeJob retire{.State = state, .ID = state->ID, .Retire = true};
+    if (!mDecodePool->Post(std::move(retire))) {
+        mRetiring.push_back(retire);
+    }
+}
+
+void ENetServerShard::ProcessRetiring()
+{
+    if (mRetiring.empty() || !mDecodePool) {
+        return;
+    }
+    // the packets of a peer were all posted before it was released, only its retire waits
+    std::erase_if(mRetiring, [this](DecodeJob& aJob) {
+        return mDecodePool->Post(std::move(aJob));
+    });
+}
+
+ENetServerShard::~ENetServerShard()
+{
+    // joined first, no worker can still use the states left to retire
+    mDecodePool.reset();
+    for (DecodeJob& job : mRetiring) {
+        delete job.State;
+    }
+}
+
+void ENetServerShard::StartDecodeWorkers(std::size_t aWorkers)
+{
+    if (aWorkers == 0) {
+        mDecodePool.reset();
+        return;
+    }
+    mDecodePool = std::make_unique<DecodePool>(aWorkers, mLogger);
+    mLogger->info("shard {}: {} decode worker(s)", mIndex, aWorkers);
+}
+
+bool ENetServerShard::Offload(ENetEvent& aEvent)
+{
+    auto* state = static_cast<PeerState*>(aEvent.peer->data);
+    // the handshake and its sealed box stay on the network thread
+    if (!mDecodePool || state->ID == 0 || !state->SecureSession.Valid()) {
+        return false;
+    }
+
+    DecodeJob job{.Packet = aEvent.packet, .State = state, .ID = state->ID};
+    if (!mDecodePool->Post(std::move(job))) {
+        mLogger->warn("decode queue full, dropping packet from player {}", state->ID);
+        enet_packet_destroy(aEvent.packet);
     }
+    aEvent.packet = nullptr;
+    return true;
 }
 
-void ENetServer::OnNone(ENetEvent&) {}
+void ENetServerShard::OnNone(ENetEvent&) {}
@@ -1,10 +1,22 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <memory>
+#include <optional>
+#include <span>
 #include <unordered_map>
+#include <vector>
 
 #include "core/crypto/session.hpp"
+#include "core/net/decode_pool.hpp"
 #include "core/net/enet_base.hpp"
+#include "core/net/handshake_guard.hpp"
 #include "core/net/net.hpp"
+#include "core/net/net_stats.hpp"
+#include "core/net/token_cache.hpp"
+#include "core/snapshot.hpp"
 #include "core/sys/log.hpp"
 
 class PocketBaseClient;
@@ -13,17 +25,240 @@ struct AuthResult {
     ENetPeer*          Peer;
     PlayerID           ID;
     std::string        AccountName;
-    bool               HasAESNI;
+    AEADMask           Ciphers;
     CryptoKeys::Public PublicKey;
 };
 
-class ENetServer : public ENetBase
+/**
+ * @brief Response archived once, shared by all its recipients
+ *
+ * Archived with a null PlayerID: the recipient is implied by the peer it is sent to. Broadcasts to
+ * more than kMaxRecipients players are split in several messages sharing the same bytes.
+ */
+struct OutgoingResponse {
+    static constexpr std::size_t kMaxRecipients = 8;
+
+    using weight_type = LatestStateQueue::priority_type;
+
+    std::shared_ptr<const byte_buffer>        Bytes;
+    std::array<PlayerID, kMaxRecipients>      Recipients{};
+    std::array<weight_type, kMaxRecipients>   Weights{};  // state update priority weights
+    std::size_t                               RecipientCount{0};
+    std::optional<LatestStateQueue::key_type> Key{};
+    PacketType                                Type{PacketType::Ack};
+    uint32_t                                  Tick{0};
+};
+
+/**
+ * @brief One ENet host and the peers it owns, serviced by a single network thread
+ *
+ * Shards bind the same port with SO_REUSEPORT, the kernel then hashes each client address to one
+ * of the sockets so a peer always lands on the same shard.
+ */
+class ENetServerShard : public ENetBase
 {
-    using peer_map = std::unordered_map<PlayerID, ENetPeer*>;
+    using peer_map   = std::unordered_map<PlayerID, ENetPeer*>;
+    using clock_type = std::chrono::steady_clock;
+
+    static constexpr std::size_t kAuthCapacity     = 256;
+    static constexpr std::size_t kOutgoingCapacity = 4096;
+
+    // how often peers get their link statistics and the shard totals are published
+    static constexpr auto kStatsInterval = std::chrono::seconds(1);
 
    public:
-    ENetServer(const std::string& aSrvAddr, Logger aLogger, PocketBaseClient& aPBClient)
-        : ENetBase(aLogger, false), mServerAddr(aSrvAddr), mPBClient(aPBClient)
+    ENetServerShard(
+        std::size_t             aIndex,
+        const ENetAddress&      aAddress,
+        std::size_t             aMaxPeers,
+        bool                    aReusePort,
+        const CryptoKeys&       aKeys,
+        std::span<const AEADID> aCiphers,
+        Logger                  aLogger,
+        AuthTokenCache&         aTokens,
+        std::size_t             aSendBudget)
+        : ENetBase(aLogger, false),
+          mIndex(aIndex),
+          mAddress(aAddress),
+          mMaxPeers(aMaxPeers),
+          mReusePort(aReusePort),
+          mCiphers(aCiphers.begin(), aCiphers.end()),
+          mTokens(aTokens),
+          mSendBudget(aSendBudget)
+    {
+        mKeys = aKeys;
+    }
+    ENetServerShard(ENetServerShard&&)                 = delete;
+    ENetServerShard(const ENetServerShard&)            = delete;
+    ENetServerShard& operator=(ENetServerShard&&)      = delete;
+    ENetServerShard& operator=(const ENetServerShard&) = delete;
+    ~ENetServerShard() override;
+
+    void Init() override;
+    void ProcessAuthResults();
+    // post the retire jobs the decode queues had no room for when their peer was released
+    void ProcessRetiring();
+
+    // game thread: hand a response over to this shard network thread, false if full
+    bool Post(const OutgoingResponse& aResponse) { return mOutgoingChan.TrySend(aResponse); }
+
+    /**
+     * @brief Fan out responses produced by the game thread into the peer batches
+     */
+    void ProcessOutgoing();
+
+    /**
+     * @brief Append an archived message to the player's batch, sent on the next FlushPending
+     *
+     * @return false if the player is not connected or the batch could not be sent
+     */
+    bool Queue(PlayerID aID, PacketType aType, byte_view aData);
+
+    /**
+     * @brief Queue an unreliable state update, replacing any update with the same key that has
+     * not been flushed yet and adding aWeight to its priority
+     *
+     * @return false if the player is not connected
+     */
+    bool QueueStateUpdate(
+        PlayerID                        aID,
+        PacketType                      aType,
+        LatestStateQueue::key_type      aKey,
+        byte_view                       aData,
+        LatestStateQueue::priority_type aWeight = 1);
+
+    /**
+     * @brief Send every peer batch and its most urgent state updates, then flush the host once
+     *
+     * Each peer earns mSendBudget bytes of credit per tick, capped to one tick worth. Reliable
+     * batches are always sent and spend credit, state updates that do not fit in the remaining
+     * credit are deferred to a later flush.
+     */
+    void FlushPending();
+
+    const std::string* FindAccountName(PlayerID aID) const
+    {
+        auto it = mAccountNames.find(aID);
+        return it != mAccountNames.end() ? &it->second : nullptr;
+    }
+
+    [[nodiscard]] std::size_t Index() const noexcept { return mIndex; }
+    // any thread, totals as of the last statistics sample
+    [[nodiscard]] NetTotals Totals() const noexcept { return mTotals.Load(); }
+    // any thread, handshakes dropped so far per reason
+    [[nodiscard]] HandshakeDrops Drops() const noexcept { return mHandshakes.Drops(); }
+
+    /**
+     * @brief Decrypt and decode packets of authenticated peers on aWorkers threads
+     *
+     * Call after Init and before polling. Their requests are drained with
+     * ConsumeDecodedRequests, the shard request channel keeps the handshake and routing ones.
+     */
+    void StartDecodeWorkers(std::size_t aWorkers);
+
+    // game thread
+    template <typename Func>
+    void ConsumeDecodedRequests(Func&& aHandler)
+    {
+        if (mDecodePool) {
+            mDecodePool->ConsumeRequests(aHandler);
+        }
+    }
+
+   protected:
+    virtual void OnConnect(ENetEvent& aEvent) override;
+    virtual void OnReceive(ENetEvent& aEvent, byte_view aData) override;
+    virtual void OnDisconnect(ENetEvent& aEvent) override;
+    virtual void OnDisconnectTimeout(ENetEvent& aEvent) override;
+    virtual void OnNone(ENetEvent& aEvent) override;
+    virtual bool Offload(ENetEvent& aEvent) override;
+
+   private:
+    void onMessage(ENetPeer* aPeer, PeerState* aState, byte_view aData);
+    void sendError(ENetPeer* aPeer, ServerError aError);
+    // a fresh cookie the peer must echo in front of its sealed handshake
+    void sendCookie(ENetPeer* aPeer);
+    // a response outside of any session, sent in clear and flushed right away
+    bool sendClear(ENetPeer* aPeer, NetworkResponse& aResp);
+    // the fastest of our AEADs among aOffered
+    std::optional<AEADID> pickCipher(AEADMask aOffered) const;
+    // queue each peer its link statistics and publish the shard totals
+    void sampleStats();
+    // forget a disconnected peer, its state is freed once no worker can still use it
+    void releasePeer(ENetPeer* aPeer);
+
+    std::size_t mIndex;
+    ENetAddress mAddress;
+    std::size_t mMaxPeers;
+    bool        mReusePort;
+    // AEADs this server runs, fastest first
+    std::vector<AEADID> mCiphers;
+
+    // R/W on the shard network thread, careful
+    peer_map               mConnectedPeers;
+    AuthTokenCache&        mTokens;
+    std::size_t            mSendBudget;
+    clock_type::time_point mLastFlush{clock_type::now()};
+    clock_type::time_point mLastStats{clock_type::now()};
+
+    // written by the PocketBase callback threads
+    MpscRingChannel<AuthResult, kAuthCapacity> mAuthResultChan;
+    // written by the game thread only, GameServer updates every instance from its one loop
+    SpscRingChannel<OutgoingResponse, kOutgoingCapacity> mOutgoingChan;
+
+    std::unordered_map<PlayerID, std::string> mAccountNames;
+
+    // rate limits and cookies checked before any sealed box is opened
+    HandshakeGuard mHandshakes;
+
+    PublishedNetTotals mTotals;
+
+    std::unique_ptr<DecodePool> mDecodePool;
+    // released peers whose retire job did not fit in their worker queue yet
+    std::vector<DecodeJob> mRetiring;
+
+    // scratch for the responses built on the network thread, cleared before each use
+    BitOutputArchive mArchive;
+};
+
+/**
+ * @brief Game facing side of the server network, spread over one or more ENetServerShard
+ *
+ * Lives on the game thread: requests of every shard are consumed here and responses are routed
+ * to the shard owning the recipient, learnt from the Connected notification a shard emits once a
+ * player is authenticated.
+ */
+class ENetServer
+{
+   public:
+    // default per peer send budget, in bytes per tick (~120KB/s at 60 ticks per second)
+    static constexpr std::size_t kDefaultSendBudget = 2048;
+    static constexpr std::size_t kDefaultMaxPeers   = 128;
+
+    // how long a token verified by the backend is trusted without asking again
+    static constexpr auto kTokenCacheTTL = std::chrono::seconds(300);
+
+    // messages of each calibration size timed per AEAD at Init, a few milliseconds in total
+    static constexpr std::size_t kCalibrationIterations = 2000;
+
+    ENetServer(
+        const std::string& aSrvAddr,
+        Logger             aLogger,
+        PocketBaseClient&  aPBClient,
+        std::size_t        aSendBudget = kDefaultSendBudget,
+        std::size_t        aShards     = 1,
+        std::size_t        aMaxPeers   = kDefaultMaxPeers)
+        : mServerAddr(aSrvAddr),
+          mLogger(aLogger),
+          mPBClient(aPBClient),
+          mSendBudget(aSendBudget),
+          mShardCount(std::max<std::size_t>(aShards, 1)),
+          mMaxPeers(aMaxPeers),
+          mTokens(
+              [&aPBClient](const std::string& aToken, AuthTokenCache::callback_type aDone) {
+                  verifyToken(aPBClient, aToken, std::move(aDone));
+              },
+              kTokenCacheTTL)
     {
     }
     ENetServer(ENetServer&&)                 = delete;
@@ -32,39 +267,67 @@ class ENetServer : public ENetBase
     ENetServer& operator=(const ENetServer&) = delete;
     ~ENetServer()                            = default;
 
-    void Init() override;
-    void ProcessAuthResults();
+    void Init();
 
-    void BroadcastResponse(
-        const std::span<const PlayerID> aPlayers,
-        PacketType                      aType,
-        uint32_t                        aTick,
-        const NetworkResponsePayload&   aPayload)
+    // every shard host could be created
+    [[nodiscard]] bool IsInit() const noexcept
     {
-        for (const PlayerID& id : aPlayers) {
-            mRespChannel.Send(new NetworkResponse{
-                .Type     = aType,
-                .PlayerID = id,
-                .Tick     = aTick,
-                .Payload  = aPayload,
+        return !mShards.empty()
+               && std::ranges::all_of(mShards, [](const auto& aShard) { return aShard->IsInit(); });
+    }
+
+    [[nodiscard]] std::size_t      ShardCount() const noexcept { return mShards.size(); }
+    [[nodiscard]] ENetServerShard& Shard(std::size_t aIdx) { return *mShards[aIdx]; }
+
+    template <typename Func>
+    void ConsumeNetworkRequests(Func&& aHandler)
+    {
+        for (auto& shard : mShards) {
+            shard->ConsumeNetworkRequests([&](NetworkRequest* aEvent) {
+                if (aEvent->Type == PacketType::Connected) {
+                    mPlayerShards[aEvent->PlayerID] = shard->Index();
+                    return;
+                }
+                aHandler(aEvent);
             });
+            shard->ConsumeDecodedRequests(aHandler);
         }
     }
-    bool Send(PlayerID aID, const std::span<const uint8_t> aData)
+
+    /**
+     * @brief Archive a response once and queue it for every player in aPlayers
+     *
+     * Game thread only: every game instance is updated from the GameServer loop, which is the
+     * single producer of the shard outgoing channels and owns mArchive and mPlayerShards. The
+     * network threads only encrypt the shared bytes per peer. aWeights, if not empty, gives the
+     * state update priority weight of each player.
+     */
+    void BroadcastResponse(
+        const std::span<const PlayerID>                  aPlayers,
+        PacketType                                       aType,
+        uint32_t                                         aTick,
+        NetworkResponsePayload                           aPayload,
+        std::span<const LatestStateQueue::priority_type> aWeights = {});
+
+    void SendResponse(
+        PlayerID               aID,
+        PacketType             aType,
+        uint32_t               aTick,
+        NetworkResponsePayload aPayload)
     {
-        if (!mConnectedPeers.contains(aID)) {
-            return false;
-        } else {
-            return ENetBase::Send(mConnectedPeers[aID], aData);
-        }
+        BroadcastResponse(std::span(&aID, 1), aType, aTick, std::move(aPayload));
     }
 
     const std::string& GetAccountName(PlayerID aID) const
     {
         static const std::string empty;
 
-        auto it = mAccountNames.find(aID);
-        return it != mAccountNames.end() ? it->second : empty;
+        for (const auto& shard : mShards) {
+            if (const std::string* name = shard->FindAccountName(aID)) {
+                return *name;
+            }
+        }
+        return empty;
     }
 
     const std::pair<std::string, int> IPAndPort() const
@@ -82,21 +345,70 @@ class ENetServer : public ENetBase
         return res;
     }
 
+    // conditions every shard host on Init, shard i being seeded with aSeed + i
+    void SetLinkConditions(const LinkConditions& aConditions, std::uint64_t aSeed)
+    {
+        mLink     = aConditions;
+        mLinkSeed = aSeed;
+    }
+
+    // decode workers started by each shard on Init, 0 decodes on the network threads
+    void SetDecodeWorkers(std::size_t aWorkers) { mDecodeWorkers = aWorkers; }
+
     const std::string PublicKey() const { return mKeys.ExportPublicKey(); }
 
-   protected:
-    virtual void OnConnect(ENetEvent& aEvent) override;
-    virtual void OnReceive(ENetEvent& aEvent, byte_view aData) override;
-    virtual void OnDisconnect(ENetEvent& aEvent) override;
-    virtual void OnDisconnectTimeout(ENetEvent& aEvent) override;
-    virtual void OnNone(ENetEvent& aEvent) override;
+    // any thread, summed over shards without locking
+    [[nodiscard]] NetTotals NetworkTotals() const noexcept
+    {
+        NetTotals totals;
+        for (const auto& shard : mShards) {
+            totals += shard->Totals();
+        }
+        return totals;
+    }
+
+    // any thread, summed over shards
+    [[nodiscard]] HandshakeDrops HandshakeDropTotals() const noexcept
+    {
+        HandshakeDrops drops;
+        for (const auto& shard : mShards) {
+            drops += shard->Drops();
+        }
+        return drops;
+    }
+
+    [[nodiscard]] const AuthTokenCache& Tokens() const noexcept { return mTokens; }
 
    private:
-    // R/W on the separate network thread, careful
-    peer_map            mConnectedPeers;
-    std::string         mServerAddr;
-    Channel<AuthResult> mAuthResultChan;
-    PocketBaseClient&   mPBClient;
+    void postTo(ENetServerShard& aShard, const OutgoingResponse& aOut);
+    // ask the backend to refresh aToken, which proves it valid and yields its player
+    static void verifyToken(
+        PocketBaseClient&             aPBClient,
+        const std::string&            aToken,
+        AuthTokenCache::callback_type aDone);
 
-    std::unordered_map<PlayerID, std::string> mAccountNames;
+    std::string       mServerAddr;
+    Logger            mLogger;
+    PocketBaseClient& mPBClient;
+    std::size_t       mSendBudget;
+    std::size_t       mShardCount;
+    std::size_t       mMaxPeers;
+
+    // shared by every shard, a player reconnecting to another shard still hits it
+    AuthTokenCache mTokens;
+
+    LinkConditions mLink{};
+    std::uint64_t  mLinkSeed{0};
+    std::size_t    mDecodeWorkers{0};
+
+    // shared by every shard so clients only know one server key
+    CryptoKeys mKeys;
+    // measured at Init, fastest first
+    std::vector<AEADID> mCiphers;
+
+    std::vector<std::unique_ptr<ENetServerShard>> mShards;
+    // game thread only
+    std::unordered_map<PlayerID, std::size_t> mPlayerShards;
+    // game thread scratch, responses are copied out into their shared buffer
+    BitOutputArchive mArchive;
 };
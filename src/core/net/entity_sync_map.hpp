@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstddef>
+#include <entt/entity/entity.hpp>
+#include <vector>
+
+/**
+ * @brief Client: local entity replicating each server entity
+ *
+ * A table indexed by the server entity index rather than a hash map: the server recycles its
+ * indices, so they stay dense, and a lookup is a bounds check and a load. Each slot keeps the
+ * full server entity, a stale version of a recycled index finds nothing.
+ */
+class EntitySyncMap
+{
+   public:
+    // local entity of aServer, entt::null if it is not replicated
+    [[nodiscard]] entt::entity Find(entt::entity aServer) const noexcept
+    {
+        const auto index = std::size_t(entt::to_entity(aServer));
+        if (index >= mSlots.size() || mSlots[index].Server != aServer) {
+            return entt::null;
+        }
+        return mSlots[index].Local;
+    }
+
+    [[nodiscard]] bool Contains(entt::entity aServer) const noexcept
+    {
+        return Find(aServer) != entt::null;
+    }
+
+    void Insert(entt::entity aServer, entt::entity aLocal)
+    {
+        const auto index = std::size_t(entt::to_entity(aServer));
+        if (index >= mSlots.size()) {
+            mSlots.resize(index + 1);
+        }
+        if (mSlots[index].Server == entt::null) {
+            ++mSize;
+        }
+        mSlots[index] = {.Server = aServer, .Local = aLocal};
+    }
+
+    // local entity aServer was replicated to, entt::null if none
+    entt::entity Erase(entt::entity aServer)
+    {
+        const entt::entity local = Find(aServer);
+        if (local != entt::null) {
+            mSlots[std::size_t(entt::to_entity(aServer))] = {};
+            --mSize;
+        }
+        return local;
+    }
+
+    void Clear()
+    {
+        mSlots.clear();
+        mSize = 0;
+    }
+
+    [[nodiscard]] std::size_t Size() const noexcept { return mSize; }
+
+   private:
+    struct Slot {
+        entt::entity Server{entt::null};
+        entt::entity Local{entt::null};
+    };
+
+    std::vector<Slot> mSlots;
+    std::size_t       mSize{0};
+};
@@ -0,0 +1,143 @@
+#include "core/net/handshake_guard.hpp"
+
+#include <sodium/utils.h>
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+
+HandshakeGuard::HandshakeGuard(std::size_t aMaxPending) : mMaxPending(aMaxPending)
+{
+    crypto_generichash_keygen(mSecret.data());
+}
+
+HandshakeGuard::cookie_type HandshakeGuard::Cookie(
+    const ENetAddress&     aAddress,
+    clock_type::time_point aNow) const
+{
+    const auto epoch = std::chrono::duration_cast<std::chrono::seconds>(aNow.time_since_epoch())
+                       / kCookieEpoch;
+    return cookieFor(aAddress, epoch);
+}
+
+bool HandshakeGuard::CheckCookie(
+    const ENetAddress&     aAddress,
+    byte_view              aCookie,
+    clock_type::time_point aNow) const
+{
+    if (aCookie.size() != kCookieBytes) {
+        return false;
+    }
+
+    const auto epoch = std::chrono::duration_cast<std::chrono::seconds>(aNow.time_since_epoch())
+                       / kCookieEpoch;
+    for (std::int64_t candidate : {epoch, epoch - 1}) {
+        const cookie_type expected = cookieFor(aAddress, candidate);
+        if (sodium_memcmp(expected.data(), aCookie.data(), kCookieBytes) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool HandshakeGuard::Allow(const ENetAddress& aAddress, clock_type::time_point aNow)
+{
+    if (mBuckets.size() >= kMaxBuckets) {
+        Prune(aNow);
+    }
+
+    auto [it, inserted] = mBuckets.try_emplace(hostOf(aAddress), Bucket{kBurst, aNow});
+    Bucket& bucket      = it->second;
+
+    bucket.Tokens = refilled(bucket, aNow);
+    bucket.Last   = aNow;
+    if (bucket.Tokens < 1.0) {
+        return false;
+    }
+    bucket.Tokens -= 1.0;
+    return true;
+}
+
+void HandshakeGuard::Prune(clock_type::time_point aNow)
+{
+    std::erase_if(mBuckets, [&](const auto& aEntry) {
+        return refilled(aEntry.second, aNow) >= kBurst;
+    });
+}
+
+bool HandshakeGuard::BeginPending()
+{
+    if (mPending >= mMaxPending) {
+        return false;
+    }
+    ++mPending;
+    return true;
+}
+
+void HandshakeGuard::EndPending()
+{
+    if (mPending > 0) {
+        --mPending;
+    }
+}
+
+HandshakeDrops HandshakeGuard::Drops() const noexcept
+{
+    HandshakeDrops drops;
+    for (std::size_t idx = 0; idx < mDrops.size(); ++idx) {
+        drops.Counts[idx] = mDrops[idx].load(std::memory_order_relaxed);
+    }
+    return drops;
+}
+
+std::size_t HandshakeGuard::HostHash::operator()(const host_type& aHost) const noexcept
+{
+    // FNV-1a, addresses are attacker chosen but the table is bounded and pruned
+    std::size_t hash = 14695981039346656037ULL;
+    for (std::uint8_t byte : aHost) {
+        hash = (hash ^ byte) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+HandshakeGuard::host_type HandshakeGuard::hostOf(const ENetAddress& aAddress)
+{
+    host_type host;
+    std::memcpy(host.data(), &aAddress.host, host.size());
+    return host;
+}
+
+HandshakeGuard::cookie_type HandshakeGuard::cookieFor(
+    const ENetAddress& aAddress,
+    std::int64_t       aEpoch) const
+{
+    // host | port | epoch, the port pins the cookie to one client socket
+    std::array<std::uint8_t, sizeof(ENetAddress::host) + sizeof(aAddress.port) + sizeof(aEpoch)>
+        input;
+
+    auto out = std::copy_n(
+        reinterpret_cast<const std::uint8_t*>(&aAddress.host),
+        sizeof(aAddress.host),
+        input.begin());
+    out = std::copy_n(
+        reinterpret_cast<const std::uint8_t*>(&aAddress.port),
+        sizeof(aAddress.port),
+        out);
+    std::copy_n(reinterpret_cast<const std::uint8_t*>(&aEpoch), sizeof(aEpoch), out);
+
+    cookie_type cookie;
+    crypto_generichash(
+        cookie.data(),
+        cookie.size(),
+        input.data(),
+        input.size(),
+        mSecret.data(),
+        mSecret.size());
+    return cookie;
+}
+
+double HandshakeGuard::refilled(const Bucket& aBucket, clock_type::time_point aNow) const
+{
+    const double elapsed = std::chrono::duration<double>(aNow - aBucket.Last).count();
+    return std::min(kBurst, aBucket.Tokens + elapsed * kRefillPerSecond);
+}
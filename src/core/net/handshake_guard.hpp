@@ -0,0 +1,121 @@
+#pragma once
+
+#include <enet.h>
+#include <sodium/crypto_generichash.h>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <unordered_map>
+
+#include "core/types.hpp"
+
+// reasons a handshake is dropped before its sealed box is opened, or after failing to open it
+enum class HandshakeDrop : std::uint8_t {
+    RateLimited,
+    BadCookie,
+    TooManyPending,
+    SealOpenFailed,
+    Count,
+};
+
+struct HandshakeDrops {
+    std::array<std::uint64_t, std::size_t(HandshakeDrop::Count)> Counts{};
+
+    [[nodiscard]] std::uint64_t operator[](HandshakeDrop aReason) const
+    {
+        return Counts[std::size_t(aReason)];
+    }
+
+    HandshakeDrops& operator+=(const HandshakeDrops& aOther) noexcept
+    {
+        for (std::size_t idx = 0; idx < Counts.size(); ++idx) {
+            Counts[idx] += aOther.Counts[idx];
+        }
+        return *this;
+    }
+};
+
+/**
+ * @brief Cheap checks gating the sealed box open of unauthenticated peers
+ *
+ * Opening a sealed box is public key crypto, far more expensive than anything a client has to do
+ * to send one. Before it is attempted:
+ * - each source address spends a token from a bucket refilled at kRefillPerSecond,
+ * - the packet must start with a cookie the server handed to that address on connect. Cookies
+ *   are a keyed hash of the address and a time epoch, nothing is stored per peer,
+ * - connections are refused while kMaxPending peers are still unauthenticated.
+ *
+ * Used from a single network thread, the drop counters can be read from any thread.
+ */
+class HandshakeGuard
+{
+   public:
+    using clock_type  = std::chrono::steady_clock;
+    using cookie_type = std::array<std::uint8_t, 16>;
+
+    static constexpr std::size_t kCookieBytes     = std::tuple_size_v<cookie_type>;
+    static constexpr auto        kCookieEpoch     = std::chrono::seconds(30);
+    static constexpr double      kBurst           = 8.0;
+    static constexpr double      kRefillPerSecond = 2.0;
+    static constexpr std::size_t kMaxPending      = 256;
+    static constexpr auto        kPendingTimeout  = std::chrono::seconds(10);
+    // buckets kept before idle ones are pruned early
+    static constexpr std::size_t kMaxBuckets = 65536;
+
+    HandshakeGuard(std::size_t aMaxPending = kMaxPending);
+
+    // cookie of aAddress for the current epoch
+    [[nodiscard]] cookie_type Cookie(
+        const ENetAddress&     aAddress,
+        clock_type::time_point aNow) const;
+    // whether aCookie was handed to aAddress during this epoch or the previous one
+    [[nodiscard]] bool CheckCookie(
+        const ENetAddress&     aAddress,
+        byte_view              aCookie,
+        clock_type::time_point aNow) const;
+
+    // spend a handshake token of aAddress, false when its bucket is empty
+    bool Allow(const ENetAddress& aAddress, clock_type::time_point aNow);
+    // forget addresses whose bucket refilled
+    void Prune(clock_type::time_point aNow);
+
+    // a peer connected, false if too many are still unauthenticated
+    bool BeginPending();
+    // a pending peer authenticated or left
+    void EndPending();
+
+    void Count(HandshakeDrop aReason)
+    {
+        mDrops[std::size_t(aReason)].fetch_add(1, std::memory_order_relaxed);
+    }
+    [[nodiscard]] HandshakeDrops Drops() const noexcept;
+
+    [[nodiscard]] std::size_t Pending() const noexcept { return mPending; }
+    [[nodiscard]] std::size_t Buckets() const noexcept { return mBuckets.size(); }
+
+   private:
+    using host_type = std::array<std::uint8_t, sizeof(ENetAddress::host)>;
+
+    struct HostHash {
+        std::size_t operator()(const host_type& aHost) const noexcept;
+    };
+
+    struct Bucket {
+        double                 Tokens;
+        clock_type::time_point Last;
+    };
+
+    static host_type hostOf(const ENetAddress& aAddress);
+
+    cookie_type cookieFor(const ENetAddress& aAddress, std::int64_t aEpoch) const;
+    double      refilled(const Bucket& aBucket, clock_type::time_point aNow) const;
+
+    std::array<std::uint8_t, crypto_generichash_KEYBYTES> mSecret{};
+    std::unordered_map<host_type, Bucket, HostHash>      mBuckets;
+    std::size_t                                           mMaxPending;
+    std::size_t                                           mPending{0};
+
+    std::array<std::atomic<std::uint64_t>, std::size_t(HandshakeDrop::Count)> mDrops{};
+};
@@ -0,0 +1,93 @@
+#include "core/net/interest.hpp"
+
+#include <entt/entity/entity.hpp>
+#include <utility>
+
+bool PlayerInterest::Relevant(const glm::vec3& aPos) const noexcept
+{
+    if (Map.Contains(aPos)) {
+        return true;
+    }
+    if (!Camera) {
+        return false;
+    }
+    const ViewRegion around{
+        .Min = Camera->Min - glm::vec2(kCameraMargin),
+        .Max = Camera->Max + glm::vec2(kCameraMargin),
+    };
+    return around.Contains(aPos);
+}
+
+std::vector<PlayerID> InterestMap::Interested(
+    std::span<const PlayerID> aAll,
+    const glm::vec3&          aPos) const
+{
+    std::vector<PlayerID> interested;
+    for (const PlayerID id : aAll) {
+        auto it = Players.find(id);
+        if (it == Players.end() || it->second.Relevant(aPos)) {
+            interested.push_back(id);
+        }
+    }
+    return interested;
+}
+
+std::vector<PlayerID> InterestMap::CreateRecipients(
+    entt::entity              aEntity,
+    std::span<const PlayerID> aAll,
+    const glm::vec3&          aPos)
+{
+    std::vector<PlayerID> interested = Interested(aAll, aPos);
+    if (interested.size() < aAll.size()) {
+        Recipients.insert_or_assign(aEntity, interested);
+    }
+    return interested;
+}
+
+std::vector<PlayerID> InterestMap::DestroyRecipients(
+    entt::entity              aEntity,
+    std::span<const PlayerID> aAll)
+{
+    auto it = Recipients.find(aEntity);
+    if (it == Recipients.end()) {
+        return {aAll.begin(), aAll.end()};
+    }
+    std::vector<PlayerID> recipients = std::move(it->second);
+    Recipients.erase(it);
+    return recipients;
+}
+
+void FilterSnapshot(
+    const PlayerInterest& aInterest,
+    const StateSnapshot*  aBase,
+    const StateSnapshot&  aWorld,
+    std::uint32_t         aRound,
+    StateSnapshot&        aOut)
+{
+    aOut.Tick = aWorld.Tick;
+    aOut.Entities.clear();
+
+    // both sides are sorted by entity, without a baseline the player knows no state
+    std::span<const EntityState> baseline;
+    if (aBase) {
+        baseline = aBase->Entities;
+    }
+
+    auto base = baseline.begin();
+    for (const EntityState& state : aWorld.Entities) {
+        const auto id = entt::to_integral(state.Entity);
+        while (base != baseline.end() && entt::to_integral(base->Entity) < id) {
+            ++base;
+        }
+
+        const bool known = base != baseline.end() && base->Entity == state.Entity;
+        const bool due   = (id + aRound) % InterestMap::kDistantInterval == 0;
+        if (due || aInterest.Relevant(state.Position)) {
+            aOut.Entities.push_back(state);
+        } else if (known) {
+            aOut.Entities.push_back(*base);
+        }
+        // an unknown entity out of view waits for its refresh round, the player was likely not
+        // sent its create either
+    }
+}
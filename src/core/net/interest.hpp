@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstdint>
+#include <entt/entity/entity.hpp>
+#include <glm/ext/vector_float2.hpp>
+#include <glm/ext/vector_float3.hpp>
+#include <optional>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+#include "core/net/state_snapshot.hpp"
+#include "core/serialize.hpp"
+#include "core/types.hpp"
+
+/**
+ * @brief Ground rectangle, on the XZ plane
+ */
+struct ViewRegion {
+    glm::vec2 Min{0.0f};
+    glm::vec2 Max{0.0f};
+
+    [[nodiscard]] bool Contains(const glm::vec3& aPos) const noexcept
+    {
+        return aPos.x >= Min.x && aPos.x <= Max.x && aPos.z >= Min.y && aPos.z <= Max.y;
+    }
+
+    bool Archive(auto& aArchive)
+    {
+        if (!ArchiveVector(aArchive, Min, -1000.0f, 1000.0f)) return false;
+        return ArchiveVector(aArchive, Max, -1000.0f, 1000.0f);
+    }
+
+    bool operator==(const ViewRegion&) const = default;
+};
+
+/**
+ * @brief What a player is looking at: its own map, and where its camera points when reported
+ */
+struct PlayerInterest {
+    // entities this close to the camera region are relevant too, they are about to show up
+    static constexpr float kCameraMargin = 4.0f;
+
+    ViewRegion                Map;
+    std::optional<ViewRegion> Camera;
+
+    [[nodiscard]] bool Relevant(const glm::vec3& aPos) const noexcept;
+};
+
+/**
+ * @brief Server: interest of every player of a game, in the registry context
+ *
+ * Relevant entities are replicated in every snapshot, the others every kDistantInterval
+ * snapshots only, staggered by entity so the refreshes spread over the rounds.
+ */
+struct InterestMap {
+    static constexpr std::uint32_t kDistantInterval = 8;
+
+    std::unordered_map<PlayerID, PlayerInterest> Players;
+    // entities whose create went to some players only, those players
+    std::unordered_map<entt::entity, std::vector<PlayerID>> Recipients;
+
+    // players an event at aPos matters to, every player of aAll not known here included
+    [[nodiscard]] std::vector<PlayerID> Interested(
+        std::span<const PlayerID> aAll,
+        const glm::vec3&          aPos) const;
+
+    // players of aAll the create of aEntity at aPos goes to, recorded for its destroy
+    std::vector<PlayerID> CreateRecipients(
+        entt::entity              aEntity,
+        std::span<const PlayerID> aAll,
+        const glm::vec3&          aPos);
+
+    // players the destroy of aEntity goes to, those sent its create, forgets them
+    std::vector<PlayerID> DestroyRecipients(entt::entity aEntity, std::span<const PlayerID> aAll);
+};
+
+/**
+ * @brief Snapshot of aWorld as a player sees it
+ *
+ * Irrelevant entities keep their state in aBase, the snapshot the player acknowledged, unless
+ * due for a refresh at aRound. Irrelevant entities not in aBase are left out until then.
+ */
+void FilterSnapshot(
+    const PlayerInterest& aInterest,
+    const StateSnapshot*  aBase,
+    const StateSnapshot&  aWorld,
+    std::uint32_t         aRound,
+    StateSnapshot&        aOut);
@@ -0,0 +1,168 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "core/types.hpp"
+
+/**
+ * @brief Impairments of a simulated link, all disabled by default
+ */
+struct LinkConditions {
+    std::chrono::milliseconds Latency{0};
+    // uniform in [-Jitter, Jitter], added to Latency
+    std::chrono::milliseconds Jitter{0};
+    double                    LossChance{0.0};
+    // reordered datagrams are held ReorderDelay longer so that later ones overtake them
+    double                    ReorderChance{0.0};
+    std::chrono::milliseconds ReorderDelay{0};
+    // 0 for an unlimited link
+    std::size_t               BandwidthBytesPerSec{0};
+    // datagrams arriving with more than this waiting behind the bandwidth cap are dropped
+    std::size_t               QueueLimitBytes{64 * 1024};
+
+    [[nodiscard]] bool Active() const noexcept
+    {
+        return Latency.count() > 0 || Jitter.count() > 0 || LossChance > 0.0
+               || ReorderChance > 0.0 || BandwidthBytesPerSec > 0;
+    }
+};
+
+/**
+ * @brief Delays, drops and reorders datagrams like a lossy link would, deterministically
+ *
+ * Datagrams are submitted when they arrive and handed back once their delivery time is reached.
+ * Every random draw comes from a 64 bits Mersenne Twister seeded at construction and is turned
+ * into a double by hand, so a seed replays the same impairments on any standard library.
+ */
+template <typename _Source>
+class LinkConditioner
+{
+   public:
+    using clock_type = std::chrono::steady_clock;
+    using time_point = clock_type::time_point;
+
+    LinkConditioner(const LinkConditions& aConditions, std::uint64_t aSeed)
+        : mConditions(aConditions), mRng(aSeed)
+    {
+    }
+
+    /**
+     * @brief Take a datagram received at aNow
+     *
+     * @return false if the link dropped it
+     */
+    bool Submit(time_point aNow, const _Source& aFrom, byte_view aData)
+    {
+        ++mSubmitted;
+        if (chance(mConditions.LossChance)) {
+            ++mDropped;
+            return false;
+        }
+
+        time_point departure = aNow;
+        if (mConditions.BandwidthBytesPerSec > 0) {
+            const time_point start   = std::max(aNow, mLinkFreeAt);
+            const double     backlog = std::chrono::duration<double>(start - aNow).count()
+                                   * double(mConditions.BandwidthBytesPerSec);
+            if (backlog + double(aData.size()) > double(mConditions.QueueLimitBytes)) {
+                ++mDropped;
+                return false;
+            }
+
+            mLinkFreeAt = start + transmitTime(aData.size());
+            departure   = mLinkFreeAt;
+        }
+
+        auto delay = std::chrono::duration_cast<clock_type::duration>(mConditions.Latency);
+        if (mConditions.Jitter.count() > 0) {
+            const auto span   = 2 * mConditions.Jitter.count() + 1;
+            const auto offset = std::int64_t(unit() * double(span)) - mConditions.Jitter.count();
+            delay += std::chrono::milliseconds(offset);
+        }
+        if (chance(mConditions.ReorderChance)) {
+            delay += mConditions.ReorderDelay;
+            ++mReordered;
+        }
+        delay = std::max(delay, clock_type::duration::zero());
+
+        mQueue.push_back(Datagram{
+            .DeliverAt = departure + delay,
+            .Sequence  = mNextSequence++,
+            .From      = aFrom,
+            .Bytes     = byte_buffer(aData.begin(), aData.end()),
+        });
+        std::push_heap(mQueue.begin(), mQueue.end(), later);
+        return true;
+    }
+
+    /**
+     * @brief Pass every datagram due at aNow to aHandler(const _Source&, byte_buffer&), by
+     * delivery time then submission order
+     *
+     * @return number of datagrams delivered
+     */
+    template <typename Func>
+    std::size_t Deliver(time_point aNow, Func&& aHandler)
+    {
+        std::size_t count = 0;
+        while (!mQueue.empty() && mQueue.front().DeliverAt <= aNow) {
+            std::pop_heap(mQueue.begin(), mQueue.end(), later);
+            Datagram datagram = std::move(mQueue.back());
+            mQueue.pop_back();
+
+            aHandler(datagram.From, datagram.Bytes);
+            ++count;
+        }
+        mDelivered += count;
+        return count;
+    }
+
+    [[nodiscard]] std::size_t   Pending() const noexcept { return mQueue.size(); }
+    [[nodiscard]] std::uint64_t Submitted() const noexcept { return mSubmitted; }
+    [[nodiscard]] std::uint64_t Dropped() const noexcept { return mDropped; }
+    [[nodiscard]] std::uint64_t Reordered() const noexcept { return mReordered; }
+    [[nodiscard]] std::uint64_t Delivered() const noexcept { return mDelivered; }
+
+   private:
+    struct Datagram {
+        time_point    DeliverAt;
+        std::uint64_t Sequence;
+        _Source       From;
+        byte_buffer   Bytes;
+    };
+
+    // heap comparator: the earliest datagram, then the first submitted, ends up on top
+    static bool later(const Datagram& aL, const Datagram& aR)
+    {
+        if (aL.DeliverAt != aR.DeliverAt) {
+            return aL.DeliverAt > aR.DeliverAt;
+        }
+        return aL.Sequence > aR.Sequence;
+    }
+
+    clock_type::duration transmitTime(std::size_t aBytes) const
+    {
+        const double seconds = double(aBytes) / double(mConditions.BandwidthBytesPerSec);
+        return std::chrono::duration_cast<clock_type::duration>(
+            std::chrono::duration<double>(seconds));
+    }
+
+    // uniform in [0, 1) from the top 53 bits of the generator
+    double unit() { return double(mRng() >> 11) * 0x1.0p-53; }
+    bool   chance(double aProbability) { return aProbability > 0.0 && unit() < aProbability; }
+
+    LinkConditions        mConditions;
+    std::mt19937_64       mRng;
+    std::vector<Datagram> mQueue;
+    time_point            mLinkFreeAt{};
+    std::uint64_t         mNextSequence{0};
+
+    std::uint64_t mSubmitted{0};
+    std::uint64_t mDropped{0};
+    std::uint64_t mReordered{0};
+    std::uint64_t mDelivered{0};
+};
@@ -3,11 +3,16 @@
 #include <enet.h>
 
 #include <memory>
+#include <optional>
 #include <variant>
 
 #include "components/player.hpp"
 #include "components/tower_attack.hpp"
+#include "core/crypto/aead.hpp"
 #include "core/crypto/key.hpp"
+#include "core/crypto/session.hpp"
+#include "core/net/interest.hpp"
+#include "core/net/state_snapshot.hpp"
 #include "core/physics/physics.hpp"
 #include "core/serialize.hpp"
 #include "core/state.hpp"
@@ -42,6 +47,69 @@ inline bool operator==(const SyncPayload& aLHS, const SyncPayload& aRHS)
     return aLHS.GameID == aRHS.GameID && aLHS.State == aRHS.State;
 }
 
+struct TickActions {
+    uint32_t    Tick;
+    ActionsType Actions;
+
+    bool Archive(auto& aArchive)
+    {
+        if (!ArchiveValue(aArchive, Tick, 0u, 30000000u)) return false;
+        return ArchiveVector(aArchive, Actions, 32u);
+    }
+};
+
+inline bool operator==(const TickActions& aLHS, const TickActions& aRHS)
+{
+    return aLHS.Tick == aRHS.Tick && aLHS.Actions == aRHS.Actions;
+}
+
+/**
+ * @brief Client actions of every tick the server has not acknowledged yet, oldest first
+ *
+ * Sent unreliably each tick: a lost packet is covered by the next one, which repeats the same
+ * ticks until an InputAckResponse moves the window forward. The server applies a tick once.
+ */
+struct InputPayload {
+    // ticks of history resent at most, about a second at 60 Hz
+    static constexpr uint32_t kMaxTicks = 64;
+
+    GameInstanceID            GameID;
+    std::vector<TickActions>  Inputs;
+    // newest snapshot decoded by the client, the baseline of the next deltas
+    std::optional<uint32_t>   SnapshotAck{};
+    // lockstep: first tick the client found its state diverging from the server's
+    std::optional<uint32_t>   Desync{};
+    // ground the camera looks at, entities there are replicated at full rate
+    std::optional<ViewRegion> View{};
+
+    bool Archive(auto& aArchive)
+    {
+        if (!ArchiveValue(aArchive, GameID, uint64_t(0), std::numeric_limits<uint64_t>::max()))
+            return false;
+        if (!ArchiveVector(aArchive, Inputs, kMaxTicks)) return false;
+        if (!ArchiveOptionalVal(aArchive, SnapshotAck, 0u, 30000000u)) return false;
+        if (!ArchiveOptionalVal(aArchive, Desync, 0u, 30000000u)) return false;
+
+        bool hasView = View.has_value();
+        if (!ArchiveBool(aArchive, hasView)) return false;
+        if (!hasView) {
+            View.reset();
+            return true;
+        }
+        if (!View) {
+            View.emplace();
+        }
+        return View->Archive(aArchive);
+    }
+};
+
+inline bool operator==(const InputPayload& aLHS, const InputPayload& aRHS)
+{
+    return aLHS.GameID == aRHS.GameID && aLHS.Inputs == aRHS.Inputs
+           && aLHS.SnapshotAck == aRHS.SnapshotAck && aLHS.Desync == aRHS.Desync
+           && aLHS.View == aRHS.View;
+}
+
 struct PlayerInitData {
     PlayerID     ID;
     entt::entity ServerEntity;
@@ -73,6 +141,8 @@ struct NewGameResponse {
     PlayerID                    YourPlayerID;
     int                         StartingIncome;
     std::vector<PlayerInitData> Players;
+    // clients simulate the game from the LockstepTurn of every tick, no entity is replicated
+    bool                        Lockstep{false};
 
     bool Archive(auto& aArchive)
     {
@@ -80,7 +150,8 @@ struct NewGameResponse {
             return false;
         if (!ArchivePlayerID(aArchive, YourPlayerID)) return false;
         if (!ArchiveValue(aArchive, StartingIncome, 0, 500)) return false;
-        return ArchiveVector(aArchive, Players, 8u);
+        if (!ArchiveVector(aArchive, Players, 8u)) return false;
+        return ArchiveBool(aArchive, Lockstep);
     }
 
     bool operator==(const NewGameResponse&) const = default;
@@ -95,6 +166,10 @@ inline bool operator==(const ConnectedResponse&, const ConnectedResponse&) { ret
 enum class ServerError : std::uint8_t {
     Success,
     HandshakeOpenSeal,
+    // none of the AEADs offered by the client is supported
+    NoCommonCipher,
+    // the session keys could not be derived from the client public key
+    SessionKeys,
 };
 
 struct ErrorResponse {
@@ -102,7 +177,7 @@ struct ErrorResponse {
 
     bool Archive(auto& aArchive)
     {
-        return ArchiveValue(aArchive, Error, ServerError::Success, ServerError::HandshakeOpenSeal);
+        return ArchiveValue(aArchive, Error, ServerError::Success, ServerError::SessionKeys);
     }
 
     auto operator<=>(const ErrorResponse&) const = default;
@@ -280,11 +355,14 @@ inline bool operator==(const HealthUpdateResponse& aLHS, const HealthUpdateRespo
 struct GoldUpdateResponse {
     ::PlayerID Player;
     int        Balance;
+    // the balance reflects the player's inputs before this client tick, not the later ones
+    uint32_t   InputTick{0};
 
     bool Archive(auto& aArchive)
     {
         if (!ArchivePlayerID(aArchive, Player)) return false;
-        return ArchiveValue(aArchive, Balance, -100000, 100000);
+        if (!ArchiveValue(aArchive, Balance, -100000, 100000)) return false;
+        return ArchiveValue(aArchive, InputTick, 0u, 30000000u);
     }
 
     auto operator<=>(const GoldUpdateResponse&) const = default;
@@ -338,30 +416,59 @@ inline bool operator==(const GameEndResponse& aLHS, const GameEndResponse& aRHS)
     return aLHS.Ranking == aRHS.Ranking;
 }
 
+struct InputAckResponse {
+    // first client tick the server has not applied yet
+    uint32_t NextTick;
+
+    bool Archive(auto& aArchive) { return ArchiveValue(aArchive, NextTick, 0u, 30000000u); }
+
+    auto operator<=>(const InputAckResponse&) const = default;
+};
+
 struct AuthRequest {
     std::string        Token;
-    bool               HasAESNI;
+    // AEADs the client can use, the server picks the one it runs fastest
+    AEADMask           Ciphers;
     CryptoKeys::Public PublicKey;
 
     bool Archive(auto& aArchive)
     {
         if (!ArchiveString(aArchive, Token, 1024)) return false;
-        if (!ArchiveBool(aArchive, HasAESNI)) return false;
+        if (!ArchiveValue(aArchive, Ciphers, AEADMask(0), kAllAEADs)) return false;
         return ArchiveArray(aArchive, PublicKey, uint8_t(0), std::numeric_limits<uint8_t>::max());
     }
 
     auto operator<=>(const AuthRequest&) const = default;
 };
 
+// handed in clear to a connecting peer: the cookie is echoed in front of its sealed handshake,
+// the salt drawn for the connection goes into the session keys
+struct HandshakeCookieResponse {
+    std::array<uint8_t, 16>  Cookie;
+    CryptoSession::salt_type Salt;
+
+    bool Archive(auto& aArchive)
+    {
+        if (!ArchiveArray(aArchive, Cookie, uint8_t(0), std::numeric_limits<uint8_t>::max())) {
+            return false;
+        }
+        return ArchiveArray(aArchive, Salt, uint8_t(0), std::numeric_limits<uint8_t>::max());
+    }
+
+    auto operator<=>(const HandshakeCookieResponse&) const = default;
+};
+
 struct AuthResponse {
     PlayerID ID;
-    bool     HasAESNI;
+    AEADID   Cipher;
     bool     Success;
 
     bool Archive(auto& aArchive)
     {
         if (!ArchivePlayerID(aArchive, ID)) return false;
-        if (!ArchiveBool(aArchive, HasAESNI)) return false;
+        if (!ArchiveValue(aArchive, Cipher, AEADID::XChaCha20Poly1305, AEADID::AEGIS128L)) {
+            return false;
+        }
         return ArchiveBool(aArchive, Success);
     }
 
@@ -376,10 +483,123 @@ enum class PacketType : std::uint16_t {
     NewGame,
     Connected,
     Auth,
+    StateUpdate,
+    ClientInput,
+    InputAck,
+    NetworkStats,
+    HandshakeCookie,
+    Snapshot,
+    Count,
+};
+
+/**
+ * @brief How a packet type travels over ENet
+ *
+ * Reliable packets (creates, destroys, gold, eliminations...) are ordered and retransmitted on
+ * channel 0. Periodic state is unreliable sequenced on channel 1: a lost update is not resent,
+ * the next one carries fresher data anyway, and older updates arriving late are dropped by ENet.
+ */
+enum class Delivery : std::uint8_t {
+    Reliable,
+    Unreliable,
     Count,
 };
 
-using NetworkRequestPayload  = std::variant<std::monostate, SyncPayload, AuthRequest>;
+constexpr Delivery DeliveryFor(PacketType aType) noexcept
+{
+    switch (aType) {
+        case PacketType::StateUpdate:
+        case PacketType::ClientInput:
+        case PacketType::InputAck:
+        case PacketType::NetworkStats:
+        case PacketType::Snapshot:
+            return Delivery::Unreliable;
+        default:
+            return Delivery::Reliable;
+    }
+}
+
+constexpr enet_uint8 DeliveryChannel(Delivery aDelivery) noexcept
+{
+    return enet_uint8(aDelivery);
+}
+
+// every channel has its own nonce counter and replay window in the CryptoSession
+static_assert(std::size_t(Delivery::Count) == CryptoSession::kChannels);
+
+constexpr enet_uint32 DeliveryFlags(Delivery aDelivery) noexcept
+{
+    return aDelivery == Delivery::Reliable ? ENET_PACKET_FLAG_RELIABLE
+                                           : ENET_PACKET_FLAG_UNRELIABLE_FRAGMENT;
+}
+
+struct PacketTypeTraffic {
+    PacketType Type;
+    uint64_t   PacketsIn;
+    uint64_t   BytesIn;
+    uint64_t   PacketsOut;
+    uint64_t   BytesOut;
+
+    bool Archive(auto& aArchive)
+    {
+        constexpr auto kMax = std::numeric_limits<uint64_t>::max();
+
+        if (!ArchiveValue(aArchive, Type, 0u, uint32_t(PacketType::Count))) return false;
+        if (!ArchiveValue(aArchive, PacketsIn, uint64_t(0), kMax)) return false;
+        if (!ArchiveValue(aArchive, BytesIn, uint64_t(0), kMax)) return false;
+        if (!ArchiveValue(aArchive, PacketsOut, uint64_t(0), kMax)) return false;
+        return ArchiveValue(aArchive, BytesOut, uint64_t(0), kMax);
+    }
+
+    auto operator<=>(const PacketTypeTraffic&) const = default;
+};
+
+/**
+ * @brief Link quality of a player as measured by the server, sent periodically for the HUD
+ */
+struct NetworkStatsResponse {
+    uint32_t RTT;          // smoothed round trip time, ms
+    uint32_t RTTVariance;  // ms
+    float    PacketLoss;   // ratio of reliable packets lost over the last ENet loss interval
+    uint32_t ReliableInFlight;
+    uint32_t ReliableBytesInFlight;
+    uint64_t Retransmits;
+
+    std::vector<PacketTypeTraffic> Traffic;
+
+    bool Archive(auto& aArchive)
+    {
+        if (!ArchiveValue(aArchive, RTT, 0u, 60000u)) return false;
+        if (!ArchiveValue(aArchive, RTTVariance, 0u, 60000u)) return false;
+        if (!ArchiveValue(aArchive, PacketLoss, 0.0f, 1.0f)) return false;
+        if (!ArchiveValue(aArchive, ReliableInFlight, 0u, std::numeric_limits<uint32_t>::max()))
+            return false;
+        if (!ArchiveValue(
+                aArchive,
+                ReliableBytesInFlight,
+                0u,
+                std::numeric_limits<uint32_t>::max()))
+            return false;
+        if (!ArchiveValue(
+                aArchive,
+                Retransmits,
+                uint64_t(0),
+                std::numeric_limits<uint64_t>::max()))
+            return false;
+        return ArchiveVector(aArchive, Traffic, std::size_t(PacketType::Count));
+    }
+};
+
+inline bool operator==(const NetworkStatsResponse& aLHS, const NetworkStatsResponse& aRHS)
+{
+    return aLHS.RTT == aRHS.RTT && aLHS.RTTVariance == aRHS.RTTVariance
+           && aLHS.PacketLoss == aRHS.PacketLoss && aLHS.ReliableInFlight == aRHS.ReliableInFlight
+           && aLHS.ReliableBytesInFlight == aRHS.ReliableBytesInFlight
+           && aLHS.Retransmits == aRHS.Retransmits && aLHS.Traffic == aRHS.Traffic;
+}
+
+using NetworkRequestPayload =
+    std::variant<std::monostate, SyncPayload, AuthRequest, InputPayload>;
 using NetworkResponsePayload = std::variant<
     std::monostate,
     NewGameResponse,
@@ -392,7 +612,12 @@ using NetworkResponsePayload = std::variant<
     CommonIncomeUpdateResponse,
     PlayerEliminatedResponse,
     GameEndResponse,
-    AuthResponse>;
+    AuthResponse,
+    InputAckResponse,
+    NetworkStatsResponse,
+    HandshakeCookieResponse,
+    SnapshotResponse,
+    LockstepTurn>;
 
 template <typename _Payload>
 struct NetworkEvent {
@@ -414,6 +639,33 @@ struct NetworkEvent {
 using NetworkResponse = NetworkEvent<NetworkResponsePayload>;
 using NetworkRequest  = NetworkEvent<NetworkRequestPayload>;
 
+// input acks share a key no entity uses, only the latest one is worth sending
+inline constexpr std::uint32_t kInputAckKey     = entt::to_integral(entt::entity{entt::null});
+// live entities never carry the tombstone version, keys below null are free as well
+inline constexpr std::uint32_t kNetworkStatsKey = kInputAckKey - 1;
+inline constexpr std::uint32_t kSnapshotKey     = kInputAckKey - 2;
+
+/**
+ * @brief Key of the entity a state update describes, a newer update for the same key
+ * supersedes one that is still queued
+ */
+inline std::optional<std::uint32_t> SupersedeKey(const NetworkResponse& aResp)
+{
+    if (aResp.Type == PacketType::InputAck) {
+        return kInputAckKey;
+    }
+    if (aResp.Type == PacketType::Snapshot) {
+        return kSnapshotKey;
+    }
+    if (aResp.Type != PacketType::StateUpdate) {
+        return std::nullopt;
+    }
+    if (const auto* rb = std::get_if<RigidBodyUpdateResponse>(&aResp.Payload)) {
+        return entt::to_integral(rb->Entity);
+    }
+    return std::nullopt;
+}
+
 template <>
 struct fmt::formatter<NetworkResponsePayload> : fmt::formatter<std::string> {
     auto format(NetworkResponsePayload const& aObj, format_context& aCtx) const
@@ -487,6 +739,42 @@ struct fmt::formatter<NetworkResponsePayload> : fmt::formatter<std::string> {
                     aResp.ID,
                     aResp.Success);
             }
+            void operator()(const InputAckResponse& aResp) const
+            {
+                fmt::format_to(Ctx->out(), "input ack, next tick {}", aResp.NextTick);
+            }
+            void operator()(const NetworkStatsResponse& aResp) const
+            {
+                fmt::format_to(
+                    Ctx->out(),
+                    "network stats, rtt {}ms +/- {}ms, loss {:.1f}%, {} reliable in flight",
+                    aResp.RTT,
+                    aResp.RTTVariance,
+                    aResp.PacketLoss * 100.0f,
+                    aResp.ReliableInFlight);
+            }
+            void operator()(const HandshakeCookieResponse&) const
+            {
+                fmt::format_to(Ctx->out(), "handshake cookie");
+            }
+            void operator()(const SnapshotResponse& aResp) const
+            {
+                fmt::format_to(
+                    Ctx->out(),
+                    "snapshot {} against {}, {} changed, {} removed",
+                    aResp.Tick,
+                    aResp.Delta ? fmt::to_string(aResp.BaseTick) : "nothing",
+                    aResp.Changed.size(),
+                    aResp.Removed.size());
+            }
+            void operator()(const LockstepTurn& aResp) const
+            {
+                fmt::format_to(
+                    Ctx->out(),
+                    "lockstep turn {} with {} actions",
+                    aResp.Tick,
+                    aResp.Actions.size());
+            }
             void operator()(const std::monostate&) const
             {
                 fmt::format_to(Ctx->out(), "no network response payload");
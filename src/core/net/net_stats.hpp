@@ -0,0 +1,156 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "core/net/net.hpp"
+
+/**
+ * @brief Messages and bytes exchanged with one peer, per packet type
+ *
+ * Counted once per message rather than per ENet packet since a batch carries several types.
+ * Outgoing state updates are counted when queued, including those superseded before a flush.
+ * Incoming messages may be counted by a decode worker while the network thread samples, hence
+ * the relaxed atomics.
+ */
+struct PeerTraffic {
+    struct Counters {
+        std::uint64_t Packets{0};
+        std::uint64_t Bytes{0};
+    };
+
+    struct AtomicCounters {
+        std::atomic<std::uint64_t> Packets{0};
+        std::atomic<std::uint64_t> Bytes{0};
+    };
+
+    using table_type = std::array<AtomicCounters, std::size_t(PacketType::Count)>;
+
+    table_type In{};
+    table_type Out{};
+
+    void CountIn(PacketType aType, std::size_t aBytes) { count(In, aType, aBytes); }
+    void CountOut(PacketType aType, std::size_t aBytes) { count(Out, aType, aBytes); }
+
+    [[nodiscard]] static Counters Total(const table_type& aTable) noexcept
+    {
+        Counters total;
+        for (const auto& counters : aTable) {
+            total.Packets += counters.Packets.load(std::memory_order_relaxed);
+            total.Bytes   += counters.Bytes.load(std::memory_order_relaxed);
+        }
+        return total;
+    }
+
+    // types that saw any traffic, as sent to the client
+    [[nodiscard]] std::vector<PacketTypeTraffic> Summary() const
+    {
+        std::vector<PacketTypeTraffic> summary;
+        for (std::size_t idx = 0; idx < In.size(); ++idx) {
+            const PacketTypeTraffic traffic{
+                .Type       = PacketType(idx),
+                .PacketsIn  = In[idx].Packets.load(std::memory_order_relaxed),
+                .BytesIn    = In[idx].Bytes.load(std::memory_order_relaxed),
+                .PacketsOut = Out[idx].Packets.load(std::memory_order_relaxed),
+                .BytesOut   = Out[idx].Bytes.load(std::memory_order_relaxed),
+            };
+            if (traffic.PacketsIn > 0 || traffic.PacketsOut > 0) {
+                summary.push_back(traffic);
+            }
+        }
+        return summary;
+    }
+
+   private:
+    static void count(table_type& aTable, PacketType aType, std::size_t aBytes)
+    {
+        if (aType >= PacketType::Count) {
+            return;
+        }
+        auto& counters = aTable[std::size_t(aType)];
+        counters.Packets.fetch_add(1, std::memory_order_relaxed);
+        counters.Bytes.fetch_add(aBytes, std::memory_order_relaxed);
+    }
+};
+
+/**
+ * @brief Plain copy of the network totals, summed over peers
+ */
+struct NetTotals {
+    std::uint32_t Peers{0};
+    std::uint64_t PacketsIn{0};
+    std::uint64_t BytesIn{0};
+    std::uint64_t PacketsOut{0};
+    std::uint64_t BytesOut{0};
+    std::uint64_t Retransmits{0};
+    std::uint32_t MaxRTT{0};
+    float         MaxPacketLoss{0.0f};
+    std::uint64_t ChannelOverflows{0};
+
+    NetTotals& operator+=(const NetTotals& aOther) noexcept
+    {
+        Peers            += aOther.Peers;
+        PacketsIn        += aOther.PacketsIn;
+        BytesIn          += aOther.BytesIn;
+        PacketsOut       += aOther.PacketsOut;
+        BytesOut         += aOther.BytesOut;
+        Retransmits      += aOther.Retransmits;
+        MaxRTT            = std::max(MaxRTT, aOther.MaxRTT);
+        MaxPacketLoss     = std::max(MaxPacketLoss, aOther.MaxPacketLoss);
+        ChannelOverflows += aOther.ChannelOverflows;
+        return *this;
+    }
+};
+
+/**
+ * @brief Network totals published by a network thread, read from any other without locking
+ *
+ * Fields are updated independently: a reader may see a sample half published, which is fine for
+ * metrics.
+ */
+class PublishedNetTotals
+{
+   public:
+    void Publish(const NetTotals& aTotals) noexcept
+    {
+        mPeers.store(aTotals.Peers, std::memory_order_relaxed);
+        mPacketsIn.store(aTotals.PacketsIn, std::memory_order_relaxed);
+        mBytesIn.store(aTotals.BytesIn, std::memory_order_relaxed);
+        mPacketsOut.store(aTotals.PacketsOut, std::memory_order_relaxed);
+        mBytesOut.store(aTotals.BytesOut, std::memory_order_relaxed);
+        mRetransmits.store(aTotals.Retransmits, std::memory_order_relaxed);
+        mMaxRTT.store(aTotals.MaxRTT, std::memory_order_relaxed);
+        mMaxPacketLoss.store(aTotals.MaxPacketLoss, std::memory_order_relaxed);
+        mChannelOverflows.store(aTotals.ChannelOverflows, std::memory_order_relaxed);
+    }
+
+    [[nodiscard]] NetTotals Load() const noexcept
+    {
+        return NetTotals{
+            .Peers            = mPeers.load(std::memory_order_relaxed),
+            .PacketsIn        = mPacketsIn.load(std::memory_order_relaxed),
+            .BytesIn          = mBytesIn.load(std::memory_order_relaxed),
+            .PacketsOut       = mPacketsOut.load(std::memory_order_relaxed),
+            .BytesOut         = mBytesOut.load(std::memory_order_relaxed),
+            .Retransmits      = mRetransmits.load(std::memory_order_relaxed),
+            .MaxRTT           = mMaxRTT.load(std::memory_order_relaxed),
+            .MaxPacketLoss    = mMaxPacketLoss.load(std::memory_order_relaxed),
+            .ChannelOverflows = mChannelOverflows.load(std::memory_order_relaxed),
+        };
+    }
+
+   private:
+    std::atomic<std::uint32_t> mPeers{0};
+    std::atomic<std::uint64_t> mPacketsIn{0};
+    std::atomic<std::uint64_t> mBytesIn{0};
+    std::atomic<std::uint64_t> mPacketsOut{0};
+    std::atomic<std::uint64_t> mBytesOut{0};
+    std::atomic<std::uint64_t> mRetransmits{0};
+    std::atomic<std::uint32_t> mMaxRTT{0};
+    std::atomic<float>         mMaxPacketLoss{0.0f};
+    std::atomic<std::uint64_t> mChannelOverflows{0};
+};
@@ -1,32 +1,35 @@
 #pragma once
 
+#include <vector>
+
 #include "core/net/net.hpp"
-#include "registry/registry.hpp"
 
 /**
- * @brief Event types for EnTT dispatcher
+ * @brief Client: game responses received since the last fixed tick, grouped by type
  *
- * These wrap network response types for deferred processing.
- * Events are enqueued at frame time and processed at fixed timestep.
- * Registry pointer is included so handlers can access the ECS.
+ * Responses are appended at frame time as they are consumed from the network thread, in the order
+ * they arrived, and applied at the next fixed tick by the NetworkResponseSystem, one pass per
+ * type. Vectors are cleared, not freed, so steady state batching does not allocate.
  */
+struct NetworkResponseQueue {
+    std::vector<SyncPayload>             Syncs;
+    std::vector<RigidBodyUpdateResponse> Bodies;
+    std::vector<HealthUpdateResponse>    Health;
+    std::vector<SnapshotResponse>        Snapshots;
+    std::vector<GoldUpdateResponse>      Gold;
 
-struct RigidBodyUpdateEvent {
-    Registry*               Reg;
-    RigidBodyUpdateResponse Response;
-};
-
-struct HealthUpdateEvent {
-    Registry*            Reg;
-    HealthUpdateResponse Response;
-};
-
-struct GoldUpdateEvent {
-    Registry*          Reg;
-    GoldUpdateResponse Response;
-};
+    [[nodiscard]] bool Empty() const noexcept
+    {
+        return Syncs.empty() && Bodies.empty() && Health.empty() && Snapshots.empty()
+               && Gold.empty();
+    }
 
-struct SyncPayloadEvent {
-    Registry*   Reg;
-    SyncPayload Payload;
+    void Clear()
+    {
+        Syncs.clear();
+        Bodies.clear();
+        Health.clear();
+        Snapshots.clear();
+        Gold.clear();
+    }
 };
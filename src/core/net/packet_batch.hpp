@@ -0,0 +1,290 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <span>
+#include <vector>
+
+#include "core/types.hpp"
+
+/**
+ * @brief Coalesces several archived messages into a single framed packet
+ *
+ * Each message is prefixed with its size as a little endian 32 bits word:
+ *
+ *      [size | message bytes][size | message bytes]...
+ *
+ * Archived messages are always a multiple of 4 bytes (BitWriter flushes whole words), a 32 bits
+ * header therefore keeps every message word aligned relative to the start of the packet, which
+ * BitReader relies on.
+ *
+ * The underlying buffer is kept between flushes so steady state batching does not allocate.
+ */
+class PacketBatch
+{
+   public:
+    using size_type = uint32_t;
+
+    static constexpr std::size_t kHeaderBytes = sizeof(size_type);
+    // Keep a batch under a typical path MTU once encrypted so it is sent as a single datagram
+    static constexpr std::size_t kMaxBytes = 1200;
+
+    /**
+     * @brief Append a message to the batch
+     *
+     * @return false if the message does not fit in the remaining space, an empty batch accepts
+     * any message size (large messages are then fragmented by ENet)
+     */
+    bool Append(byte_view aMessage)
+    {
+        if (!mBuffer.empty() && mBuffer.size() + kHeaderBytes + aMessage.size() > kMaxBytes) {
+            return false;
+        }
+
+        const auto      offset = mBuffer.size();
+        const size_type size   = size_type(aMessage.size());
+
+        mBuffer.resize(offset + kHeaderBytes + aMessage.size());
+        writeSize(mBuffer.data() + offset, size);
+        if (!aMessage.empty()) {
+            std::memcpy(mBuffer.data() + offset + kHeaderBytes, aMessage.data(), aMessage.size());
+        }
+        ++mCount;
+        return true;
+    }
+
+    void Clear()
+    {
+        mBuffer.clear();
+        mCount = 0;
+    }
+
+    [[nodiscard]] bool        Empty() const noexcept { return mCount == 0; }
+    [[nodiscard]] std::size_t Count() const noexcept { return mCount; }
+    [[nodiscard]] byte_view   Bytes() const noexcept { return mBuffer; }
+
+    /**
+     * @brief Iterate over the messages of a framed packet
+     *
+     * @return false if the packet is malformed, messages before the malformed frame are still
+     * passed to the handler
+     */
+    template <typename Func>
+    static bool ForEach(byte_view aPacket, Func&& aHandler)
+    {
+        while (!aPacket.empty()) {
+            if (aPacket.size() < kHeaderBytes) {
+                return false;
+            }
+
+            const size_type size = readSize(aPacket.data());
+            if (size > aPacket.size() - kHeaderBytes) {
+                return false;
+            }
+
+            aHandler(aPacket.subspan(kHeaderBytes, size));
+            aPacket = aPacket.subspan(kHeaderBytes + size);
+        }
+        return true;
+    }
+
+   private:
+    static void writeSize(uint8_t* aOut, size_type aSize)
+    {
+        for (std::size_t i = 0; i < kHeaderBytes; ++i) {
+            aOut[i] = uint8_t(aSize >> (8 * i));
+        }
+    }
+
+    static size_type readSize(const uint8_t* aIn)
+    {
+        size_type size = 0;
+        for (std::size_t i = 0; i < kHeaderBytes; ++i) {
+            size |= size_type(aIn[i]) << (8 * i);
+        }
+        return size;
+    }
+
+    byte_buffer mBuffer;
+    std::size_t mCount{0};
+};
+
+/**
+ * @brief Latest pending state update per key, sent by accumulated priority
+ *
+ * Queuing an update for a key that already has one pending replaces it in place, so the peer
+ * only ever receives the freshest state of an entity. Every queued update adds its weight to the
+ * key priority: entities deferred because the budget ran out become more urgent each tick until
+ * they are sent, which resets their priority.
+ *
+ * Message buffers and the key index, an open addressed table of entry indices, are reused across
+ * drains: steady state queuing does not allocate.
+ */
+class LatestStateQueue
+{
+   public:
+    using key_type      = uint32_t;
+    using priority_type = uint32_t;
+
+    void Put(key_type aKey, byte_view aMessage, priority_type aWeight = 1)
+    {
+        // a null priority marks sent entries
+        aWeight = std::max<priority_type>(aWeight, 1);
+
+        if ((mSize + 1) * 2 > mSlots.size()) {
+            grow();
+        }
+        const std::size_t slot = findSlot(aKey);
+        if (mSlots[slot] != kEmptySlot) {
+            Entry& entry = mEntries[mSlots[slot] - 1];
+            entry.Bytes.assign(aMessage.begin(), aMessage.end());
+            entry.Priority += aWeight;
+            ++mSuperseded;
+            return;
+        }
+
+        if (mSize == mEntries.size()) {
+            mEntries.emplace_back();
+        }
+        mSlots[slot]   = slot_type(mSize + 1);
+        Entry& entry   = mEntries[mSize++];
+        entry.Key      = aKey;
+        entry.Priority = aWeight;
+        entry.Bytes.assign(aMessage.begin(), aMessage.end());
+    }
+
+    /**
+     * @brief Pass pending updates to aHandler by decreasing priority, queue order breaking ties,
+     * until aBudget bytes are used. Updates that do not fit stay queued.
+     *
+     * The most urgent update is passed even if it alone exceeds aBudget, a message larger than
+     * what a peer earns in a tick (a full snapshot) would otherwise never be sent.
+     *
+     * @return number of message bytes passed to aHandler, more than aBudget on overdraft
+     */
+    template <typename Func>
+    std::size_t Drain(std::size_t aBudget, Func&& aHandler)
+    {
+        mOrder.resize(mSize);
+        for (std::size_t i = 0; i < mSize; ++i) {
+            mOrder[i] = i;
+        }
+        std::stable_sort(mOrder.begin(), mOrder.end(), [this](std::size_t aL, std::size_t aR) {
+            return mEntries[aL].Priority > mEntries[aR].Priority;
+        });
+
+        std::size_t spent = 0;
+        for (std::size_t idx : mOrder) {
+            Entry& entry = mEntries[idx];
+            const std::size_t left      = spent < aBudget ? aBudget - spent : 0;
+            const bool        overdraft = aBudget > 0 && spent == 0 && idx == mOrder.front();
+            if (entry.Bytes.size() > left && !overdraft) {
+                continue;
+            }
+            aHandler(byte_view(entry.Bytes));
+            spent         += entry.Bytes.size();
+            entry.Priority = 0;
+        }
+
+        for (std::size_t i = 0; i < mSize; ++i) {
+            if (mEntries[i].Priority == 0) {
+                eraseSlot(findSlot(mEntries[i].Key));
+            }
+        }
+
+        // keep deferred updates, in queue order, at the front, their slots follow them
+        std::size_t kept = 0;
+        for (std::size_t i = 0; i < mSize; ++i) {
+            if (mEntries[i].Priority == 0) {
+                continue;
+            }
+            if (i != kept) {
+                mSlots[findSlot(mEntries[i].Key)] = slot_type(kept + 1);
+                std::swap(mEntries[i], mEntries[kept]);
+            }
+            ++kept;
+        }
+        mDeferred += kept;
+        mSize      = kept;
+
+        return spent;
+    }
+
+    template <typename Func>
+    std::size_t Drain(Func&& aHandler)
+    {
+        return Drain(std::numeric_limits<std::size_t>::max(), std::forward<Func>(aHandler));
+    }
+
+    [[nodiscard]] bool        Empty() const noexcept { return mSize == 0; }
+    [[nodiscard]] std::size_t Size() const noexcept { return mSize; }
+    // number of updates dropped because a newer one was queued before the flush
+    [[nodiscard]] std::size_t Superseded() const noexcept { return mSuperseded; }
+    // number of times an update was left queued because the budget ran out
+    [[nodiscard]] std::size_t Deferred() const noexcept { return mDeferred; }
+
+   private:
+    // index of an entry in mEntries plus one, kEmptySlot for a free slot
+    using slot_type = uint32_t;
+
+    static constexpr slot_type   kEmptySlot    = 0;
+    static constexpr std::size_t kMinSlotCount = 16;
+
+    struct Entry {
+        key_type      Key{0};
+        priority_type Priority{0};
+        byte_buffer   Bytes;
+    };
+
+    std::size_t home(key_type aKey) const
+    {
+        uint32_t hash  = aKey * 0x9E3779B1U;
+        hash          ^= hash >> 16;
+        return hash & (mSlots.size() - 1);
+    }
+
+    // slot of aKey, or the free slot it would go in, linear probing
+    std::size_t findSlot(key_type aKey) const
+    {
+        const std::size_t mask = mSlots.size() - 1;
+        std::size_t       slot = home(aKey);
+        while (mSlots[slot] != kEmptySlot && mEntries[mSlots[slot] - 1].Key != aKey) {
+            slot = (slot + 1) & mask;
+        }
+        return slot;
+    }
+
+    // free aSlot, shifting back the entries that probed past it so none becomes unreachable
+    void eraseSlot(std::size_t aSlot)
+    {
+        const std::size_t mask = mSlots.size() - 1;
+        std::size_t       hole = aSlot;
+        for (std::size_t next = (hole + 1) & mask; mSlots[next] != kEmptySlot;
+             next             = (next + 1) & mask) {
+            const std::size_t from = home(mEntries[mSlots[next] - 1].Key);
+            if (((next - from) & mask) >= ((next - hole) & mask)) {
+                mSlots[hole] = mSlots[next];
+                hole         = next;
+            }
+        }
+        mSlots[hole] = kEmptySlot;
+    }
+
+    // the table is kept at most half full, a power of two in size
+    void grow()
+    {
+        mSlots.assign(std::max(kMinSlotCount, mSlots.size() * 2), kEmptySlot);
+        for (std::size_t i = 0; i < mSize; ++i) {
+            mSlots[findSlot(mEntries[i].Key)] = slot_type(i + 1);
+        }
+    }
+
+    std::vector<Entry>       mEntries;
+    std::vector<std::size_t> mOrder;
+    std::vector<slot_type>   mSlots;
+    std::size_t              mSize{0};
+    std::size_t              mSuperseded{0};
+    std::size_t              mDeferred{0};
+};
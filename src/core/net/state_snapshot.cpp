@@ -0,0 +1,128 @@
+#include "core/net/state_snapshot.hpp"
+
+#include <entt/entity/entity.hpp>
+
+static uint8_t changedFields(const EntityState& aBase, const EntityState& aCurrent)
+{
+    uint8_t fields = 0;
+    if (aBase.Position != aCurrent.Position) {
+        fields |= EntityDelta::Position;
+    }
+    if (aBase.Direction != aCurrent.Direction || aBase.Velocity != aCurrent.Velocity) {
+        fields |= EntityDelta::Motion;
+    }
+    if (aBase.Health != aCurrent.Health) {
+        fields |= EntityDelta::Health;
+    }
+    return fields;
+}
+
+static bool entityLess(entt::entity aL, entt::entity aR)
+{
+    return entt::to_integral(aL) < entt::to_integral(aR);
+}
+
+SnapshotResponse DiffSnapshots(const StateSnapshot* aBase, const StateSnapshot& aCurrent)
+{
+    SnapshotResponse delta{
+        .Tick     = aCurrent.Tick,
+        .Delta    = aBase != nullptr,
+        .BaseTick = aBase ? aBase->Tick : 0,
+    };
+
+    if (!aBase) {
+        delta.Changed.reserve(aCurrent.Entities.size());
+        for (const EntityState& state : aCurrent.Entities) {
+            delta.Changed.push_back(EntityDelta{.State = state, .Fields = EntityDelta::All});
+        }
+        return delta;
+    }
+
+    // both sides are sorted by entity, walk them together
+    auto base = aBase->Entities.begin();
+    auto cur  = aCurrent.Entities.begin();
+    while (base != aBase->Entities.end() || cur != aCurrent.Entities.end()) {
+        if (cur == aCurrent.Entities.end()
+            || (base != aBase->Entities.end() && entityLess(base->Entity, cur->Entity))) {
+            delta.Removed.push_back(base->Entity);
+            ++base;
+        } else if (base == aBase->Entities.end() || entityLess(cur->Entity, base->Entity)) {
+            delta.Changed.push_back(EntityDelta{.State = *cur, .Fields = EntityDelta::All});
+            ++cur;
+        } else {
+            if (const uint8_t fields = changedFields(*base, *cur)) {
+                delta.Changed.push_back(EntityDelta{.State = *cur, .Fields = fields});
+            }
+            ++base;
+            ++cur;
+        }
+    }
+    return delta;
+}
+
+bool ApplySnapshotDelta(
+    const StateSnapshot*    aBase,
+    const SnapshotResponse& aDelta,
+    StateSnapshot&          aOut)
+{
+    if (aDelta.Delta != (aBase != nullptr) || (aBase && aBase->Tick != aDelta.BaseTick)) {
+        return false;
+    }
+
+    aOut.Tick = aDelta.Tick;
+    aOut.Entities.clear();
+
+    static const std::vector<EntityState> kNone;
+    const auto&                           baseEntities = aBase ? aBase->Entities : kNone;
+
+    auto base    = baseEntities.begin();
+    auto removed = aDelta.Removed.begin();
+    auto changed = aDelta.Changed.begin();
+
+    while (base != baseEntities.end() || changed != aDelta.Changed.end()) {
+        const bool takeChanged =
+            changed != aDelta.Changed.end()
+            && (base == baseEntities.end() || !entityLess(base->Entity, changed->State.Entity));
+
+        if (!takeChanged) {
+            // kept as is unless listed as removed
+            if (removed != aDelta.Removed.end() && *removed == base->Entity) {
+                ++removed;
+            } else {
+                aOut.Entities.push_back(*base);
+            }
+            ++base;
+            continue;
+        }
+
+        const entt::entity entity = changed->State.Entity;
+        if (!aOut.Entities.empty() && !entityLess(aOut.Entities.back().Entity, entity)) {
+            return false;
+        }
+
+        if (base != baseEntities.end() && base->Entity == entity) {
+            EntityState state = *base;
+            if (changed->Fields & EntityDelta::Position) {
+                state.Position = changed->State.Position;
+            }
+            if (changed->Fields & EntityDelta::Motion) {
+                state.Direction = changed->State.Direction;
+                state.Velocity  = changed->State.Velocity;
+            }
+            if (changed->Fields & EntityDelta::Health) {
+                state.Health = changed->State.Health;
+            }
+            aOut.Entities.push_back(state);
+            ++base;
+        } else if (changed->Fields == EntityDelta::All) {
+            aOut.Entities.push_back(changed->State);
+        } else {
+            // a new entity must come with all of its fields
+            return false;
+        }
+        ++changed;
+    }
+
+    // every removed entity must have been in the baseline
+    return removed == aDelta.Removed.end();
+}
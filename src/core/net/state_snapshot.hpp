@@ -0,0 +1,154 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <entt/entity/entity.hpp>
+#include <glm/ext/vector_float3.hpp>
+#include <utility>
+#include <vector>
+
+#include "core/serialize.hpp"
+
+/**
+ * @brief Replicated state of one entity: where it is, how it moves and its health
+ */
+struct EntityState {
+    entt::entity Entity{entt::null};
+    glm::vec3    Position{0.0f};
+    glm::vec3    Direction{0.0f};
+    float        Velocity{0.0f};
+    // 0 for entities without health
+    float        Health{0.0f};
+
+    bool operator==(const EntityState&) const = default;
+};
+
+/**
+ * @brief Replicated state of every entity at a tick, sorted by entity
+ */
+struct StateSnapshot {
+    uint32_t                 Tick{0};
+    std::vector<EntityState> Entities;
+};
+
+/**
+ * @brief Fields of an entity that changed since the baseline, the others are not archived
+ */
+struct EntityDelta {
+    enum Field : uint8_t {
+        Position = 1 << 0,
+        Motion   = 1 << 1,
+        Health   = 1 << 2,
+        All      = Position | Motion | Health,
+    };
+
+    EntityState State;
+    uint8_t     Fields{0};
+
+    bool Archive(auto& aArchive)
+    {
+        if (!ArchiveEntity(aArchive, State.Entity)) return false;
+        if (!ArchiveValue(aArchive, Fields, uint8_t(0), uint8_t(All))) return false;
+        if (Fields & Position) {
+            if (!ArchiveVector(aArchive, State.Position, -500.0f, 500.0f)) return false;
+        }
+        if (Fields & Motion) {
+            if (!ArchiveVector(aArchive, State.Direction, -1.0f, 1.0f)) return false;
+            if (!ArchiveValue(aArchive, State.Velocity, 0.0f, 100.0f)) return false;
+        }
+        if (Fields & Health) {
+            if (!ArchiveValue(aArchive, State.Health, -10.0f, 1000.0f)) return false;
+        }
+        return true;
+    }
+
+    bool operator==(const EntityDelta&) const = default;
+};
+
+/**
+ * @brief Snapshot sent to a client, delta encoded against a snapshot it acknowledged
+ *
+ * Entities are listed by increasing entity. A full snapshot, sent until the client acknowledges
+ * one, carries every field of every entity.
+ */
+struct SnapshotResponse {
+    static constexpr std::size_t kMaxEntities = 8192;
+
+    uint32_t                  Tick{0};
+    bool                      Delta{false};
+    uint32_t                  BaseTick{0};
+    std::vector<entt::entity> Removed;
+    std::vector<EntityDelta>  Changed;
+
+    bool Archive(auto& aArchive)
+    {
+        if (!ArchiveValue(aArchive, Tick, 0u, 30000000u)) return false;
+        if (!ArchiveBool(aArchive, Delta)) return false;
+        if (Delta && !ArchiveValue(aArchive, BaseTick, 0u, 30000000u)) return false;
+        if (!ArchiveVector(
+                aArchive,
+                Removed,
+                entt::entity{0},
+                entt::entity{entt::null},
+                kMaxEntities))
+            return false;
+        return ArchiveVector(aArchive, Changed, kMaxEntities);
+    }
+
+    bool operator==(const SnapshotResponse&) const = default;
+};
+
+/**
+ * @brief Entities of aCurrent that are new or differ from aBase, and those aBase had that are
+ * gone. A null aBase gives a full snapshot.
+ */
+SnapshotResponse DiffSnapshots(const StateSnapshot* aBase, const StateSnapshot& aCurrent);
+
+/**
+ * @brief Rebuild the snapshot aDelta was computed from, aBase being its baseline or null for a
+ * full snapshot
+ *
+ * @return false if aDelta does not fit aBase, aOut is then unspecified
+ */
+bool ApplySnapshotDelta(
+    const StateSnapshot*    aBase,
+    const SnapshotResponse& aDelta,
+    StateSnapshot&          aOut);
+
+/**
+ * @brief Last snapshots sent, or received, kept as baselines for the next deltas
+ *
+ * Snapshot buffers are recycled: pushing swaps the new snapshot with the oldest one.
+ */
+class SnapshotHistory
+{
+   public:
+    static constexpr std::size_t kCapacity = 32;
+
+    // aSnapshot gets the evicted snapshot, to be reused as scratch
+    void Push(StateSnapshot& aSnapshot)
+    {
+        std::swap(mSlots[mNext], aSnapshot);
+        mNext  = (mNext + 1) % kCapacity;
+        mCount = std::min(mCount + 1, kCapacity);
+    }
+
+    [[nodiscard]] const StateSnapshot* Find(uint32_t aTick) const noexcept
+    {
+        for (std::size_t idx = 0; idx < mCount; ++idx) {
+            if (mSlots[idx].Tick == aTick) {
+                return &mSlots[idx];
+            }
+        }
+        return nullptr;
+    }
+
+    [[nodiscard]] std::size_t Size() const noexcept { return mCount; }
+
+   private:
+    std::array<StateSnapshot, kCapacity> mSlots{};
+    std::size_t                          mNext{0};
+    std::size_t                          mCount{0};
+};
@@ -0,0 +1,140 @@
+#include "core/net/token_cache.hpp"
+
+#include <sodium/utils.h>
+
+#include <algorithm>
+#include <glaze/glaze.hpp>
+
+struct TokenClaims {
+    std::int64_t exp{0};
+};
+
+bool AuthTokenCache::Resolve(
+    const std::string&     aToken,
+    callback_type          aDone,
+    clock_type::time_point aNow)
+{
+    const key_type key = hashToken(aToken);
+
+    std::unique_lock lock(mMutex);
+
+    if (auto it = mEntries.find(key); it != mEntries.end()) {
+        if (it->second.Expiry > aNow) {
+            const result_type result = it->second.Token;
+            lock.unlock();
+
+            ++mHits;
+            aDone(result);
+            return true;
+        }
+        mEntries.erase(it);
+    }
+
+    auto [inFlight, first] = mInFlight.try_emplace(key);
+    inFlight->second.push_back(std::move(aDone));
+    lock.unlock();
+
+    if (!first) {
+        ++mCoalesced;
+        return false;
+    }
+
+    ++mMisses;
+    mVerify(aToken, [this, key, aToken](const result_type& aResult) {
+        complete(key, aToken, aResult);
+    });
+    return false;
+}
+
+void AuthTokenCache::complete(
+    const key_type&    aKey,
+    const std::string& aToken,
+    const result_type& aResult)
+{
+    std::vector<callback_type> waiters;
+
+    {
+        std::lock_guard lock(mMutex);
+
+        if (auto it = mInFlight.find(aKey); it != mInFlight.end()) {
+            waiters = std::move(it->second);
+            mInFlight.erase(it);
+        }
+
+        auto ttl = std::chrono::duration_cast<clock_type::duration>(mTTL);
+        if (auto exp = ExpiryClaim(aToken)) {
+            const auto left = std::chrono::sys_seconds(std::chrono::seconds(*exp))
+                              - std::chrono::system_clock::now();
+            ttl = std::min(ttl, std::chrono::duration_cast<clock_type::duration>(left));
+        }
+
+        if (aResult && ttl > clock_type::duration::zero()) {
+            const auto now = clock_type::now();
+            if (mEntries.size() >= mMaxEntries) {
+                std::erase_if(mEntries, [now](const auto& aEntry) {
+                    return aEntry.second.Expiry <= now;
+                });
+            }
+            if (mEntries.size() < mMaxEntries) {
+                mEntries.insert_or_assign(aKey, Entry{.Token = *aResult, .Expiry = now + ttl});
+            }
+        }
+    }
+
+    for (auto& waiter : waiters) {
+        waiter(aResult);
+    }
+}
+
+std::optional<std::int64_t> AuthTokenCache::ExpiryClaim(const std::string& aToken)
+{
+    // header.payload.signature, the payload being base64url encoded JSON
+    const std::size_t first = aToken.find('.');
+    if (first == std::string::npos) {
+        return std::nullopt;
+    }
+    const std::size_t second = aToken.find('.', first + 1);
+    if (second == std::string::npos) {
+        return std::nullopt;
+    }
+
+    const std::string_view payload(aToken.data() + first + 1, second - first - 1);
+    std::string            json(payload.size(), '\0');
+    std::size_t            jsonLen = 0;
+
+    if (0
+        != sodium_base642bin(
+            reinterpret_cast<unsigned char*>(json.data()),
+            json.size(),
+            payload.data(),
+            payload.size(),
+            nullptr,
+            &jsonLen,
+            nullptr,
+            sodium_base64_VARIANT_URLSAFE_NO_PADDING)) {
+        return std::nullopt;
+    }
+    json.resize(jsonLen);
+
+    TokenClaims claims;
+    if (glz::read<glz::opts{.error_on_unknown_keys = false}>(claims, json)) {
+        return std::nullopt;
+    }
+    if (claims.exp <= 0) {
+        return std::nullopt;
+    }
+    return claims.exp;
+}
+
+AuthTokenCache::key_type AuthTokenCache::hashToken(const std::string& aToken)
+{
+    key_type key{};
+    crypto_generichash(
+        key.data(),
+        key.size(),
+        reinterpret_cast<const unsigned char*>(aToken.data()),
+        aToken.size(),
+        nullptr,
+        0);
+    return key;
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <sodium/crypto_generichash.h>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <expected>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "core/types.hpp"
+
+struct VerifiedToken {
+    PlayerID    ID;
+    std::string AccountName;
+};
+
+/**
+ * @brief Recently verified auth tokens, keyed by token hash
+ *
+ * PocketBase signs tokens with HS256 and a per user secret, the game server cannot check them
+ * without the backend. A token verified once is instead trusted for a short TTL, capped by its
+ * own expiry claim, so reconnecting players skip the HTTP round trip. Verifications of a token
+ * already in flight are coalesced: every requester is answered by the single backend call.
+ *
+ * A token revoked on the backend stays accepted until its cache entry expires.
+ *
+ * Called from the network threads and completed from the backend callback threads.
+ */
+class AuthTokenCache
+{
+   public:
+    using clock_type    = std::chrono::steady_clock;
+    using result_type   = std::expected<VerifiedToken, std::string>;
+    using callback_type = std::function<void(const result_type&)>;
+    // backend verification, must call its callback exactly once
+    using verify_type = std::function<void(const std::string&, callback_type)>;
+
+    static constexpr std::size_t kDefaultMaxEntries = 4096;
+
+    AuthTokenCache(
+        verify_type          aVerify,
+        std::chrono::seconds aTTL,
+        std::size_t          aMaxEntries = kDefaultMaxEntries)
+        : mVerify(std::move(aVerify)), mTTL(aTTL), mMaxEntries(aMaxEntries)
+    {
+    }
+    AuthTokenCache(AuthTokenCache&&)                 = delete;
+    AuthTokenCache(const AuthTokenCache&)            = delete;
+    AuthTokenCache& operator=(AuthTokenCache&&)      = delete;
+    AuthTokenCache& operator=(const AuthTokenCache&) = delete;
+    ~AuthTokenCache()                                = default;
+
+    /**
+     * @brief Answer aDone from the cache, or once the backend verified aToken
+     *
+     * @return true if aDone was called before returning
+     */
+    bool Resolve(const std::string& aToken, callback_type aDone)
+    {
+        return Resolve(aToken, std::move(aDone), clock_type::now());
+    }
+    bool Resolve(const std::string& aToken, callback_type aDone, clock_type::time_point aNow);
+
+    [[nodiscard]] std::size_t Hits() const noexcept { return mHits.load(); }
+    [[nodiscard]] std::size_t Misses() const noexcept { return mMisses.load(); }
+    [[nodiscard]] std::size_t Coalesced() const noexcept { return mCoalesced.load(); }
+
+    // seconds since epoch of the token "exp" claim, if it can be read
+    static std::optional<std::int64_t> ExpiryClaim(const std::string& aToken);
+
+   private:
+    using key_type = std::array<unsigned char, crypto_generichash_BYTES>;
+
+    struct KeyHash {
+        std::size_t operator()(const key_type& aKey) const noexcept
+        {
+            // already a cryptographic hash, any slice of it is well spread
+            std::size_t hash;
+            std::memcpy(&hash, aKey.data(), sizeof(hash));
+            return hash;
+        }
+    };
+
+    struct Entry {
+        VerifiedToken          Token;
+        clock_type::time_point Expiry;
+    };
+
+    static key_type hashToken(const std::string& aToken);
+
+    void complete(const key_type& aKey, const std::string& aToken, const result_type& aResult);
+
+    verify_type          mVerify;
+    std::chrono::seconds mTTL;
+    std::size_t          mMaxEntries;
+
+    std::mutex                                                        mMutex;
+    std::unordered_map<key_type, Entry, KeyHash>                      mEntries;
+    std::unordered_map<key_type, std::vector<callback_type>, KeyHash> mInFlight;
+
+    std::atomic<std::size_t> mHits{0};
+    std::atomic<std::size_t> mMisses{0};
+    std::atomic<std::size_t> mCoalesced{0};
+};
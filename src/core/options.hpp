@@ -2,10 +2,31 @@
 
 #include <argh.h>
 
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+
+#include "core/net/link_conditioner.hpp"
+
 struct Options {
     explicit Options() {}
     explicit Options(char** aArgv)
-        : mParser({"--loglevel", "--renderer", "--server-addr", "--backend-addr"})
+        : mParser(
+              {"--loglevel",
+               "--renderer",
+               "--server-addr",
+               "--backend-addr",
+               "--send-budget",
+               "--net-shards",
+               "--max-peers",
+               "--decode-workers",
+               "--snapshot-rate",
+               "--link-latency",
+               "--link-jitter",
+               "--link-loss",
+               "--link-reorder",
+               "--link-bandwidth",
+               "--link-seed"})
     {
         mParser.parse(aArgv);
         ServerAddr = mParser("server-addr", "").str();
@@ -26,6 +47,82 @@ struct Options {
         return mParser("backend-addr", "http://localhost:8090").str();
     }
 
+    // server per peer send budget, in bytes per tick
+    [[nodiscard]] std::size_t SendBudget() const
+    {
+        std::size_t budget = 2048;
+        mParser("send-budget", budget) >> budget;
+        return budget;
+    }
+
+    // server ENet hosts sharing the port, each serviced by its own network thread
+    [[nodiscard]] std::size_t NetShards() const
+    {
+        std::size_t shards = 1;
+        mParser("net-shards", shards) >> shards;
+        return shards;
+    }
+
+    // server peer limit of each ENet host
+    [[nodiscard]] std::size_t MaxPeers() const
+    {
+        std::size_t peers = 128;
+        mParser("max-peers", peers) >> peers;
+        return peers;
+    }
+
+    // server threads decrypting and decoding packets of each ENet host, 0 to do it inline
+    [[nodiscard]] std::size_t DecodeWorkers() const
+    {
+        std::size_t workers = 0;
+        mParser("decode-workers", workers) >> workers;
+        return workers;
+    }
+
+    // server state snapshots per second, independent of the 60 Hz simulation
+    [[nodiscard]] std::uint32_t SnapshotRate() const
+    {
+        std::uint32_t rate = 20;
+        mParser("snapshot-rate", rate) >> rate;
+        return std::clamp(rate, 1u, 60u);
+    }
+
+    // server: games run in lockstep, clients get every tick's actions and simulate them
+    [[nodiscard]] bool Lockstep() const { return mParser["lockstep"]; }
+
+    /**
+     * @brief Impairments applied to received datagrams, to try the game over a bad link locally
+     *
+     * Latency and jitter are in milliseconds, loss and reordering in percent, bandwidth in bytes
+     * per second.
+     */
+    [[nodiscard]] LinkConditions Link() const
+    {
+        LinkConditions link;
+        long           latency = 0, jitter = 0;
+        double         loss = 0.0, reorder = 0.0;
+
+        mParser("link-latency", latency) >> latency;
+        mParser("link-jitter", jitter) >> jitter;
+        mParser("link-loss", loss) >> loss;
+        mParser("link-reorder", reorder) >> reorder;
+        mParser("link-bandwidth", link.BandwidthBytesPerSec) >> link.BandwidthBytesPerSec;
+
+        link.Latency       = std::chrono::milliseconds(latency);
+        link.Jitter        = std::chrono::milliseconds(jitter);
+        link.LossChance    = loss / 100.0;
+        link.ReorderChance = reorder / 100.0;
+        link.ReorderDelay  = link.Latency / 2 + link.Jitter;
+        return link;
+    }
+
+    [[nodiscard]] std::uint64_t LinkSeed() const
+    {
+        std::uint64_t seed = 0;
+        mParser("link-seed", seed) >> seed;
+        return seed;
+    }
+
     std::string ServerAddr;
 
    private:
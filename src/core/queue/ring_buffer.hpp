@@ -98,6 +98,17 @@ struct RingBuffer {
     [[nodiscard]] inline value_type&   Oldest() noexcept { return mBuffer[mCtrl.m_read].value(); }
     [[nodiscard]] inline element_type& Previous() noexcept { return mBuffer[mPrevious]; }
 
+    /**
+     * @brief Element pushed aAge pushes before the latest one, Latest() being age 0
+     *
+     * Slots past the oldest element are empty or hold data from an earlier lap, callers walking
+     * back through history must stop there.
+     */
+    [[nodiscard]] inline element_type& FromLatest(std::size_t aAge) noexcept
+    {
+        return mBuffer[(mCtrl.m_current + kCapacity - aAge % kCapacity) % kCapacity];
+    }
+
     inline value_type& Discard() noexcept
     {
         auto& res = Oldest();
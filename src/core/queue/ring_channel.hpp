@@ -0,0 +1,209 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <utility>
+
+// keep producer and consumer indices on separate cache lines
+inline constexpr std::size_t kCacheLineSize = 64;
+
+/**
+ * @brief Bounded single producer, single consumer channel storing messages in place
+ *
+ * Messages are constructed directly in a fixed ring of slots: sending and draining never
+ * allocate. When the ring is full TrySend fails and the overflow counter is bumped, the producer
+ * decides whether to drop, retry later or stop producing.
+ */
+template <typename _MsgT, std::size_t _Capacity>
+class SpscRingChannel
+{
+    static_assert(std::has_single_bit(_Capacity), "capacity must be a power of two");
+
+   public:
+    using value_type = _MsgT;
+
+    static constexpr std::size_t kCapacity = _Capacity;
+
+    SpscRingChannel()                                  = default;
+    SpscRingChannel(const SpscRingChannel&)            = delete;
+    SpscRingChannel(SpscRingChannel&&)                 = delete;
+    SpscRingChannel& operator=(const SpscRingChannel&) = delete;
+    SpscRingChannel& operator=(SpscRingChannel&&)      = delete;
+    ~SpscRingChannel()                                 = default;
+
+    template <typename... Args>
+    bool TryEmplace(Args&&... aArgs)
+    {
+        const std::size_t tail = mTail.load(std::memory_order_relaxed);
+        if (tail - mHead.load(std::memory_order_acquire) == kCapacity) {
+            mOverflows.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        mSlots[tail & kMask].emplace(std::forward<Args>(aArgs)...);
+        mTail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool TrySend(_MsgT&& aMsg) { return TryEmplace(std::move(aMsg)); }
+    bool TrySend(const _MsgT& aMsg) { return TryEmplace(aMsg); }
+
+    /**
+     * @brief Pass every available message to aHandler, slots are released right after
+     *
+     * @return number of messages handled
+     */
+    template <typename Func>
+    std::size_t Drain(Func&& aHandler)
+    {
+        std::size_t       head  = mHead.load(std::memory_order_relaxed);
+        const std::size_t tail  = mTail.load(std::memory_order_acquire);
+        const std::size_t count = tail - head;
+
+        for (; head != tail; ++head) {
+            auto& slot = mSlots[head & kMask];
+            aHandler(&*slot);
+            slot.reset();
+            mHead.store(head + 1, std::memory_order_release);
+        }
+        return count;
+    }
+
+    // approximate when called from neither the producer nor the consumer
+    [[nodiscard]] std::size_t Size() const noexcept
+    {
+        return mTail.load(std::memory_order_acquire) - mHead.load(std::memory_order_acquire);
+    }
+    [[nodiscard]] std::uint64_t Overflows() const noexcept
+    {
+        return mOverflows.load(std::memory_order_relaxed);
+    }
+
+   private:
+    static constexpr std::size_t kMask = kCapacity - 1;
+
+    alignas(kCacheLineSize) std::atomic<std::size_t> mHead{0};
+    alignas(kCacheLineSize) std::atomic<std::size_t> mTail{0};
+    alignas(kCacheLineSize) std::atomic<std::uint64_t> mOverflows{0};
+
+    std::array<std::optional<_MsgT>, kCapacity> mSlots{};
+};
+
+/**
+ * @brief Bounded multiple producers, single consumer channel storing messages in place
+ *
+ * Dmitry Vyukov's bounded queue: each slot carries a sequence number telling producers whether
+ * it is free for their ticket and the consumer whether it was published. Producers only contend
+ * on the enqueue index, never on slots.
+ */
+template <typename _MsgT, std::size_t _Capacity>
+class MpscRingChannel
+{
+    static_assert(std::has_single_bit(_Capacity), "capacity must be a power of two");
+
+   public:
+    using value_type = _MsgT;
+
+    static constexpr std::size_t kCapacity = _Capacity;
+
+    MpscRingChannel()
+    {
+        for (std::size_t i = 0; i < kCapacity; ++i) {
+            mCells[i].Sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+    MpscRingChannel(const MpscRingChannel&)            = delete;
+    MpscRingChannel(MpscRingChannel&&)                 = delete;
+    MpscRingChannel& operator=(const MpscRingChannel&) = delete;
+    MpscRingChannel& operator=(MpscRingChannel&&)      = delete;
+    ~MpscRingChannel()                                 = default;
+
+    template <typename... Args>
+    bool TryEmplace(Args&&... aArgs)
+    {
+        std::size_t pos = mEnqueuePos.load(std::memory_order_relaxed);
+        Cell*       cell;
+
+        for (;;) {
+            cell = &mCells[pos & kMask];
+
+            const std::size_t seq  = cell->Sequence.load(std::memory_order_acquire);
+            const auto        diff = std::intptr_t(seq) - std::intptr_t(pos);
+            if (diff == 0) {
+                if (mEnqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                // the consumer has not released this slot yet: full
+                mOverflows.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            } else {
+                pos = mEnqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+
+        cell->Value.emplace(std::forward<Args>(aArgs)...);
+        cell->Sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool TrySend(_MsgT&& aMsg) { return TryEmplace(std::move(aMsg)); }
+    bool TrySend(const _MsgT& aMsg) { return TryEmplace(aMsg); }
+
+    /**
+     * @brief Pass every published message to aHandler, stops at the first slot still being
+     * written by a producer
+     *
+     * @return number of messages handled
+     */
+    template <typename Func>
+    std::size_t Drain(Func&& aHandler)
+    {
+        std::size_t pos   = mDequeuePos.load(std::memory_order_relaxed);
+        std::size_t count = 0;
+
+        for (;;) {
+            Cell& cell = mCells[pos & kMask];
+            if (cell.Sequence.load(std::memory_order_acquire) != pos + 1) {
+                break;
+            }
+
+            aHandler(&*cell.Value);
+            cell.Value.reset();
+            cell.Sequence.store(pos + kCapacity, std::memory_order_release);
+            ++pos;
+            ++count;
+            mDequeuePos.store(pos, std::memory_order_relaxed);
+        }
+        return count;
+    }
+
+    // approximate, producers may be in the middle of publishing
+    [[nodiscard]] std::size_t Size() const noexcept
+    {
+        return mEnqueuePos.load(std::memory_order_relaxed)
+               - mDequeuePos.load(std::memory_order_relaxed);
+    }
+    [[nodiscard]] std::uint64_t Overflows() const noexcept
+    {
+        return mOverflows.load(std::memory_order_relaxed);
+    }
+
+   private:
+    static constexpr std::size_t kMask = kCapacity - 1;
+
+    struct Cell {
+        std::atomic<std::size_t> Sequence{0};
+        std::optional<_MsgT>     Value{};
+    };
+
+    alignas(kCacheLineSize) std::atomic<std::size_t> mEnqueuePos{0};
+    alignas(kCacheLineSize) std::atomic<std::size_t> mDequeuePos{0};
+    alignas(kCacheLineSize) std::atomic<std::uint64_t> mOverflows{0};
+
+    std::array<Cell, kCapacity> mCells{};
+};
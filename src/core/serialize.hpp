@@ -122,6 +122,14 @@ class BitWriter
         return std::vector<uint8_t>(v.begin(), v.end());
     }
 
+    // start over, keeping the allocated words for the next message
+    void Clear()
+    {
+        mBuf.clear();
+        mScratch = 0;
+        mCurBit  = 0;
+    }
+
    private:
     void flush()
     {
@@ -370,6 +378,7 @@ class StreamEncoder
     }
 
     bit_buffer& Data() { return mBits.Data(); }
+    void        Clear() { mBits.Clear(); }
 
    protected:
     BitWriter mBits;
@@ -381,12 +390,13 @@ class StreamDecoder
     StreamDecoder() = default;
     StreamDecoder(bit_stream&& aBits) : mBits(std::move(aBits)) {}
     StreamDecoder(const bit_buffer& aBits) : mBits(aBits) {}
+    // aSize is in bytes, trailing bytes that do not fill a whole word are ignored
     StreamDecoder(uint8_t* aBytes, std::size_t aSize)
-        : mBits(bit_stream(std::bit_cast<word*>(aBytes), aSize))
+        : mBits(bit_stream(std::bit_cast<word*>(aBytes), aSize / sizeof(word)))
     {
     }
     StreamDecoder(const uint8_t* aBytes, std::size_t aSize)
-        : mBits(const_bit_stream(std::bit_cast<const word*>(aBytes), aSize))
+        : mBits(const_bit_stream(std::bit_cast<const word*>(aBytes), aSize / sizeof(word)))
     {
     }
 
@@ -1,5 +1,12 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <optional>
+#include <utility>
+
 #include "core/queue/ring_buffer.hpp"
 #include "core/serialize.hpp"
 #include "input/action.hpp"
@@ -8,6 +15,8 @@ struct GameState {
     uint32_t              Tick{0};
     ActionsType           Actions{};
     std::vector<uint32_t> Snapshot{};
+    // client: gold each of its own actions was predicted to cost, in order, not sent
+    std::vector<int>      PredictedCosts{};
 
     bool Archive(auto& aArchive)
     {
@@ -30,3 +39,59 @@ inline bool operator==(const GameState& aLHS, const GameState& aRHS)
 }
 
 using GameStateBuffer = RingBuffer<GameState, 128>;
+
+/**
+ * @brief Lockstep games: actions the server applied at a tick, in the order it applied them
+ *
+ * Sent to every player each tick, empty or not, a client runs a tick once it has its turn.
+ * Every kHashInterval ticks it carries the server's StateHash as of the end of the previous
+ * tick, the state the actions apply to, for clients to check theirs against.
+ */
+struct LockstepTurn {
+    static constexpr std::size_t kMaxActions   = 256;
+    static constexpr uint32_t    kHashInterval = 15;
+
+    uint32_t                     Tick{0};
+    TaggedActionsType            Actions{};
+    std::optional<std::uint64_t> Hash{};
+
+    bool Archive(auto& aArchive)
+    {
+        if (!ArchiveValue(aArchive, Tick, 0u, 30000000u)) return false;
+        if (!ArchiveVector(aArchive, Actions, kMaxActions)) return false;
+        return ArchiveOptionalVal(
+            aArchive,
+            Hash,
+            std::uint64_t(0),
+            std::numeric_limits<std::uint64_t>::max());
+    }
+
+    bool operator==(const LockstepTurn&) const = default;
+};
+
+/**
+ * @brief Client, lockstep games: turns received and not simulated yet, oldest first
+ */
+struct LockstepTurns {
+    // more ticks queued than this and the client runs faster to catch up with the server
+    static constexpr uint32_t kMaxBacklog = 6;
+
+    std::deque<LockstepTurn> Pending;
+    // newest turn received
+    uint32_t                 Received{0};
+    // newest tick whose state hash matched the server's
+    uint32_t                 Verified{0};
+
+    // turns are reliable and ordered, anything but the next tick is a protocol error
+    bool Push(LockstepTurn&& aTurn)
+    {
+        if (aTurn.Tick != Received + 1) {
+            return false;
+        }
+        Received = aTurn.Tick;
+        Pending.push_back(std::move(aTurn));
+        return true;
+    }
+
+    [[nodiscard]] bool Ready(uint32_t aTick) const noexcept { return aTick <= Received; }
+};
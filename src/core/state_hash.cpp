@@ -0,0 +1,156 @@
+#include "core/state_hash.hpp"
+
+#include <cmath>
+#include <glm/ext/vector_float3.hpp>
+#include <type_traits>
+
+#include "components/creep.hpp"
+#include "components/health.hpp"
+#include "components/player.hpp"
+#include "components/rigid_body.hpp"
+#include "components/tower.hpp"
+#include "components/transform3d.hpp"
+
+// splitmix64 finalizer
+static constexpr std::uint64_t mix(std::uint64_t aValue)
+{
+    aValue ^= aValue >> 30;
+    aValue *= 0xbf58476d1ce4e5b9ULL;
+    aValue ^= aValue >> 27;
+    aValue *= 0x94d049bb133111ebULL;
+    aValue ^= aValue >> 31;
+    return aValue;
+}
+
+static constexpr std::uint64_t combine(std::uint64_t aSeed, std::uint64_t aValue)
+{
+    return mix(aSeed + 0x9e3779b97f4a7c15ULL + aValue);
+}
+
+// to 1/1024th, far below anything gameplay tells apart, and -0 hashes as 0
+static std::uint64_t quantize(float aValue)
+{
+    return std::uint64_t(std::llround(double(aValue) * 1024.0));
+}
+
+static std::uint64_t quantize(const glm::vec3& aValue)
+{
+    return combine(combine(quantize(aValue.x), quantize(aValue.y)), quantize(aValue.z));
+}
+
+static std::uint64_t contribution(const Transform3D& aTransform)
+{
+    return quantize(aTransform.Position);
+}
+
+static std::uint64_t contribution(const RigidBody& aBody)
+{
+    return combine(quantize(aBody.Params.Direction), quantize(aBody.Params.Velocity));
+}
+
+static std::uint64_t contribution(const Health& aHealth) { return quantize(aHealth.Health); }
+
+static std::uint64_t contribution(const Gold& aGold) { return std::uint64_t(aGold.Balance); }
+
+static std::uint64_t contribution(const Owner& aOwner)
+{
+    return combine(std::uint64_t(aOwner.ID), aOwner.Slot);
+}
+
+static std::uint64_t contribution(const Tower& aTower) { return std::uint64_t(aTower.Type); }
+
+static std::uint64_t contribution(const Creep& aCreep)
+{
+    return combine(std::uint64_t(aCreep.Type), quantize(aCreep.Damage));
+}
+
+void StateHash::Watch(Registry& aRegistry)
+{
+    Unwatch(aRegistry);
+
+    watch<Transform3D, 0>(aRegistry);
+    watch<RigidBody, 1>(aRegistry);
+    watch<Health, 2>(aRegistry);
+    watch<Gold, 3>(aRegistry);
+    watch<Owner, 4>(aRegistry);
+    watch<Tower, 5>(aRegistry);
+    watch<Creep, 6>(aRegistry);
+}
+
+void StateHash::Unwatch(Registry& aRegistry)
+{
+    aRegistry.on_construct<Transform3D>().disconnect(*this);
+    aRegistry.on_update<Transform3D>().disconnect(*this);
+    aRegistry.on_destroy<Transform3D>().disconnect(*this);
+    aRegistry.on_construct<RigidBody>().disconnect(*this);
+    aRegistry.on_update<RigidBody>().disconnect(*this);
+    aRegistry.on_destroy<RigidBody>().disconnect(*this);
+    aRegistry.on_construct<Health>().disconnect(*this);
+    aRegistry.on_update<Health>().disconnect(*this);
+    aRegistry.on_destroy<Health>().disconnect(*this);
+    aRegistry.on_construct<Gold>().disconnect(*this);
+    aRegistry.on_update<Gold>().disconnect(*this);
+    aRegistry.on_destroy<Gold>().disconnect(*this);
+    aRegistry.on_construct<Owner>().disconnect(*this);
+    aRegistry.on_update<Owner>().disconnect(*this);
+    aRegistry.on_destroy<Owner>().disconnect(*this);
+    aRegistry.on_construct<Tower>().disconnect(*this);
+    aRegistry.on_update<Tower>().disconnect(*this);
+    aRegistry.on_destroy<Tower>().disconnect(*this);
+    aRegistry.on_construct<Creep>().disconnect(*this);
+    aRegistry.on_update<Creep>().disconnect(*this);
+    aRegistry.on_destroy<Creep>().disconnect(*this);
+
+    for (auto& contributions : mContributions) {
+        contributions.clear();
+    }
+    mValue = 0;
+}
+
+template <typename Component, std::size_t Slot>
+void StateHash::watch(Registry& aRegistry)
+{
+    aRegistry.on_construct<Component>().template connect<&StateHash::onSet<Component, Slot>>(
+        *this);
+    aRegistry.on_update<Component>().template connect<&StateHash::onSet<Component, Slot>>(*this);
+    aRegistry.on_destroy<Component>().template connect<&StateHash::onRemove<Slot>>(*this);
+
+    for (const entt::entity entity : aRegistry.view<Component>()) {
+        onSet<Component, Slot>(aRegistry, entity);
+    }
+}
+
+template <typename Component, std::size_t Slot>
+void StateHash::onSet(Registry& aRegistry, const entt::entity aEntity)
+{
+    // only physics bodies move in the simulation, the other transforms are client decoration
+    if constexpr (std::is_same_v<Component, Transform3D>) {
+        if (!aRegistry.all_of<RigidBody>(aEntity)) {
+            onRemove<Slot>(aRegistry, aEntity);
+            return;
+        }
+    }
+
+    // the slot salts the value, the same number in two components does not cancel out
+    const std::uint64_t value = combine(Slot, contribution(aRegistry.get<Component>(aEntity)));
+
+    auto& contributions = mContributions[Slot];
+    if (contributions.contains(aEntity)) {
+        auto& previous = contributions.get(aEntity);
+        mValue         = mValue - previous + value;
+        previous       = value;
+    } else {
+        contributions.emplace(aEntity, value);
+        mValue += value;
+    }
+}
+
+template <std::size_t Slot>
+void StateHash::onRemove([[maybe_unused]] Registry& aRegistry, const entt::entity aEntity)
+{
+    auto& contributions = mContributions[Slot];
+    if (contributions.contains(aEntity)) {
+        mValue -= contributions.get(aEntity);
+        contributions.erase(aEntity);
+    }
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <entt/entity/storage.hpp>
+
+#include "registry/registry.hpp"
+
+/**
+ * @brief Hash of the gameplay state, in the registry context, kept up to date as it changes
+ *
+ * Every hashed component adds the hash of its value and the state hash is their sum, so a change
+ * only swaps its own contribution out instead of walking the world. The sum ignores entity ids and
+ * pool order: peers agreeing on the gameplay values hash the same even if their entities got
+ * other ids. Covers Transform3D positions and RigidBody motion of physics bodies, Health, Gold,
+ * Owner, Tower and Creep.
+ *
+ * Component signals are bound to this instance, it must not move while watching a registry.
+ */
+class StateHash
+{
+   public:
+    // start over from the components aRegistry holds, and follow their changes
+    void Watch(Registry& aRegistry);
+    void Unwatch(Registry& aRegistry);
+
+    [[nodiscard]] std::uint64_t Value() const noexcept { return mValue; }
+
+   private:
+    static constexpr std::size_t kHashedComponents = 7;
+
+    template <typename Component, std::size_t Slot>
+    void watch(Registry& aRegistry);
+    template <typename Component, std::size_t Slot>
+    void onSet(Registry& aRegistry, entt::entity aEntity);
+    template <std::size_t Slot>
+    void onRemove(Registry& aRegistry, entt::entity aEntity);
+
+    // contribution of each entity, per hashed component
+    std::array<entt::storage<std::uint64_t>, kHashedComponents> mContributions;
+    std::uint64_t                                               mValue{0};
+};
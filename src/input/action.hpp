@@ -135,6 +135,14 @@ using ActionsType = std::vector<Action>;
 struct TaggedAction {
     ::PlayerID PlayerID;
     ::Action   Action;
+
+    bool Archive(auto& aArchive)
+    {
+        if (!ArchivePlayerID(aArchive, PlayerID)) return false;
+        return Action.Archive(aArchive);
+    }
+
+    bool operator==(const TaggedAction&) const = default;
 };
 
 using TaggedActionsType = std::vector<TaggedAction>;
@@ -1,15 +1,23 @@
 #include "systems/action.hpp"
 
+#include <iterator>
+#include <limits>
+#include <set>
+#include <utility>
 #include <variant>
+#include <vector>
 
 #include "components/camera.hpp"
 #include "components/creep.hpp"
 #include "components/game.hpp"
 #include "components/health.hpp"
+#include "components/model_rotation_offset.hpp"
 #include "components/net.hpp"
 #include "components/path.hpp"
 #include "components/placement_mode.hpp"
+#include "components/player.hpp"
 #include "components/rigid_body.hpp"
+#include "components/scene_object.hpp"
 #include "components/spawner.hpp"
 #include "components/tower.hpp"
 #include "components/tower_attack.hpp"
@@ -19,11 +27,13 @@
 #include "core/net/enet_server.hpp"
 #include "core/physics/physics.hpp"
 #include "core/state.hpp"
+#include "core/state_hash.hpp"
 #include "core/sys/log.hpp"
 #include "core/tower_building_handler.hpp"
 #include "core/types.hpp"
 #include "input/action.hpp"
 #include "registry/registry.hpp"
+#include "systems/replication.hpp"
 
 void moveCamera(Registry& aRegistry, const MovePayload& aPayload, float aDeltaTime)
 {
@@ -87,7 +97,111 @@ bool clientValidateTower(Registry& aRegistry, const BuildTowerPayload& aPayload)
     return true;
 }
 
-void serverBuildTower(Registry& aRegistry, BuildTowerPayload& aPayload, PlayerID aPlayerID)
+// client: take an own action's cost from the local balance, the way the server will; the cost
+// is kept with its tick to be replayed over the server's balances until it applied the tick
+static bool spendPredicted(Registry& aRegistry, PlayerID aID, int aCost, GameState& aState)
+{
+    auto  player = FindPlayerEntity(aRegistry, aID);
+    auto* gold   = aRegistry.try_get<Gold>(player);
+    if (!gold || gold->Balance < aCost) {
+        return false;
+    }
+    aRegistry.patch<Gold>(player, [aCost](Gold& aGold) { aGold.Balance -= aCost; });
+    aState.PredictedCosts.push_back(aCost);
+    return true;
+}
+
+static void predictTower(
+    Registry&                aRegistry,
+    const BuildTowerPayload& aPayload,
+    const Player&            aLocal,
+    GameState&               aState)
+{
+    const auto& def = GetTowerDef(aRegistry, aPayload.Tower);
+    if (!spendPredicted(aRegistry, aLocal.ID, def.Cost, aState)) {
+        return;
+    }
+
+    auto& phy   = GetSingletonComponent<Physics>(aRegistry);
+    auto  tower = aRegistry.create();
+
+    auto& transform    = aRegistry.emplace<Transform3D>(tower, def.Transform.ToTransform3D());
+    transform.Position = aPayload.Position;
+
+    // a body right away, the next placements and the path preview account for it
+    RigidBody body{.Params = TowerDef::kRigidBodyParams};
+    Collider  collider{.Params = TowerDef::kColliderParams};
+    body.Body       = phy.CreateRigidBody(body.Params, transform);
+    collider.Handle = phy.AddCollider(body.Body, collider.Params);
+
+    aRegistry.emplace<Tower>(tower, aPayload.Tower);
+    aRegistry.emplace<RigidBody>(tower, body);
+    aRegistry.emplace<Collider>(tower, collider);
+    aRegistry.emplace<Health>(tower, def.Health);
+    aRegistry.emplace<SceneObject>(tower, def.Model.Object);
+    aRegistry.emplace<Owner>(tower, aLocal.ID, aLocal.Slot);
+    aRegistry.emplace<Predicted>(tower, aState.Tick);
+
+    WATO_DBG(aRegistry, "predicted tower {} at {}", tower, aPayload.Position);
+}
+
+static void predictCreep(
+    Registry&               aRegistry,
+    const SendCreepPayload& aPayload,
+    const Player&           aLocal,
+    GameState&              aState)
+{
+    entt::entity spawn = GetTargetSpawnFor(aRegistry, aLocal.ID);
+    if (spawn == entt::null) {
+        return;
+    }
+    const auto& def = GetCreepDef(aRegistry, aPayload.Type);
+    if (!spendPredicted(aRegistry, aLocal.ID, def.Cost, aState)) {
+        return;
+    }
+
+    // held at the spawn, it moves once replicated
+    auto  creep        = aRegistry.create();
+    auto& transform    = aRegistry.emplace<Transform3D>(creep, def.Transform.ToTransform3D());
+    transform.Position = aRegistry.get<Transform3D>(spawn).Position;
+
+    aRegistry.emplace<ModelRotationOffset>(creep, transform.Orientation);
+    aRegistry.emplace<Creep>(creep, aPayload.Type, def.Damage);
+    aRegistry.emplace<Health>(creep, def.Health);
+    aRegistry.emplace<Owner>(creep, aLocal.ID, aLocal.Slot);
+    aRegistry.emplace<SceneObject>(creep, def.Model.Object);
+    aRegistry.emplace<Predicted>(creep, aState.Tick);
+
+    WATO_DBG(aRegistry, "predicted creep {}", creep);
+}
+
+int clientReplayGold(Registry& aRegistry, int aBalance, std::uint32_t aAppliedTick)
+{
+    auto& buf = GetSingletonComponent<GameStateBuffer&>(aRegistry);
+
+    // ticks the server had not applied, newest first
+    std::vector<const GameState*> pending;
+    uint32_t                      newer = std::numeric_limits<uint32_t>::max();
+    for (std::size_t age = 0; age < GameStateBuffer::kCapacity; ++age) {
+        const auto& state = buf.FromLatest(age);
+        if (!state || state->Tick >= newer || state->Tick < aAppliedTick) {
+            break;
+        }
+        newer = state->Tick;
+        pending.push_back(&*state);
+    }
+
+    for (auto it = pending.rbegin(); it != pending.rend(); ++it) {
+        for (const int cost : (*it)->PredictedCosts) {
+            if (aBalance >= cost) {
+                aBalance -= cost;
+            }
+        }
+    }
+    return aBalance;
+}
+
+bool serverBuildTower(Registry& aRegistry, BuildTowerPayload& aPayload, PlayerID aPlayerID)
 {
     auto& graphMap = GetSingletonComponent<PlayerGraphMap>(aRegistry);
     auto  it       = graphMap.find(aPlayerID);
@@ -97,17 +211,17 @@ void serverBuildTower(Registry& aRegistry, BuildTowerPayload& aPayload, PlayerID
 
     if (it == graphMap.end()) {
         WATO_ERR(aRegistry, "cannot find graph for target player {}", aPlayerID);
-        return;
+        return false;
     }
     const auto& graph = it->second;
     if (!graph.IsInside(aPayload.Position)) {
         WATO_ERR(aRegistry, "trying to place tower outside map bounds.");
-        return;
+        return false;
     }
 
     if (towerDefIt == defs.Towers.end()) {
         WATO_ERR(aRegistry, "unknown tower type {}", TowerTypeToString(aPayload.Tower));
-        return;
+        return false;
     }
     const auto& towerDef = towerDefIt->second;
 
@@ -120,9 +234,11 @@ void serverBuildTower(Registry& aRegistry, BuildTowerPayload& aPayload, PlayerID
             aPlayerID,
             gold.Balance,
             towerDef.Cost);
-        return;
+        return false;
     }
-    gold.Balance -= towerDef.Cost;
+    aRegistry.patch<Gold>(playerEntity, [&towerDef](Gold& aGold) {
+        aGold.Balance -= towerDef.Cost;
+    });
 
     auto& player = aRegistry.get<Player>(playerEntity);
     auto  tower  = aRegistry.create();
@@ -136,7 +252,7 @@ void serverBuildTower(Registry& aRegistry, BuildTowerPayload& aPayload, PlayerID
     if (!CanPlaceTower(phy, t3D.Position, colliderParams, WATO_REG_LOGGER(aRegistry))) {
         aRegistry.destroy(tower);
         WATO_ERR(aRegistry, "tower {} at {} invalidated", tower, t3D.Position);
-        return;
+        return false;
     }
 
     auto body = RigidBody{
@@ -156,7 +272,7 @@ void serverBuildTower(Registry& aRegistry, BuildTowerPayload& aPayload, PlayerID
 
     aRegistry.emplace<Owner>(tower, aPlayerID, player.Slot);
 
-    if (auto* server = aRegistry.ctx().find<ENetServer>()) {
+    if (auto* server = FindReplicatingServer(aRegistry)) {
         auto tick = GetSingletonComponent<GameInstance&>(aRegistry).Tick;
         server->BroadcastResponse(
             GetPlayerIDs(aRegistry),
@@ -176,23 +292,19 @@ void serverBuildTower(Registry& aRegistry, BuildTowerPayload& aPayload, PlayerID
                         .ColliderParams = collider.Params,
                     },
             });
-        server->BroadcastResponse(
-            GetPlayerIDs(aRegistry),
-            PacketType::Ack,
-            tick,
-            GoldUpdateResponse{.Player = aPlayerID, .Balance = gold.Balance});
     }
+    return true;
 }
 
-void serverSendCreep(Registry& aRegistry, SendCreepPayload& aPayload, PlayerID aPlayerID)
+bool serverSendCreep(Registry& aRegistry, SendCreepPayload& aPayload, PlayerID aPlayerID)
 {
     entt::entity nextSpawn = GetTargetSpawnFor(aRegistry, aPlayerID);
     if (nextSpawn == entt::null) {
         WATO_ERR(aRegistry, "cannot find target spawn for player {}", aPlayerID);
-        return;
+        return false;
     }
     const auto& creepDef = GetCreepDef(aRegistry, aPayload.Type);
-    auto*       server   = aRegistry.ctx().find<ENetServer>();
+    auto*       server   = FindReplicatingServer(aRegistry);
 
     auto  playerEntity = FindPlayerEntity(aRegistry, aPlayerID);
     auto& gold         = aRegistry.get<Gold>(playerEntity);
@@ -203,7 +315,7 @@ void serverSendCreep(Registry& aRegistry, SendCreepPayload& aPayload, PlayerID a
             aPlayerID,
             gold.Balance,
             creepDef.Cost);
-        return;
+        return false;
     }
     auto& player = aRegistry.get<Player>(playerEntity);
 
@@ -215,11 +327,13 @@ void serverSendCreep(Registry& aRegistry, SendCreepPayload& aPayload, PlayerID a
 
     if (it == graphMap.end()) {
         WATO_ERR(aRegistry, "cannot find graph for target player {}", spawnOwner.ID);
-        return;
+        return false;
     }
     const auto& graph = it->second;
 
-    gold.Balance                               -= creepDef.Cost;
+    aRegistry.patch<Gold>(playerEntity, [&creepDef](Gold& aGold) {
+        aGold.Balance -= creepDef.Cost;
+    });
     aRegistry.ctx().get<CommonIncome&>().Value += creepDef.SendIncome;
 
     auto  creep  = aRegistry.create();
@@ -233,12 +347,10 @@ void serverSendCreep(Registry& aRegistry, SendCreepPayload& aPayload, PlayerID a
         graph.CellFromWorld(spawnTransform.Position),
         graph.GetNextCell(spawnTransform.Position));
 
-    auto& body = aRegistry.emplace<RigidBody>(
-        creep,
-        RigidBody{
-            .Params = CreepDef::kRigidBodyParams,
-        });
-    body.Params.Velocity = creepDef.Speed;
+    RigidBodyParams bodyParams = CreepDef::kRigidBodyParams;
+    bodyParams.Velocity        = creepDef.Speed;
+
+    auto& body = aRegistry.emplace<RigidBody>(creep, RigidBody{.Params = bodyParams});
 
     auto& collider = aRegistry.emplace<Collider>(
         creep,
@@ -274,17 +386,13 @@ void serverSendCreep(Registry& aRegistry, SendCreepPayload& aPayload, PlayerID a
                         .ColliderParams = collider.Params,
                     },
             });
-        server->BroadcastResponse(
-            playerIDs,
-            PacketType::Ack,
-            tick,
-            GoldUpdateResponse{.Player = aPlayerID, .Balance = gold.Balance});
         server->BroadcastResponse(
             playerIDs,
             PacketType::Ack,
             tick,
             CommonIncomeUpdateResponse{.Value = aRegistry.ctx().get<CommonIncome>().Value});
     }
+    return true;
 }
 
 void RealTimeActionSystem::Execute(Registry& aRegistry, float aDelta)
@@ -308,16 +416,26 @@ void DeterministicActionSystem::Execute(Registry& aRegistry, [[maybe_unused]] st
 {
     auto& buf   = GetSingletonComponent<GameStateBuffer&>(aRegistry);
     auto& stack = GetSingletonComponent<ActionContextStack&>(aRegistry);
+    auto& state = buf.Latest();
+
+    // own actions show at once and the server's replies confirm or roll them back, lockstep
+    // clients apply them with everyone else's in the ServerActionSystem instead
+    const auto* local    = aRegistry.ctx().find<Player>("player"_hs);
+    const auto* instance = aRegistry.ctx().find<GameInstance>();
+    const bool  predict  = local && instance && !instance->Lockstep;
 
-    for (Action& action : buf.Latest().Actions) {
+    for (Action& action : state.Actions) {
         if (auto* p = std::get_if<BuildTowerPayload>(&action.Payload)) {
-            if (stack.GetState<PlacementState>()) {
-                if (clientValidateTower(aRegistry, *p)) {
-                    stack.ExitPlacement(aRegistry);
+            if (stack.GetState<PlacementState>() && clientValidateTower(aRegistry, *p)) {
+                stack.ExitPlacement(aRegistry);
+                if (predict) {
+                    predictTower(aRegistry, *p, *local, state);
                 }
             }
-        } else if (std::get_if<SendCreepPayload>(&action.Payload)) {
-            // client no-op, server handles
+        } else if (auto* creep = std::get_if<SendCreepPayload>(&action.Payload)) {
+            if (predict) {
+                predictCreep(aRegistry, *creep, *local, state);
+            }
         } else {
             WATO_TRACE(aRegistry, "unhandled fixed-time action: {}", action);
         }
@@ -327,15 +445,127 @@ void DeterministicActionSystem::Execute(Registry& aRegistry, [[maybe_unused]] st
 void ServerActionSystem::Execute(Registry& aRegistry, [[maybe_unused]] std::uint32_t aTick)
 {
     auto& taggedActions = GetSingletonComponent<TaggedActionsType>(aRegistry);
+    auto& instance      = GetSingletonComponent<GameInstance&>(aRegistry);
+    auto* server        = aRegistry.ctx().find<ENetServer>();
+
+    // lockstep clients apply the same actions at the same tick, the turn is sent every tick so
+    // they know they can run it; what does not fit in a turn waits for the next one
+    TaggedActionsType deferred;
+    if (server && instance.Lockstep) {
+        if (taggedActions.size() > LockstepTurn::kMaxActions) {
+            deferred.assign(
+                std::make_move_iterator(taggedActions.begin() + LockstepTurn::kMaxActions),
+                std::make_move_iterator(taggedActions.end()));
+            taggedActions.resize(LockstepTurn::kMaxActions);
+        }
+        LockstepTurn turn{.Tick = aTick, .Actions = taggedActions};
+        // nothing ran yet this tick, the hash is the state the actions apply to
+        if (const auto* hash = aRegistry.ctx().find<StateHash>();
+            hash && aTick % LockstepTurn::kHashInterval == 0) {
+            turn.Hash = hash->Value();
+        }
+        server->BroadcastResponse(
+            GetPlayerIDs(aRegistry),
+            PacketType::ServerSync,
+            aTick,
+            std::move(turn));
+    }
+
+    // players whose gold an action spent, and those with a rejected action to roll back
+    std::set<PlayerID> spent;
+    std::set<PlayerID> rejected;
 
     for (auto& [playerID, action] : taggedActions) {
+        bool applied = true;
         if (auto* build = std::get_if<BuildTowerPayload>(&action.Payload)) {
-            serverBuildTower(aRegistry, *build, playerID);
+            applied = serverBuildTower(aRegistry, *build, playerID);
         } else if (auto* creep = std::get_if<SendCreepPayload>(&action.Payload)) {
-            serverSendCreep(aRegistry, *creep, playerID);
+            applied = serverSendCreep(aRegistry, *creep, playerID);
         } else {
             WATO_TRACE(aRegistry, "unhandled server action: {}", action);
+            continue;
         }
+        (applied ? spent : rejected).insert(playerID);
+    }
+    taggedActions = std::move(deferred);
+
+    // every input received so far was in the batch, the balances are stamped once all of it is
+    // applied so that a client does not drop the predictions of a tick only partly applied
+    if (auto* inputs = aRegistry.ctx().find<ClientInputTicks>()) {
+        inputs->Applied = inputs->Next;
+    }
+
+    auto* replicating = FindReplicatingServer(aRegistry);
+    if (replicating == nullptr) {
+        return;
     }
-    taggedActions.clear();
+    for (PlayerID playerID : spent) {
+        replicating->BroadcastResponse(
+            GetPlayerIDs(aRegistry),
+            PacketType::Ack,
+            aTick,
+            GoldUpdateFor(aRegistry, playerID));
+    }
+    // the player's client predicted the action, its balance tells it to roll back
+    for (PlayerID playerID : rejected) {
+        if (!spent.contains(playerID)) {
+            replicating->SendResponse(
+                playerID,
+                PacketType::Ack,
+                aTick,
+                GoldUpdateFor(aRegistry, playerID));
+        }
+    }
+}
+
+void LockstepTurnSystem::Execute(Registry& aRegistry, std::uint32_t aTick)
+{
+    auto& turns         = GetSingletonComponent<LockstepTurns>(aRegistry);
+    auto& taggedActions = GetSingletonComponent<TaggedActionsType>(aRegistry);
+
+    // SimulationSystem does not run a tick before its turn arrived
+    if (turns.Pending.empty() || turns.Pending.front().Tick != aTick) {
+        WATO_ERR(aRegistry, "no lockstep turn for tick {}", aTick);
+        return;
+    }
+
+    LockstepTurn& turn = turns.Pending.front();
+    if (turn.Hash) {
+        checkStateHash(aRegistry, turns, *turn.Hash, aTick);
+    }
+
+    taggedActions = std::move(turn.Actions);
+    turns.Pending.pop_front();
+}
+
+void LockstepTurnSystem::checkStateHash(
+    Registry&           aRegistry,
+    LockstepTurns&      aTurns,
+    const std::uint64_t aServerHash,
+    const std::uint32_t aTick)
+{
+    auto&       instance = GetSingletonComponent<GameInstance&>(aRegistry);
+    const auto* hash     = aRegistry.ctx().find<StateHash>();
+    if (!hash) {
+        return;
+    }
+
+    // both hashes are of the state at the end of the previous tick
+    if (hash->Value() == aServerHash) {
+        aTurns.Verified = aTick - 1;
+        return;
+    }
+    if (instance.Desync) {
+        return;
+    }
+
+    instance.Desync = aTick - 1;
+    WATO_ERR(
+        aRegistry,
+        "state diverged from the server at tick {}, hash {:016x} instead of {:016x}, last matched "
+        "at tick {}",
+        aTick - 1,
+        hash->Value(),
+        aServerHash,
+        aTurns.Verified);
 }
@@ -3,10 +3,16 @@
 #include "input/action.hpp"
 #include "systems/system.hpp"
 
+struct LockstepTurns;
+
 void moveCamera(Registry& aRegistry, const MovePayload& aPayload, float aDeltaTime);
 bool clientValidateTower(Registry& aRegistry, const BuildTowerPayload& aPayload);
-void serverBuildTower(Registry& aRegistry, BuildTowerPayload& aPayload, PlayerID aPlayerID);
-void serverSendCreep(Registry& aRegistry, SendCreepPayload& aPayload, PlayerID aPlayerID);
+// local balance: aBalance of the server with the own actions it had not applied at aAppliedTick
+// replayed on top, as the server will apply them
+int  clientReplayGold(Registry& aRegistry, int aBalance, std::uint32_t aAppliedTick);
+// false when the action is rejected, nothing applied
+bool serverBuildTower(Registry& aRegistry, BuildTowerPayload& aPayload, PlayerID aPlayerID);
+bool serverSendCreep(Registry& aRegistry, SendCreepPayload& aPayload, PlayerID aPlayerID);
 
 /**
  * @brief Real-time action system (frame time)
@@ -45,6 +51,9 @@ class DeterministicActionSystem : public FixedSystem
  *
  * Processes server-side actions with authority.
  * Runs at deterministic 60 FPS.
+ *
+ * In lockstep games the server sends the actions of each tick to every player as a LockstepTurn,
+ * and the clients run this system too.
  */
 class ServerActionSystem : public FixedSystem
 {
@@ -54,3 +63,27 @@ class ServerActionSystem : public FixedSystem
    protected:
     void Execute(Registry& aRegistry, std::uint32_t aTick) override;
 };
+
+/**
+ * @brief Lockstep turn system (fixed timestep)
+ *
+ * Client of a lockstep game: hands the actions the server applied at this tick to the
+ * ServerActionSystem, which runs next, so the client simulates the tick the way the server did.
+ * Checks the StateHash against the server's when the turn carries it, the first divergent tick
+ * is logged and reported to the server with the inputs.
+ */
+class LockstepTurnSystem : public FixedSystem
+{
+   public:
+    using FixedSystem::FixedSystem;
+
+   protected:
+    void Execute(Registry& aRegistry, std::uint32_t aTick) override;
+
+   private:
+    void checkStateHash(
+        Registry&      aRegistry,
+        LockstepTurns& aTurns,
+        std::uint64_t  aServerHash,
+        std::uint32_t  aTick);
+};
@@ -37,13 +37,10 @@ void AiSystem::Execute(Registry& aRegistry, [[maybe_unused]] std::uint32_t aTick
             p.NextCell = graph.GetNextCell(c);
             p.LastFrom = c;
             WATO_TRACE(aRegistry, "set next cell = {} and last from = {}", p.NextCell, p.LastFrom);
-        } else if (p.NextCell != graph.GetNextCell(p.LastFrom)) {
+        } else if (auto next = graph.GetNextCell(p.LastFrom); p.NextCell != next) {
             // the path has probably been updated (tower built)
-            WATO_TRACE(
-                aRegistry,
-                "path updated, setting next cell = ",
-                graph.GetNextCell(p.LastFrom));
-            p.NextCell = graph.GetNextCell(p.LastFrom);
+            WATO_TRACE(aRegistry, "path updated, setting next cell = {}", next);
+            p.NextCell = next;
         }
 
         aRegistry.patch<RigidBody>(e, [&p, &c](RigidBody& aBody) {
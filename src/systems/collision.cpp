@@ -1,7 +1,7 @@
 #include "systems/collision.hpp"
 
 #include <tuple>
-#include <unordered_set>
+#include <vector>
 
 #include "components/creep.hpp"
 #include "components/game.hpp"
@@ -13,6 +13,20 @@
 #include "core/physics/physics_event_listener.hpp"
 #include "core/sys/log.hpp"
 #include "registry/registry.hpp"
+#include "systems/replication.hpp"
+
+// creep hit by aProjectile overlapping aHit and aOther in the same step, null aHit for terrain: its
+// target, or else the lowest entity, whatever the order reactphysics3d reported the overlaps in
+static entt::entity pickHit(const Projectile& aProjectile, entt::entity aHit, entt::entity aOther)
+{
+    if (aHit == entt::null || aOther == aProjectile.Target) {
+        return aOther;
+    }
+    if (aHit == aProjectile.Target) {
+        return aHit;
+    }
+    return entt::to_integral(aOther) < entt::to_integral(aHit) ? aOther : aHit;
+}
 
 void CollisionSystem::Execute(Registry& aRegistry, [[maybe_unused]] std::uint32_t aTick)
 {
@@ -23,8 +37,7 @@ void CollisionSystem::Execute(Registry& aRegistry, [[maybe_unused]] std::uint32_
 
     const auto& colliderMap = GetSingletonComponent<ColliderEntityMap>(aRegistry);
 
-    // Track projectiles to destroy after processing all collisions
-    std::unordered_set<entt::entity> entitiesToDestroy;
+    hits_type hits;
 
     for (const auto& event : listener->GetEvents()) {
         if (event.Event != rp3d::OverlapCallback::OverlapPair::EventType::OverlapStart) {
@@ -35,23 +48,32 @@ void CollisionSystem::Execute(Registry& aRegistry, [[maybe_unused]] std::uint32_
             continue;
         }
 
-        projectileHits(aRegistry, event, entitiesToDestroy);
+        projectileHits(aRegistry, event, hits);
         creepHitsPlayerBase(aRegistry, event);
     }
 
-    for (entt::entity e : entitiesToDestroy) {
-        if (aRegistry.valid(e)) {
-            aRegistry.destroy(e);
+    // in pool order, neither the map's nor the order reactphysics3d reports overlaps in is the
+    // same for every participant of a lockstep game, and the last hit decides the kill reward
+    std::vector<entt::entity> destroyed;
+    for (entt::entity e : aRegistry.view<Projectile>()) {
+        if (auto it = hits.find(e); it != hits.end()) {
+            if (it->second != entt::null) {
+                applyHit(aRegistry, e, it->second);
+            }
+            destroyed.push_back(e);
         }
     }
+    for (entt::entity e : destroyed) {
+        aRegistry.destroy(e);
+    }
 
     listener->ClearEvents();
 }
 
 void CollisionSystem::projectileHits(
-    Registry&                         aRegistry,
-    const TriggerEvent&               aEvent,
-    std::unordered_set<entt::entity>& aToDestroy)
+    Registry&           aRegistry,
+    const TriggerEvent& aEvent,
+    hits_type&          aHits)
 {
     const auto&           colliderMap     = GetSingletonComponent<ColliderEntityMap>(aRegistry);
     const rp3d::Collider* projCollider    = nullptr;
@@ -70,63 +92,31 @@ void CollisionSystem::projectileHits(
     }
 
     entt::entity projectileEntity = colliderMap.at(projCollider);
-    if (!aRegistry.valid(projectileEntity) || aToDestroy.contains(projectileEntity)) {
+    if (!aRegistry.valid(projectileEntity)) {
+        return;
+    }
+    const auto* projectile = aRegistry.try_get<Projectile>(projectileEntity);
+    if (!projectile) {
         return;
     }
 
     if (targetCollider) {
         entt::entity targetEntity = colliderMap.at(targetCollider);
-
         WATO_DBG(aRegistry, "projectile {} hits target {}", projectileEntity, targetEntity);
-        auto* projectile = aRegistry.try_get<Projectile>(projectileEntity);
-        if (!projectile) {
-            return;
-        }
-
-        if (aRegistry.valid(targetEntity)) {
-            auto* health = aRegistry.try_get<Health>(targetEntity);
-            auto* creep  = aRegistry.try_get<Creep>(targetEntity);
 
-            if (health && creep) {
-                aRegistry.patch<Health>(targetEntity, [&projectile](Health& aHealth) {
-                    aHealth.Health -= projectile->Damage;
-                    aHealth.LastHitBy = projectile->OwnerID;
-                });
-                WATO_INFO(
-                    aRegistry,
-                    "projectile {} hit creep {}, health now {}",
-                    projectileEntity,
-                    targetEntity,
-                    health->Health);
-
-                if (auto* server = aRegistry.ctx().find<ENetServer>()) {
-                    server->BroadcastResponse(
-                        GetPlayerIDs(aRegistry),
-                        PacketType::Ack,
-                        GetSingletonComponent<GameInstance&>(aRegistry).Tick,
-
-                        HealthUpdateResponse{
-                            .Entity = targetEntity,
-                            .Health = health->Health,
-                        });
-                }
-            }
+        auto [it, inserted] = aHits.try_emplace(projectileEntity, targetEntity);
+        if (!inserted) {
+            it->second = pickHit(*projectile, it->second, targetEntity);
         }
-        WATO_INFO(
-            aRegistry,
-            "marking projectile {} for destruction (target hit)",
-            projectileEntity);
-        aToDestroy.insert(projectileEntity);
     } else if (terrainCollider) {
         // Projectile hit terrain - only destroy if target is invalid or else projectile
         // can get destroy without damaging creep
-        auto* projectile = aRegistry.try_get<Projectile>(projectileEntity);
-        if (projectile && !aRegistry.valid(projectile->Target)) {
+        if (!aRegistry.valid(projectile->Target)) {
             WATO_INFO(
                 aRegistry,
                 "marking projectile {} for destruction (terrain, target invalid)",
                 projectileEntity);
-            aToDestroy.insert(projectileEntity);
+            aHits.try_emplace(projectileEntity, entt::null);
         } else {
             WATO_DBG(
                 aRegistry,
@@ -136,6 +126,30 @@ void CollisionSystem::projectileHits(
     }
 }
 
+void CollisionSystem::applyHit(Registry& aRegistry, entt::entity aProjectile, entt::entity aTarget)
+{
+    const auto& projectile = aRegistry.get<Projectile>(aProjectile);
+
+    if (aRegistry.valid(aTarget)) {
+        auto* health = aRegistry.try_get<Health>(aTarget);
+        auto* creep  = aRegistry.try_get<Creep>(aTarget);
+
+        if (health && creep) {
+            aRegistry.patch<Health>(aTarget, [&projectile](Health& aHealth) {
+                aHealth.Health -= projectile.Damage;
+                aHealth.LastHitBy = projectile.OwnerID;
+            });
+            WATO_INFO(
+                aRegistry,
+                "projectile {} hit creep {}, health now {}",
+                aProjectile,
+                aTarget,
+                health->Health);
+        }
+    }
+    WATO_INFO(aRegistry, "destroying projectile {} (target hit)", aProjectile);
+}
+
 void CollisionSystem::creepHitsPlayerBase(Registry& aRegistry, const TriggerEvent& aEvent)
 {
     const auto& colliderMap = GetSingletonComponent<ColliderEntityMap>(aRegistry);
@@ -163,7 +177,7 @@ void CollisionSystem::creepHitsPlayerBase(Registry& aRegistry, const TriggerEven
             health.Health);
 
         aRegistry.patch<Health>(creepEntity, [](Health& aHealth) { aHealth.Health = 0.0f; });
-        if (auto* server = aRegistry.ctx().find<ENetServer>()) {
+        if (auto* server = FindReplicatingServer(aRegistry)) {
             server->BroadcastResponse(
                 GetPlayerIDs(aRegistry),
                 PacketType::Ack,
@@ -1,6 +1,6 @@
 #pragma once
 
-#include <unordered_set>
+#include <unordered_map>
 
 #include "core/physics/physics_event_listener.hpp"
 #include "systems/system.hpp"
@@ -20,9 +20,10 @@ class CollisionSystem : public FixedSystem
     void Execute(Registry& aRegistry, std::uint32_t aTick) override;
 
    private:
-    void projectileHits(
-        Registry&                         aRegistry,
-        const TriggerEvent&               aEvent,
-        std::unordered_set<entt::entity>& aToDestroy);
+    // projectiles to destroy this tick and the creep each hits, null when it only hit terrain
+    using hits_type = std::unordered_map<entt::entity, entt::entity>;
+
+    void projectileHits(Registry& aRegistry, const TriggerEvent& aEvent, hits_type& aHits);
+    void applyHit(Registry& aRegistry, entt::entity aProjectile, entt::entity aTarget);
     void creepHitsPlayerBase(Registry& aRegistry, const TriggerEvent& aEvent);
 };
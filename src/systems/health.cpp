@@ -21,13 +21,14 @@ void HealthSystem::Execute(Registry& aRegistry, [[maybe_unused]] std::uint32_t a
             WATO_INFO(aRegistry, "creep {} died (health: {})", entity, health.Health);
 
             if (health.LastHitBy != PlayerID{}) {
-                auto  killerEntity = FindPlayerEntity(aRegistry, health.LastHitBy);
-                auto* killerGold   = aRegistry.try_get<Gold>(killerEntity);
-                if (killerGold) {
+                auto killerEntity = FindPlayerEntity(aRegistry, health.LastHitBy);
+                if (aRegistry.all_of<Gold>(killerEntity)) {
                     const auto& defs = aRegistry.ctx().get<const GameplayDef&>();
                     auto        it   = defs.Creeps.find(creep.Type);
                     if (it != defs.Creeps.end()) {
-                        killerGold->Balance += it->second.KillReward;
+                        aRegistry.patch<Gold>(killerEntity, [&it](Gold& aGold) {
+                            aGold.Balance += it->second.KillReward;
+                        });
                     }
                 }
             }
@@ -0,0 +1,32 @@
+#include "systems/interpolation.hpp"
+
+#include "components/interpolation.hpp"
+#include "components/rigid_body.hpp"
+#include "components/transform3d.hpp"
+#include "registry/registry.hpp"
+
+void InterpolationSystem::Execute(Registry& aRegistry, const float aDelta)
+{
+    auto* clock = aRegistry.ctx().find<InterpolationClock>();
+    if (!clock) {
+        return;
+    }
+    clock->Advance(aDelta * float(GameTick::period::den));
+    if (!clock->Started) {
+        return;
+    }
+
+    for (auto&& [entity, buffer, transform] :
+         aRegistry.view<InterpolationBuffer, Transform3D>().each()) {
+        const auto position = buffer.At(clock->Tick);
+        if (!position) {
+            continue;
+        }
+        transform.Position = *position;
+
+        // keep the local body along, picking and triggers use it
+        if (auto* body = aRegistry.try_get<RigidBody>(entity); body && body->Body) {
+            body->Body->setTransform(transform.ToRP3D());
+        }
+    }
+}
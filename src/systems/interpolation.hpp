@@ -0,0 +1,19 @@
+#pragma once
+
+#include "systems/system.hpp"
+
+/**
+ * @brief Replicated entity interpolation system (frame time)
+ *
+ * Renders entities with an InterpolationBuffer at the InterpolationClock tick, between the
+ * states the server replicated, instead of where the local simulation puts them.
+ * Must run after SimulationSystem.
+ */
+class InterpolationSystem : public FrameSystem
+{
+   public:
+    using FrameSystem::FrameSystem;
+
+   protected:
+    void Execute(Registry& aRegistry, float aDelta) override;
+};
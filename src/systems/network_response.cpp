@@ -1,12 +1,19 @@
 #include "systems/network_response.hpp"
 
+#include <algorithm>
 #include <entt/core/fwd.hpp>
+#include <glm/geometric.hpp>
+#include <limits>
+#include <span>
 
 #include "components/animator.hpp"
 #include "components/creep.hpp"
+#include "components/game.hpp"
 #include "components/health.hpp"
 #include "components/imgui.hpp"
+#include "components/interpolation.hpp"
 #include "components/model_rotation_offset.hpp"
+#include "components/net.hpp"
 #include "components/player.hpp"
 #include "components/projectile.hpp"
 #include "components/rigid_body.hpp"
@@ -15,41 +22,67 @@
 #include "components/tower_attack.hpp"
 #include "components/transform3d.hpp"
 #include "core/gameplay_definitions.hpp"
+#include "core/graph.hpp"
+#include "core/net/entity_sync_map.hpp"
+#include "core/net/network_events.hpp"
 #include "core/physics/physics.hpp"
 #include "core/snapshot.hpp"
 #include "core/sys/log.hpp"
 #include "core/types.hpp"
 #include "registry/registry.hpp"
+#include "systems/action.hpp"
 
 using namespace entt::literals;
 
-void NetworkResponseSystem::ensureConnected(entt::dispatcher& aDispatcher)
+// a tower held its cells out of the local path, give them back before it goes
+static void dropPredicted(Registry& aRegistry, entt::entity aEntity)
 {
-    if (mConnected) {
-        return;
+    auto* body = aRegistry.try_get<RigidBody>(aEntity);
+    if (aRegistry.all_of<Tower>(aEntity) && body && body->Body
+        && aRegistry.ctx().contains<Graph>()) {
+        auto& graph = GetSingletonComponent<Graph>(aRegistry);
+        GetSingletonComponent<Physics>(aRegistry)
+            .ToggleObstacle(body->Body->getCollider(0), graph, false);
+        graph.GridDirty = true;
     }
-
-    aDispatcher.sink<RigidBodyUpdateEvent>().connect<&NetworkResponseSystem::onRigidBodyUpdate>(
-        *this);
-    aDispatcher.sink<HealthUpdateEvent>().connect<&NetworkResponseSystem::onHealthUpdate>(*this);
-    aDispatcher.sink<GoldUpdateEvent>().connect<&NetworkResponseSystem::onGoldUpdate>(*this);
-    aDispatcher.sink<SyncPayloadEvent>().connect<&NetworkResponseSystem::onSyncPayload>(*this);
-
-    mConnected = true;
+    WATO_DBG(aRegistry, "dropping predicted entity {}", aEntity);
+    aRegistry.destroy(aEntity);
 }
 
 void NetworkResponseSystem::Execute(Registry& aRegistry, [[maybe_unused]] std::uint32_t aTick)
 {
-    auto& dispatcher = aRegistry.ctx().get<entt::dispatcher>("net_dispatcher"_hs);
+    auto& responses = GetSingletonComponent<NetworkResponseQueue>(aRegistry);
 
-    ensureConnected(dispatcher);
-    dispatcher.update();
+    // creates and destroys keep their order, the later passes find the entities they target
+    for (const RigidBodyUpdateResponse& update : responses.Bodies) {
+        applyRigidBodyUpdate(aRegistry, update);
+    }
+    applyHealthUpdates(aRegistry, responses.Health);
+    applyGoldUpdates(aRegistry, responses.Gold);
+    for (const SyncPayload& payload : responses.Syncs) {
+        applySyncPayload(aRegistry, payload);
+    }
+    for (const SnapshotResponse& snapshot : responses.Snapshots) {
+        applySnapshot(aRegistry, snapshot);
+    }
+    responses.Clear();
+
+    // the server applied these ticks without creating what was predicted in them: rejected
+    const auto& instance = GetSingletonComponent<GameInstance&>(aRegistry);
+    auto        stale    = aRegistry.view<Predicted>();
+    for (auto it = stale.begin(); it != stale.end();) {
+        const entt::entity entity = *it++;
+        if (stale.get<Predicted>(entity).Tick < instance.AppliedInputTick) {
+            dropPredicted(aRegistry, entity);
+        }
+    }
 }
-void NetworkResponseSystem::onRigidBodyUpdate(const RigidBodyUpdateEvent& aEvent)
+
+void NetworkResponseSystem::applyRigidBodyUpdate(
+    Registry&                      aRegistry,
+    const RigidBodyUpdateResponse& aUpdate)
 {
-    Registry&   registry = *aEvent.Reg;
-    const auto& update   = aEvent.Response;
-    auto&       syncMap  = GetSingletonComponent<EntitySyncMap>(registry);
+    auto& syncMap = GetSingletonComponent<EntitySyncMap>(aRegistry);
 
     struct EntityCreateVisitor {
         NetworkResponseSystem*         Self;
@@ -74,96 +107,205 @@ void NetworkResponseSystem::onRigidBodyUpdate(const RigidBodyUpdateEvent& aEvent
         }
     };
 
-    switch (update.Event) {
+    switch (aUpdate.Event) {
         case RigidBodyEvent::Create: {
-            std::visit(EntityCreateVisitor{this, &registry, &update}, update.InitData);
+            std::visit(EntityCreateVisitor{this, &aRegistry, &aUpdate}, aUpdate.InitData);
             break;
         }
         case RigidBodyEvent::Update: {
-            if (syncMap.contains(update.Entity)) {
-                registry.patch<RigidBody>(syncMap[update.Entity], [&update](RigidBody& aBody) {
-                    aBody.Params = update.Params;
+            entt::entity entity = syncMap.Find(aUpdate.Entity);
+            if (entity != entt::null) {
+                aRegistry.patch<RigidBody>(entity, [&aUpdate](RigidBody& aBody) {
+                    aBody.Params = aUpdate.Params;
                 });
             }
             break;
         }
         case RigidBodyEvent::Destroy: {
-            if (syncMap.contains(update.Entity)) {
-                entt::entity clientEntity = syncMap[update.Entity];
-                registry.destroy(clientEntity);
-                syncMap.erase(update.Entity);
+            entt::entity entity = syncMap.Erase(aUpdate.Entity);
+            if (entity != entt::null) {
+                aRegistry.destroy(entity);
                 WATO_INFO(
-                    registry,
+                    aRegistry,
                     "destroyed entity {} (server entity {})",
-                    clientEntity,
-                    update.Entity);
+                    entity,
+                    aUpdate.Entity);
             }
             break;
         }
     }
 }
 
-void NetworkResponseSystem::onHealthUpdate(const HealthUpdateEvent& aEvent)
+void NetworkResponseSystem::applyHealthUpdates(
+    Registry&                             aRegistry,
+    std::span<const HealthUpdateResponse> aUpdates)
 {
-    Registry&   registry = *aEvent.Reg;
-    const auto& update   = aEvent.Response;
-    auto&       syncMap  = GetSingletonComponent<EntitySyncMap>(registry);
-
-    if (syncMap.contains(update.Entity)) {
-        entt::entity e = syncMap[update.Entity];
-        WATO_INFO(
-            registry,
-            "received health update for server {}, updating local {} => {}",
-            update.Entity,
-            e,
-            update.Health);
-        registry.patch<Health>(e, [&update](Health& aHealth) { aHealth.Health = update.Health; });
-    } else {
-        WATO_WARN(
-            registry,
-            "received health update for server {} with {}, but entity not synced",
-            update.Entity,
-            update.Health);
+    const auto& syncMap = GetSingletonComponent<EntitySyncMap>(aRegistry);
+    std::size_t missing = 0;
+
+    for (const HealthUpdateResponse& update : aUpdates) {
+        entt::entity entity = syncMap.Find(update.Entity);
+        if (entity == entt::null || !aRegistry.all_of<Health>(entity)) {
+            ++missing;
+            continue;
+        }
+        aRegistry.patch<Health>(entity, [&update](Health& aHealth) {
+            aHealth.Health = update.Health;
+        });
+    }
+
+    if (missing > 0) {
+        WATO_WARN(aRegistry, "{} health updates for entities not synced", missing);
     }
+    WATO_TRACE(aRegistry, "applied {} health updates", aUpdates.size() - missing);
 }
 
-void NetworkResponseSystem::onGoldUpdate(const GoldUpdateEvent& aEvent)
+void NetworkResponseSystem::applyGoldUpdates(
+    Registry&                           aRegistry,
+    std::span<const GoldUpdateResponse> aUpdates)
 {
-    Registry&   registry = *aEvent.Reg;
-    const auto& update   = aEvent.Response;
-
-    auto  playerEntity = FindPlayerEntity(registry, update.Player);
-    auto* gold         = registry.try_get<Gold>(playerEntity);
-    if (gold) {
-        gold->Balance = update.Balance;
-        WATO_DBG(registry, "gold update for player {}: {}", update.Player, update.Balance);
-    } else {
-        WATO_WARN(registry, "gold update for player {} but no Gold component", update.Player);
+    if (aUpdates.empty()) {
+        return;
+    }
+
+    const auto* local    = aRegistry.ctx().find<Player>("player"_hs);
+    auto&       instance = GetSingletonComponent<GameInstance&>(aRegistry);
+
+    // balances are absolute, only each player's newest one matters
+    for (auto&& [entity, player, gold] : aRegistry.view<Player, Gold>().each()) {
+        auto update = std::ranges::find(
+            aUpdates.rbegin(),
+            aUpdates.rend(),
+            player.ID,
+            &GoldUpdateResponse::Player);
+        if (update == aUpdates.rend()) {
+            continue;
+        }
+
+        int balance = update->Balance;
+
+        // own actions the server had not applied yet stay predicted on top of its balance
+        if (local && local->ID == player.ID && !instance.Lockstep) {
+            instance.AppliedInputTick = std::max(instance.AppliedInputTick, update->InputTick);
+
+            balance = clientReplayGold(aRegistry, balance, instance.AppliedInputTick);
+        }
+
+        aRegistry.patch<Gold>(entity, [balance](Gold& aGold) { aGold.Balance = balance; });
+        WATO_DBG(
+            aRegistry,
+            "gold update for player {}: {} (server {})",
+            player.ID,
+            balance,
+            update->Balance);
     }
 }
 
-void NetworkResponseSystem::onSyncPayload(const SyncPayloadEvent& aEvent)
+void NetworkResponseSystem::applySyncPayload(Registry& aRegistry, const SyncPayload& aPayload)
 {
-    Registry&   registry = *aEvent.Reg;
-    const auto& payload  = aEvent.Payload;
-
-    if (payload.State.Snapshot.empty()) {
+    if (aPayload.State.Snapshot.empty()) {
         return;
     }
 
-    BitInputArchive       inAr(payload.State.Snapshot);
+    BitInputArchive       inAr(aPayload.State.Snapshot);
     Registry              tmp;
     entt::snapshot_loader loader{tmp};
 
     WATO_TRACE(
-        registry,
+        aRegistry,
         "loading state snapshot {} of size {}",
-        payload.State.Tick,
-        payload.State.Snapshot.size());
+        aPayload.State.Tick,
+        aPayload.State.Snapshot.size());
 
     loader.get<entt::entity>(inAr).get<Transform3D>(inAr).get<RigidBody>(inAr).get<Collider>(inAr);
 }
 
+void NetworkResponseSystem::applySnapshot(Registry& aRegistry, const SnapshotResponse& aSnapshot)
+{
+    auto&       instance = GetSingletonComponent<GameInstance&>(aRegistry);
+    const auto& syncMap  = GetSingletonComponent<EntitySyncMap>(aRegistry);
+
+    // unreliable, an older snapshot may arrive after a newer one
+    if (instance.LastSnapshot && aSnapshot.Tick <= *instance.LastSnapshot) {
+        return;
+    }
+
+    const StateSnapshot* base = nullptr;
+    if (aSnapshot.Delta) {
+        base = mSnapshots.Find(aSnapshot.BaseTick);
+        if (!base) {
+            WATO_DBG(
+                aRegistry,
+                "dropping snapshot {}, baseline {} is gone",
+                aSnapshot.Tick,
+                aSnapshot.BaseTick);
+            return;
+        }
+    }
+
+    if (!ApplySnapshotDelta(base, aSnapshot, mScratch)) {
+        WATO_WARN(
+            aRegistry,
+            "snapshot {} does not apply to {}",
+            aSnapshot.Tick,
+            aSnapshot.BaseTick);
+        return;
+    }
+
+    for (const EntityDelta& delta : aSnapshot.Changed) {
+        entt::entity entity = syncMap.Find(delta.State.Entity);
+        if (entity != entt::null && aRegistry.valid(entity)) {
+            applyEntityState(aRegistry, entity, delta);
+        }
+    }
+
+    // moving entities are rendered between their replicated positions, each gets a sample from
+    // the whole snapshot so one standing still is held in place
+    aRegistry.ctx().emplace<InterpolationClock>().OnSnapshot(aSnapshot.Tick);
+    for (const EntityState& state : mScratch.Entities) {
+        entt::entity entity = syncMap.Find(state.Entity);
+        if (entity == entt::null || !aRegistry.valid(entity)) {
+            continue;
+        }
+        const auto* body = aRegistry.try_get<RigidBody>(entity);
+        if (body && body->Params.Type == rp3d::BodyType::KINEMATIC) {
+            aRegistry.get_or_emplace<InterpolationBuffer>(entity)
+                .Push(aSnapshot.Tick, state.Position);
+        }
+    }
+
+    WATO_TRACE(
+        aRegistry,
+        "applied snapshot {}: {} changed, {} removed",
+        aSnapshot.Tick,
+        aSnapshot.Changed.size(),
+        aSnapshot.Removed.size());
+
+    mSnapshots.Push(mScratch);
+    instance.LastSnapshot = aSnapshot.Tick;
+}
+
+void NetworkResponseSystem::applyEntityState(
+    Registry&          aRegistry,
+    entt::entity       aEntity,
+    const EntityDelta& aDelta)
+{
+    const EntityState& state = aDelta.State;
+
+    if ((aDelta.Fields & EntityDelta::Motion) && aRegistry.all_of<RigidBody>(aEntity)) {
+        aRegistry.patch<RigidBody>(aEntity, [&state](RigidBody& aBody) {
+            aBody.Params.Direction = state.Direction;
+            aBody.Params.Velocity  = state.Velocity;
+        });
+    }
+
+    if ((aDelta.Fields & EntityDelta::Health) && aRegistry.all_of<Health>(aEntity)) {
+        aRegistry.patch<Health>(aEntity, [&state](Health& aHealth) {
+            aHealth.Health = state.Health;
+        });
+    }
+}
+
 void NetworkResponseSystem::createProjectile(
     Registry&                      aRegistry,
     const RigidBodyUpdateResponse& aUpdate,
@@ -173,14 +315,13 @@ void NetworkResponseSystem::createProjectile(
 
     WATO_INFO(aRegistry, "got projectile init data");
 
-    auto sourceTowerIt = syncMap.find(aInit.SourceTower);
-    if (sourceTowerIt == syncMap.end()) {
+    entt::entity clientTower = syncMap.Find(aInit.SourceTower);
+    if (clientTower == entt::null) {
         WATO_WARN(aRegistry, "source tower {} not found in sync map", aInit.SourceTower);
         return;
     }
 
-    entt::entity clientTower    = sourceTowerIt->second;
-    auto*        towerTransform = aRegistry.try_get<Transform3D>(clientTower);
+    auto* towerTransform = aRegistry.try_get<Transform3D>(clientTower);
     if (!towerTransform) {
         WATO_WARN(aRegistry, "source tower {} has no transform", clientTower);
         return;
@@ -197,11 +338,8 @@ void NetworkResponseSystem::createProjectile(
         projectile,
         glm::angleAxis(glm::radians(180.0f), glm::vec3(0, 1, 0)));
 
-    entt::entity clientTarget = entt::null;
-    auto         targetIt     = syncMap.find(aInit.Target);
-    if (targetIt != syncMap.end()) {
-        clientTarget = targetIt->second;
-    } else {
+    entt::entity clientTarget = syncMap.Find(aInit.Target);
+    if (clientTarget == entt::null) {
         WATO_ERR(aRegistry, "projectile server target {} unknown", aInit.Target);
     }
 
@@ -211,7 +349,7 @@ void NetworkResponseSystem::createProjectile(
     aRegistry.emplace<Collider>(projectile, aInit.ColliderParams);
     aRegistry.emplace<SceneObject>(projectile, "arrow"_hs);
 
-    syncMap.insert_or_assign(aUpdate.Entity, projectile);
+    syncMap.Insert(aUpdate.Entity, projectile);
 
     WATO_INFO(aRegistry, "created projectile {} from server entity {}", projectile, aUpdate.Entity);
 }
@@ -227,6 +365,18 @@ void NetworkResponseSystem::createTower(
     auto&       sender  = aRegistry.get<Player>(GetSenderFor(aRegistry, aInit.OwnerID));
     const auto& def     = GetTowerDef(aRegistry, aInit.Type);
 
+    // the authoritative tower replaces the one predicted at its place
+    const auto* local = aRegistry.ctx().find<Player>("player"_hs);
+    if (local && local->ID == aInit.OwnerID) {
+        for (auto&& [e, predicted, tower, t3D] :
+             aRegistry.view<Predicted, Tower, Transform3D>().each()) {
+            if (tower.Type == aInit.Type && glm::distance(t3D.Position, aInit.Position) < 0.01f) {
+                dropPredicted(aRegistry, e);
+                break;
+            }
+        }
+    }
+
     auto tower = aRegistry.create();
 
     auto& transform    = aRegistry.emplace<Transform3D>(tower, def.Transform.ToTransform3D());
@@ -246,7 +396,7 @@ void NetworkResponseSystem::createTower(
     aRegistry.emplace<Owner>(tower, aInit.OwnerID, player.Slot);
     aRegistry.emplace<TowerAttack>(tower, aInit.Attack);
 
-    syncMap.insert_or_assign(aUpdate.Entity, tower);
+    syncMap.Insert(aUpdate.Entity, tower);
 
     WATO_INFO(aRegistry, "created tower {} from server entity {}", tower, aUpdate.Entity);
 }
@@ -262,6 +412,22 @@ void NetworkResponseSystem::createCreep(
 
     const auto& creepDef = GetCreepDef(aRegistry, aInit.Type);
 
+    // sends are created in order, the oldest predicted one of the type is this one
+    const auto* local = aRegistry.ctx().find<Player>("player"_hs);
+    if (local && local->ID == aInit.OwnerID) {
+        entt::entity  oldest     = entt::null;
+        std::uint32_t oldestTick = std::numeric_limits<std::uint32_t>::max();
+        for (auto&& [e, predicted, c] : aRegistry.view<Predicted, Creep>().each()) {
+            if (c.Type == aInit.Type && predicted.Tick < oldestTick) {
+                oldest     = e;
+                oldestTick = predicted.Tick;
+            }
+        }
+        if (oldest != entt::null) {
+            dropPredicted(aRegistry, oldest);
+        }
+    }
+
     auto creep = aRegistry.create();
 
     auto& transform    = aRegistry.emplace<Transform3D>(creep, creepDef.Transform.ToTransform3D());
@@ -285,7 +451,7 @@ void NetworkResponseSystem::createCreep(
     aRegistry.emplace<ImguiDrawable>(creep, creepDef.Model.Object.Name, true);
     aRegistry.emplace<Animator>(creep, creepDef.Model.Animation);
 
-    syncMap.insert_or_assign(aUpdate.Entity, creep);
+    syncMap.Insert(aUpdate.Entity, creep);
 
     WATO_INFO(aRegistry, "created creep {} from server entity {}", creep, aUpdate.Entity);
 }
@@ -1,19 +1,25 @@
 #pragma once
 
-#include <entt/signal/dispatcher.hpp>
+#include <span>
 
-#include "core/net/network_events.hpp"
+#include "core/net/net.hpp"
+#include "core/net/state_snapshot.hpp"
 #include "systems/system.hpp"
 
 /**
  * @brief Processes network responses from server (fixed timestep)
  *
  * Handles entity creation, updates, and destruction from RigidBodyUpdateResponse.
- * Handles health synchronization from HealthUpdateResponse.
+ * Handles health synchronization from HealthUpdateResponse, and the newest gold balance of each
+ * player from GoldUpdateResponse.
+ * Applies the periodic state snapshots, delta decoded against the ones received before, and
+ * feeds the positions of moving entities to their InterpolationBuffer.
  * Handles full state sync from SyncPayload.
+ * Replaces the local player's predicted towers and creeps by the replicated ones, and drops those
+ * the server did not create once its gold updates show it applied their tick.
  *
- * Events are enqueued at frame time via dispatcher.enqueue() and
- * processed here at fixed timestep via dispatcher.update().
+ * Responses are queued by type in the NetworkResponseQueue at frame time and applied here at
+ * fixed timestep, one pass per type.
  */
 class NetworkResponseSystem : public FixedSystem
 {
@@ -26,13 +32,13 @@ class NetworkResponseSystem : public FixedSystem
     void Execute(Registry& aRegistry, std::uint32_t aTick) override;
 
    private:
-    void ensureConnected(entt::dispatcher& aDispatcher);
+    void applyRigidBodyUpdate(Registry& aRegistry, const RigidBodyUpdateResponse& aUpdate);
+    void applyHealthUpdates(Registry& aRegistry, std::span<const HealthUpdateResponse> aUpdates);
+    void applyGoldUpdates(Registry& aRegistry, std::span<const GoldUpdateResponse> aUpdates);
+    void applySyncPayload(Registry& aRegistry, const SyncPayload& aPayload);
+    void applySnapshot(Registry& aRegistry, const SnapshotResponse& aSnapshot);
 
-    // Event handlers (use mRegistry member set during Execute)
-    void onRigidBodyUpdate(const RigidBodyUpdateEvent& aEvent);
-    void onHealthUpdate(const HealthUpdateEvent& aEvent);
-    void onGoldUpdate(const GoldUpdateEvent& aEvent);
-    void onSyncPayload(const SyncPayloadEvent& aEvent);
+    void applyEntityState(Registry& aRegistry, entt::entity aEntity, const EntityDelta& aDelta);
 
     void createProjectile(
         Registry&                      aRegistry,
@@ -47,5 +53,7 @@ class NetworkResponseSystem : public FixedSystem
         const RigidBodyUpdateResponse& aUpdate,
         const CreepInitData&           aInit);
 
-    bool mConnected = false;
+    // snapshots received, baselines of the next deltas
+    SnapshotHistory mSnapshots;
+    StateSnapshot   mScratch;
 };
@@ -78,12 +78,29 @@ void SimulationSystem::Execute(Registry& aRegistry, const float aDelta)
 
     instance.Accumulator += aDelta;
 
+    // lockstep client: run no tick before its turn came from the server, and an extra one per
+    // frame when too many are queued to catch up with it
+    const auto* turns = aRegistry.ctx().find<LockstepTurns>();
+    if (turns && turns->Received > instance.Tick + LockstepTurns::kMaxBacklog) {
+        instance.Accumulator += kTimeStep;
+    }
+
     // While there is enough accumulated time to take
     // one or several physics steps
     while (instance.Accumulator >= kTimeStep) {
+        if (turns && !turns->Ready(instance.Tick + 1)) {
+            // the time spent waiting is not replayed in a burst once the turn is in
+            instance.Accumulator = kTimeStep;
+            break;
+        }
+
         // Decrease the accumulated time
         instance.Accumulator -= kTimeStep;
 
+        // transforms as of the last physics step, not smoothed for the last frame: gameplay
+        // reads them, it must not depend on the frame rate
+        UpdateTransforms(aRegistry, 1.0f);
+
         // Increment tick and run fixed timestep systems
         ++instance.Tick;
         fixedExec.Update(instance.Tick, &aRegistry);
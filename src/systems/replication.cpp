@@ -0,0 +1,29 @@
+#include "systems/replication.hpp"
+
+#include "components/game.hpp"
+#include "components/player.hpp"
+#include "core/net/enet_server.hpp"
+#include "core/net/net.hpp"
+
+ENetServer* FindReplicatingServer(Registry& aRegistry)
+{
+    const auto* instance = aRegistry.ctx().find<GameInstance>();
+    if (instance && instance->Lockstep) {
+        return nullptr;
+    }
+    return aRegistry.ctx().find<ENetServer>();
+}
+
+GoldUpdateResponse GoldUpdateFor(const Registry& aRegistry, PlayerID aID)
+{
+    GoldUpdateResponse update{.Player = aID, .Balance = 0};
+    if (const auto* gold = aRegistry.try_get<Gold>(FindPlayerEntity(aRegistry, aID))) {
+        update.Balance = gold->Balance;
+    }
+    if (const auto* inputs = aRegistry.ctx().find<ClientInputTicks>()) {
+        if (auto it = inputs->Applied.find(aID); it != inputs->Applied.end()) {
+            update.InputTick = it->second;
+        }
+    }
+    return update;
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include "core/types.hpp"
+#include "registry/registry.hpp"
+
+class ENetServer;
+struct GoldUpdateResponse;
+
+// server replicating the entities of this game to its clients, null on clients and in lockstep
+// games where every client simulates them
+ENetServer* FindReplicatingServer(Registry& aRegistry);
+
+// server: current gold of a player, with the inputs the ServerActionSystem applied to it for its
+// client's predictions
+GoldUpdateResponse GoldUpdateFor(const Registry& aRegistry, PlayerID aID);
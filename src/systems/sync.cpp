@@ -1,13 +1,47 @@
 #include "systems/sync.hpp"
 
+#include <algorithm>
+#include <cmath>
+#include <glm/geometric.hpp>
+#include <glm/trigonometric.hpp>
+#include <limits>
+
+#include "components/camera.hpp"
 #include "components/game.hpp"
+#include "components/health.hpp"
+#include "components/player.hpp"
+#include "components/rigid_body.hpp"
+#include "components/tile.hpp"
+#include "components/transform3d.hpp"
 #include "core/net/enet_client.hpp"
 #include "core/net/enet_server.hpp"
+#include "core/net/interest.hpp"
 #include "core/net/net.hpp"
 #include "core/snapshot.hpp"
 #include "input/action.hpp"
 #include "registry/registry.hpp"
 
+// ground around the point the camera looks at, in whole units so small moves are not resent
+static std::optional<ViewRegion> cameraRegion(const Registry& aRegistry)
+{
+    for (auto&& [entity, camera, transform] : aRegistry.view<Camera, Transform3D>().each()) {
+        const glm::vec3 dir = glm::normalize(camera.Dir);
+        if (dir.y >= 0.0f || transform.Position.y <= 0.0f) {
+            return std::nullopt;
+        }
+        const float     dist   = -transform.Position.y / dir.y;
+        const glm::vec3 ground = transform.Position + dir * dist;
+        // wider than the vertical field of view, to cover the screen aspect ratio
+        const float half = dist * std::tan(glm::radians(camera.Fov));
+
+        return ViewRegion{
+            .Min = glm::floor(glm::vec2(ground.x, ground.z) - half),
+            .Max = glm::ceil(glm::vec2(ground.x, ground.z) + half),
+        };
+    }
+    return std::nullopt;
+}
+
 template <>
 void NetworkSyncSystem<ENetClient>::Execute(
     Registry&                      aRegistry,
@@ -21,17 +55,118 @@ void NetworkSyncSystem<ENetClient>::Execute(
         return;
     }
 
-    const GameState& state         = buf.Latest();
-    GameState        filteredState = GameState{.Tick = state.Tick, .Actions = buf.Latest().Actions};
+    // walk back from the current tick while ticks keep decreasing, older slots are empty or from
+    // a previous lap of the ring
+    InputPayload input{.GameID = instance.GameID};
+    uint32_t     newer = std::numeric_limits<uint32_t>::max();
+    for (std::size_t age = 0; age < InputPayload::kMaxTicks; ++age) {
+        const auto& state = buf.FromLatest(age);
+        if (!state || state->Tick >= newer || state->Tick < instance.UnackedInputTick) {
+            break;
+        }
+        newer = state->Tick;
+        if (!state->Actions.empty()) {
+            input.Inputs.push_back(TickActions{.Tick = state->Tick, .Actions = state->Actions});
+        }
+    }
+
+    // acks, the camera region and a desync ride along the inputs, sent on their own when there
+    // is no input to resend
+    // a lockstep client has the whole world, there is no interest to report
+    const auto view      = instance.Lockstep ? std::nullopt : cameraRegion(aRegistry);
+    const bool newAck    = instance.LastSnapshot && instance.LastSnapshot != mSnapshotAck;
+    const bool newView   = view && view != mSentView;
+    const bool newDesync = instance.Desync != mSentDesync;
+    if (input.Inputs.empty() && !newAck && !newView && !newDesync) {
+        return;
+    }
+    std::ranges::reverse(input.Inputs);
+    input.SnapshotAck = instance.LastSnapshot;
+    input.Desync      = instance.Desync;
+    input.View        = view;
+
+    bool queued = net.EnqueueRequest(NetworkRequest{
+        .Type     = PacketType::ClientInput,
+        .PlayerID = aRegistry.ctx().get<Player>("player"_hs).ID,
+        .Tick     = instance.Tick,
+        .Payload  = std::move(input),
+    });
+    if (!queued) {
+        WATO_WARN(aRegistry, "request channel full, dropping input at tick {}", instance.Tick);
+        return;
+    }
+    mSnapshotAck = instance.LastSnapshot;
+    mSentView    = view;
+    mSentDesync  = instance.Desync;
+}
+
+template <>
+void NetworkSyncSystem<ENetServer>::sendSnapshots(Registry& aRegistry, std::uint32_t aTick)
+{
+    auto& net = GetSingletonComponent<ENetServer&>(aRegistry);
 
-    if (!filteredState.Actions.empty() || !filteredState.Snapshot.empty()) {
-        net.EnqueueRequest(new NetworkRequest{
-            .Type     = PacketType::ClientSync,
-            .PlayerID = aRegistry.ctx().get<Player>("player"_hs).ID,
-            .Tick     = instance.Tick,
-            .Payload  = SyncPayload{.GameID = instance.GameID, .State = filteredState},
+    mScratch.Tick = aTick;
+    mScratch.Entities.clear();
+    for (auto&& [entity, transform, body] :
+         aRegistry.view<Transform3D, RigidBody>(entt::exclude<Tile>).each()) {
+        const auto* health = aRegistry.try_get<Health>(entity);
+        mScratch.Entities.push_back(EntityState{
+            .Entity    = entity,
+            .Position  = transform.Position,
+            .Direction = body.Params.Direction,
+            .Velocity  = body.Params.Velocity,
+            .Health    = health ? health->Health : 0.0f,
         });
     }
+    std::ranges::sort(mScratch.Entities, {}, [](const EntityState& aState) {
+        return entt::to_integral(aState.Entity);
+    });
+
+    // each player is sent its own view of the world, delta encoded against the last one it
+    // acknowledged, or in full if that one left its history
+    auto*               acks     = aRegistry.ctx().find<SnapshotAcks>();
+    auto*               interest = aRegistry.ctx().find<InterestMap>();
+    const std::uint32_t round    = aTick / mSnapshotInterval;
+    const auto          players  = GetPlayerIDs(aRegistry);
+
+    // the entries of players who left the game go with them
+    auto gone = [&players](const auto& aEntry) {
+        return std::ranges::find(players, aEntry.first) == players.end();
+    };
+    std::erase_if(mHistories, gone);
+    if (acks) {
+        std::erase_if(acks->Acked, gone);
+    }
+    if (interest) {
+        std::erase_if(interest->Players, gone);
+    }
+
+    for (const PlayerID id : players) {
+        SnapshotHistory&     history = mHistories[id];
+        const StateSnapshot* base    = nullptr;
+        if (acks) {
+            if (auto it = acks->Acked.find(id); it != acks->Acked.end()) {
+                base = history.Find(it->second);
+            }
+        }
+
+        const PlayerInterest* player = nullptr;
+        if (interest) {
+            if (auto it = interest->Players.find(id); it != interest->Players.end()) {
+                player = &it->second;
+            }
+        }
+
+        if (player) {
+            FilterSnapshot(*player, base, mScratch, round, mView);
+        } else {
+            mView.Tick     = mScratch.Tick;
+            mView.Entities = mScratch.Entities;
+        }
+
+        net.SendResponse(id, PacketType::Snapshot, aTick, DiffSnapshots(base, mView));
+        history.Push(mView);
+    }
 }
 
 template <>
@@ -39,60 +174,25 @@ void NetworkSyncSystem<ENetServer>::Execute(
     Registry&                      aRegistry,
     [[maybe_unused]] std::uint32_t aTick)
 {
-    auto& net       = GetSingletonComponent<ENetServer&>(aRegistry);
-    auto& instance  = GetSingletonComponent<GameInstance&>(aRegistry);
-    auto& rbStorage = aRegistry.storage<entt::reactive>("rigid_bodies_observer"_hs);
+    auto& net      = GetSingletonComponent<ENetServer&>(aRegistry);
+    auto& instance = GetSingletonComponent<GameInstance&>(aRegistry);
     auto& rbDestroyedStorage =
         aRegistry.storage<entt::reactive>("rigid_bodies_destroy_observer"_hs);
 
-    // TODO: snapshot every other frame
-    // auto& buf = GetSingletonComponent<GameStateBuffer&>(aRegistry);
-    // auto  snapshotView = entt::basic_view{rbStorage};
-    // GameState        serverState = GameState{.Tick = buf.Latest().Tick};
-    // BitOutputArchive outAr;
-    //
-    // entt::snapshot{aRegistry}
-    //     .get<entt::entity>(outAr)
-    //     .get<Transform3D>(outAr, rbStorage.begin(), rbStorage.end())
-    //     .get<RigidBody>(outAr, rbStorage.begin(), rbStorage.end())
-    //     .get<Collider>(outAr, rbStorage.begin(), rbStorage.end());
-    //
-    // if (outAr.Data().empty()) {
-    //     return;
-    // }
-    //
-    // serverState.Snapshot = std::move(outAr.Data());
-    //
-    // WATO_DBG(
-    //     aRegistry,
-    //     "sending server sync response with state of size {}",
-    //     serverState.Snapshot.size());
-    //
-    // net.EnqueueResponse(new NetworkResponse{
-    //     .Type     = PacketType::ServerSync,
-    //     .PlayerID = 0,
-    //     .Tick     = instance.Tick,
-    //     .Payload  = SyncPayload{.GameID = instance.GameID, .State = serverState},
-    // });
-
-    for (auto&& [entity, rigidBody] : rbStorage.view<RigidBody>().each()) {
-        net.BroadcastResponse(
-            GetPlayerIDs(aRegistry),
-            PacketType::Ack,
-            instance.Tick,
-            RigidBodyUpdateResponse{
-                .Params   = rigidBody.Params,
-                .Entity   = entity,
-                .Event    = RigidBodyEvent::Update,
-                .InitData = std::monostate{},
-            });
+    // lockstep clients simulate the entities, only the turns are sent
+    if (instance.Lockstep) {
+        return;
     }
 
+    // creates and destroys stay reliable, periodic state goes in the unreliable snapshots; a
+    // destroy goes to the players that were sent the create
+    const auto players  = GetPlayerIDs(aRegistry);
+    auto*      interest = aRegistry.ctx().find<InterestMap>();
     for (auto& e : rbDestroyedStorage) {
         WATO_DBG(aRegistry, "rigid body destroyed for {}", e);
 
         net.BroadcastResponse(
-            GetPlayerIDs(aRegistry),
+            interest ? interest->DestroyRecipients(e, players) : players,
             PacketType::Ack,
             aTick,
             RigidBodyUpdateResponse{
@@ -102,4 +202,13 @@ void NetworkSyncSystem<ENetServer>::Execute(
                 .InitData = std::monostate{},
             });
     }
+
+    if (instance.Tick % mSnapshotInterval == 0) {
+        sendSnapshots(aRegistry, instance.Tick);
+    }
+}
+
+template <>
+void NetworkSyncSystem<ENetClient>::sendSnapshots(Registry&, std::uint32_t)
+{
 }
@@ -1,5 +1,11 @@
 #pragma once
 
+#include <algorithm>
+#include <optional>
+#include <unordered_map>
+
+#include "core/net/interest.hpp"
+#include "core/net/state_snapshot.hpp"
 #include "systems/system.hpp"
 
 /**
@@ -8,14 +14,50 @@
  * Syncs game state between client and server.
  * Runs at deterministic 60 FPS.
  *
+ * The server sends a snapshot of the replicated state every snapshot interval ticks, delta
+ * encoded against the last one each client acknowledged with its inputs. Entities outside a
+ * player's map and camera are only refreshed every few snapshots, see InterestMap. Lockstep games
+ * replicate nothing, clients simulate from the LockstepTurn the ServerActionSystem sends.
+ *
  * Template parameter _ENetT is either ENetClient or ENetServer.
  */
 template <typename _ENetT>
 class NetworkSyncSystem : public FixedSystem
 {
    public:
-    using FixedSystem::FixedSystem;
+    // 20 snapshots per second at the 60 Hz tick rate
+    static constexpr GameTick kDefaultSnapshotInterval{3};
+
+    template <typename Allocator>
+    explicit NetworkSyncSystem(
+        const Allocator& aAlloc,
+        GameTick         aSnapshotInterval = kDefaultSnapshotInterval)
+        : FixedSystem(aAlloc), mSnapshotInterval(std::max(aSnapshotInterval.count(), 1u))
+    {
+    }
+
+    explicit NetworkSyncSystem(GameTick aSnapshotInterval = kDefaultSnapshotInterval)
+        : mSnapshotInterval(std::max(aSnapshotInterval.count(), 1u))
+    {
+    }
 
    protected:
     void Execute(Registry& aRegistry, std::uint32_t aTick) override;
+
+   private:
+    // server: capture the replicated state and send each player its delta
+    void sendSnapshots(Registry& aRegistry, std::uint32_t aTick);
+
+    // server: ticks between snapshots, independent of the simulation rate
+    std::uint32_t mSnapshotInterval;
+
+    // server: world state, and each player's view of it as sent, baselines of the deltas
+    StateSnapshot                                 mScratch;
+    StateSnapshot                                 mView;
+    std::unordered_map<PlayerID, SnapshotHistory> mHistories;
+
+    // client: last snapshot tick acknowledged to the server, camera region and desync reported
+    std::optional<std::uint32_t> mSnapshotAck;
+    std::optional<ViewRegion>    mSentView;
+    std::optional<std::uint32_t> mSentDesync;
 };
@@ -15,32 +15,16 @@
 #include "components/tower_attack.hpp"
 #include "components/transform3d.hpp"
 #include "core/net/enet_server.hpp"
+#include "core/net/interest.hpp"
 #include "core/net/net.hpp"
 #include "core/physics/physics.hpp"
 #include "core/sys/log.hpp"
 #include "registry/registry.hpp"
-
-// Callback for collecting colliders within range using sphere overlap query
-class ColliderCollectorCallback : public rp3d::OverlapCallback
-{
-   public:
-    void onOverlap(CallbackData& aData) override
-    {
-        for (uint32_t i = 0; i < aData.getNbOverlappingPairs(); ++i) {
-            mColliders.push_back(aData.getOverlappingPair(i).getCollider2());
-        }
-    }
-
-    const std::vector<rp3d::Collider*>& GetColliders() const { return mColliders; }
-
-   private:
-    std::vector<rp3d::Collider*> mColliders;
-};
+#include "systems/replication.hpp"
 
 void TowerAttackSystem::Execute(Registry& aRegistry, [[maybe_unused]] std::uint32_t aTick)
 {
     constexpr float kTimeStep = 1.0f / 60.0f;
-    auto&           phy       = GetSingletonComponent<Physics>(aRegistry);
 
     for (auto&& [towerEntity, tower, owner, towerTransform, attack] :
          aRegistry.view<Tower, Owner, Transform3D, TowerAttack>().each()) {
@@ -65,51 +49,22 @@ void TowerAttackSystem::Execute(Registry& aRegistry, [[maybe_unused]] std::uint3
         if (needNewTarget) {
             attack.CurrentTarget = entt::null;
 
-            // Create a temporary kinematic body with sphere collider for spatial query
-            rp3d::Transform queryTransform(
-                ToRP3D(towerTransform.Position),
-                rp3d::Quaternion::identity());
-            rp3d::RigidBody* queryBody = phy.World()->createRigidBody(queryTransform);
-            queryBody->setType(rp3d::BodyType::KINEMATIC);
-
-            // Create sphere shape matching tower's attack range
-            rp3d::SphereShape* sphereShape = phy.Common().createSphereShape(attack.Range);
-
-            rp3d::Collider* queryCollider =
-                queryBody->addCollider(sphereShape, rp3d::Transform::identity());
-            queryCollider->setCollisionCategoryBits(Category::Projectiles);
-            queryCollider->setCollideWithMaskBits(PlayerEntitiesCategory(sender.Slot));
-            queryCollider->setIsTrigger(true);
-
-            ColliderCollectorCallback callback;
-            phy.World()->testOverlap(queryBody, callback);
-
-            phy.World()->destroyRigidBody(queryBody);
-            phy.Common().destroySphereShape(sphereShape);
-
-            auto&        colliderToEntity = GetSingletonComponent<ColliderEntityMap>(aRegistry);
-            float        closestDistSq    = std::numeric_limits<float>::max();
-            entt::entity closestTarget    = entt::null;
-
-            for (auto* collider : callback.GetColliders()) {
-                auto it = colliderToEntity.find(collider);
-                if (it == colliderToEntity.end()) {
-                    continue;
-                }
-
-                entt::entity entity = it->second;
-
-                auto* creep     = aRegistry.try_get<Creep>(entity);
-                auto* health    = aRegistry.try_get<Health>(entity);
-                auto* transform = aRegistry.try_get<Transform3D>(entity);
+            // a scan over the creeps rather than a physics overlap query: pool order is the same
+            // on every participant of a lockstep game, the order of rp3d overlap pairs is not
+            const float  rangeSq       = attack.Range * attack.Range;
+            float        closestDistSq = std::numeric_limits<float>::max();
+            entt::entity closestTarget = entt::null;
 
-                if (!creep || !health || !transform || health->Health <= 0.0f) {
+            for (auto&& [entity, creep, creepOwner, health, transform] :
+                 aRegistry.view<Creep, Owner, Health, Transform3D>().each()) {
+                // only the creeps sent against this tower's owner
+                if (creepOwner.Slot != sender.Slot || health.Health <= 0.0f) {
                     continue;
                 }
 
-                float distSq = glm::distance2(towerTransform.Position, transform->Position);
+                float distSq = glm::distance2(towerTransform.Position, transform.Position);
 
-                if (distSq < closestDistSq) {
+                if (distSq <= rangeSq && distSq < closestDistSq) {
                     closestDistSq = distSq;
                     closestTarget = entity;
                 }
@@ -166,9 +121,13 @@ void TowerAttackSystem::Execute(Registry& aRegistry, [[maybe_unused]] std::uint3
                         },
                 });
 
-            if (auto* server = aRegistry.ctx().find<ENetServer>()) {
+            if (auto* server = FindReplicatingServer(aRegistry)) {
+                // short lived, only the players watching the tower get to see it
+                const auto players  = GetPlayerIDs(aRegistry);
+                auto*      interest = aRegistry.ctx().find<InterestMap>();
                 server->BroadcastResponse(
-                    GetPlayerIDs(aRegistry),
+                    interest ? interest->CreateRecipients(projectile, players, pT.Position)
+                             : players,
                     PacketType::Ack,
                     GetSingletonComponent<GameInstance&>(aRegistry).Tick,
                     RigidBodyUpdateResponse{
@@ -185,8 +144,6 @@ void TowerAttackSystem::Execute(Registry& aRegistry, [[maybe_unused]] std::uint3
                                 .ColliderParams = collider.Params,
                             },
                     });
-            } else {
-                WATO_WARN(aRegistry, "enet server not instanciated");
             }
 
             WATO_DBG(
@@ -11,12 +11,13 @@
 #include "components/player.hpp"
 #include "components/rigid_body.hpp"
 #include "components/spawner.hpp"
+#include "core/flow_field_jobs.hpp"
 #include "core/graph.hpp"
 #include "core/net/enet_server.hpp"
 
 using namespace entt::literals;
 
-void TowerBuiltSystem::Execute(Registry& aRegistry, [[maybe_unused]] std::uint32_t aTick)
+void TowerBuiltSystem::Execute(Registry& aRegistry, std::uint32_t aTick)
 {
     auto& phy     = GetSingletonComponent<Physics>(aRegistry);
     auto* storage = aRegistry.storage("tower_built_observer"_hs);
@@ -25,6 +26,16 @@ void TowerBuiltSystem::Execute(Registry& aRegistry, [[maybe_unused]] std::uint32
         throw std::runtime_error("tower_built_observer storage not initialized");
     }
 
+    // creeps follow the paths repaired for towers built kDelay ticks ago from now on
+    auto* jobs = aRegistry.ctx().find<FlowFieldJobs>();
+    if (jobs != nullptr) {
+        auto&      graphMap  = GetSingletonComponent<PlayerGraphMap>(aRegistry);
+        const auto published = jobs->Publish(graphMap, aTick);
+        if (published > 0) {
+            WATO_TRACE(aRegistry, "published {} repaired paths at tick {}", published, aTick);
+        }
+    }
+
     if (storage->empty()) {
         return;
     }
@@ -48,23 +59,26 @@ void TowerBuiltSystem::Execute(Registry& aRegistry, [[maybe_unused]] std::uint32
             }
         }
 
+        // the destination is the player, it does not move: only the cells around the new
+        // obstacles are repaired, on a worker when the instance has FlowFieldJobs
         for (PlayerID pid : dirtyPlayers) {
             auto it = graphMap.find(pid);
             if (it == graphMap.end()) continue;
             auto& graph = it->second;
 
-            for (auto&& [e, player, transform] : aRegistry.view<Player, Transform3D>().each()) {
-                if (player.ID == pid) {
-                    graph.ComputePaths(transform.Position);
-                    WATO_DBG(aRegistry, "{}", graph);
-                    WATO_TRACE(aRegistry, "paths updated for player {}", pid);
-                    break;
-                }
+            if (jobs != nullptr) {
+                jobs->Submit(pid, graph, aTick);
+                WATO_TRACE(aRegistry, "paths repair submitted for player {}", pid);
+            } else {
+                graph.UpdatePaths();
+                WATO_DBG(aRegistry, "{}", graph);
+                WATO_TRACE(aRegistry, "paths updated for player {}", pid);
             }
             graph.GridDirty = true;
         }
-    } else if (aRegistry.ctx().contains<Graph>()) {
-        // Client path: single graph for local player only
+    }
+    if (aRegistry.ctx().contains<Graph>()) {
+        // Client path: single graph for local player only, lockstep clients have both
         auto&    graph    = GetSingletonComponent<Graph>(aRegistry);
         PlayerID localPID = aRegistry.ctx().get<Player>("player"_hs).ID;
         bool     dirty    = false;
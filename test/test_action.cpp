@@ -1,6 +1,9 @@
 #include <input/action.hpp>
 
+#include "components/net.hpp"
+#include "core/net/net.hpp"
 #include "systems/action.hpp"
+#include "systems/replication.hpp"
 #include "test_fixtures.hpp"
 
 TEST_CASE("action.encode")
@@ -48,6 +51,38 @@ TEST_CASE_FIXTURE(ClientFixture, "action.client.build_placement")
     CHECK_EQ(0, g.size());
 }
 
+TEST_CASE_FIXTURE(ClientFixture, "action.client.build_predicted")
+{
+    DeterministicActionSystem sys;
+    auto                      player = AddPlayer(0, 0);
+    Reg.ctx().emplace_as<Player>("player"_hs, Reg.get<Player>(player));
+
+    const int initial   = Reg.get<Gold>(player).Balance;
+    const int towerCost = Definitions.Towers.at(TowerType::Arrow).Cost;
+
+    Buf.Latest().Tick = 7;
+    Ctx.EnterPlacement(Reg, TowerType::Arrow);
+    Buf.Latest().Actions.push_back(kBuildTowerAction);
+    sys.update(0, &Reg);
+
+    auto g = Reg.group<Tower>(entt::get<Collider, RigidBody>);
+    REQUIRE_EQ(1, g.size());
+    CHECK_EQ(Reg.get<Predicted>(g.front()).Tick, 7U);
+    CHECK_EQ(Reg.get<Gold>(player).Balance, initial - towerCost);
+    CHECK_EQ(Buf.Latest().PredictedCosts, std::vector<int>{towerCost});
+
+    SUBCASE("replayed over balances from before its tick")
+    {
+        CHECK_EQ(clientReplayGold(Reg, initial, 7), initial - towerCost);
+        CHECK_EQ(clientReplayGold(Reg, initial, 8), initial);
+    }
+
+    SUBCASE("dropped from the replay when no longer affordable")
+    {
+        CHECK_EQ(clientReplayGold(Reg, towerCost - 1, 7), towerCost - 1);
+    }
+}
+
 TEST_CASE_FIXTURE(ServerFixture, "action.server.build")
 {
     ServerActionSystem sys;
@@ -107,6 +142,27 @@ TEST_CASE_FIXTURE(ServerFixture, "action.server.build_same_pos")
     CHECK_EQ(1, g.size());
 }
 
+TEST_CASE_FIXTURE(ServerFixture, "action.server.gold_stamped_after_batch")
+{
+    ServerActionSystem sys;
+    auto               player = AddPlayer(0, 0);
+    AddPlayerGraph(0);
+
+    // inputs up to tick 8 received, the previous batch applied those before tick 5
+    auto& inputs      = Reg.ctx().emplace<ClientInputTicks>();
+    inputs.Next[0]    = 9;
+    inputs.Applied[0] = 5;
+    CHECK_EQ(GoldUpdateFor(Reg, 0).InputTick, 5U);
+
+    Tagged.push_back({0, kBuildTowerAction});
+    Tagged.push_back({0, kBuildTowerAction});
+    sys.update(0, &Reg);
+
+    const auto update = GoldUpdateFor(Reg, 0);
+    CHECK_EQ(update.InputTick, 9U);
+    CHECK_EQ(update.Balance, Reg.get<Gold>(player).Balance);
+}
+
 TEST_CASE_FIXTURE(ServerFixture, "action.server.send_deducts_gold")
 {
     ServerActionSystem sys;
@@ -1,8 +1,17 @@
 #include <doctest.h>
 
+#include <sodium/crypto_aead_xchacha20poly1305.h>
+
+#include <algorithm>
+#include <bit>
+
+#include <core/crypto/aead_calibration.hpp>
 #include <core/crypto/key.hpp>
 #include <core/crypto/session.hpp>
 
+// a fixed salt, tests about the salt itself draw theirs
+static constexpr CryptoSession::salt_type kTestSalt{};
+
 TEST_CASE("crypto.sealed_box_round_trip")
 {
     CryptoKeys keys;
@@ -108,8 +117,18 @@ TEST_CASE("crypto.session_aead_round_trip")
     CryptoSession clientSession;
     CryptoSession serverSession;
 
-    serverSession.Init(serverKeys, clientKeys.RawPublicKey(), false, true);
-    clientSession.Init(clientKeys, serverKeys.RawPublicKey(), false, false);
+    serverSession.Init(
+        serverKeys,
+        clientKeys.RawPublicKey(),
+        AEADID::XChaCha20Poly1305,
+        true,
+        kTestSalt);
+    clientSession.Init(
+        clientKeys,
+        serverKeys.RawPublicKey(),
+        AEADID::XChaCha20Poly1305,
+        false,
+        kTestSalt);
 
     REQUIRE(serverSession.Valid());
     REQUIRE(clientSession.Valid());
@@ -148,8 +167,18 @@ TEST_CASE("crypto.session_aead_tampered")
     CryptoSession clientSession;
     CryptoSession serverSession;
 
-    serverSession.Init(serverKeys, clientKeys.RawPublicKey(), false, true);
-    clientSession.Init(clientKeys, serverKeys.RawPublicKey(), false, false);
+    serverSession.Init(
+        serverKeys,
+        clientKeys.RawPublicKey(),
+        AEADID::XChaCha20Poly1305,
+        true,
+        kTestSalt);
+    clientSession.Init(
+        clientKeys,
+        serverKeys.RawPublicKey(),
+        AEADID::XChaCha20Poly1305,
+        false,
+        kTestSalt);
 
     std::vector<uint8_t> plaintext = {1, 2, 3, 4, 5};
 
@@ -172,8 +201,18 @@ TEST_CASE("crypto.session_aead_wrong_session")
     CryptoSession clientSession;
     CryptoSession rogueSession;
 
-    clientSession.Init(clientKeys, serverKeys.RawPublicKey(), false, false);
-    rogueSession.Init(rogueKeys, serverKeys.RawPublicKey(), false, true);
+    clientSession.Init(
+        clientKeys,
+        serverKeys.RawPublicKey(),
+        AEADID::XChaCha20Poly1305,
+        false,
+        kTestSalt);
+    rogueSession.Init(
+        rogueKeys,
+        serverKeys.RawPublicKey(),
+        AEADID::XChaCha20Poly1305,
+        true,
+        kTestSalt);
 
     std::vector<uint8_t> plaintext = {42};
 
@@ -184,3 +223,293 @@ TEST_CASE("crypto.session_aead_wrong_session")
     byte_view decrypted = rogueSession.Decrypt(encrypted);
     CHECK(decrypted.empty());
 }
+
+TEST_CASE("crypto.session_counter_nonce")
+{
+    CryptoKeys clientKeys;
+    CryptoKeys serverKeys;
+
+    CryptoSession clientSession;
+    CryptoSession serverSession;
+
+    serverSession.Init(
+        serverKeys,
+        clientKeys.RawPublicKey(),
+        AEADID::XChaCha20Poly1305,
+        true,
+        kTestSalt);
+    clientSession.Init(
+        clientKeys,
+        serverKeys.RawPublicKey(),
+        AEADID::XChaCha20Poly1305,
+        false,
+        kTestSalt);
+
+    std::vector<uint8_t> plaintext = {7, 8, 9};
+
+    byte_view            view = clientSession.Encrypt(plaintext);
+    std::vector<uint8_t> first(view.begin(), view.end());
+    CHECK(
+        first.size()
+        == CryptoSession::kCounterBytes + plaintext.size()
+               + crypto_aead_xchacha20poly1305_ietf_ABYTES);
+    CHECK(first[0] == 0);
+
+    view = clientSession.Encrypt(plaintext);
+    std::vector<uint8_t> second(view.begin(), view.end());
+    CHECK(second[0] == 1);
+
+    SUBCASE("replayed packets are rejected")
+    {
+        CHECK_FALSE(serverSession.Decrypt(first).empty());
+        CHECK(serverSession.Decrypt(first).empty());
+        CHECK_EQ(serverSession.Replayed(), 1);
+    }
+
+    SUBCASE("reordered packets are accepted once")
+    {
+        CHECK_FALSE(serverSession.Decrypt(second).empty());
+        CHECK_FALSE(serverSession.Decrypt(first).empty());
+        CHECK(serverSession.Decrypt(second).empty());
+    }
+
+    SUBCASE("tampered counters fail authentication without moving the window")
+    {
+        second[0] = 5;
+        CHECK(serverSession.Decrypt(second).empty());
+        CHECK_FALSE(serverSession.Decrypt(first).empty());
+        CHECK_EQ(serverSession.Replayed(), 0);
+    }
+}
+
+TEST_CASE("crypto.session_channels")
+{
+    CryptoKeys clientKeys;
+    CryptoKeys serverKeys;
+
+    CryptoSession clientSession;
+    CryptoSession serverSession;
+
+    serverSession.Init(
+        serverKeys,
+        clientKeys.RawPublicKey(),
+        AEADID::XChaCha20Poly1305,
+        true,
+        kTestSalt);
+    clientSession.Init(
+        clientKeys,
+        serverKeys.RawPublicKey(),
+        AEADID::XChaCha20Poly1305,
+        false,
+        kTestSalt);
+
+    const std::vector<uint8_t> plaintext = {4, 5, 6};
+
+    // a reliable packet ENet holds back behind a retransmission
+    byte_view            view = serverSession.Encrypt(plaintext, 0);
+    std::vector<uint8_t> reliable(view.begin(), view.end());
+    CHECK_EQ(reliable[CryptoSession::kCounterBytes - 1], 0);
+
+    // while more than a window of unreliable packets goes through
+    for (std::uint64_t idx = 0; idx < ReplayWindow::kSize + 100; ++idx) {
+        view = serverSession.Encrypt(plaintext, 1);
+        REQUIRE_EQ(view[CryptoSession::kCounterBytes - 1], 1);
+        REQUIRE_FALSE(clientSession.Decrypt(view).empty());
+    }
+
+    CHECK_FALSE(clientSession.Decrypt(reliable).empty());
+    CHECK(clientSession.Decrypt(reliable).empty());
+    CHECK_EQ(clientSession.Replayed(), 1);
+
+    // not a session channel
+    std::vector<uint8_t> out(plaintext.size() + serverSession.Overhead());
+    CHECK_FALSE(serverSession.EncryptInto(plaintext, out, CryptoSession::kChannels));
+    reliable[CryptoSession::kCounterBytes - 1] = CryptoSession::kChannels;
+    CHECK(clientSession.Decrypt(reliable).empty());
+}
+
+TEST_CASE("crypto.session_salt")
+{
+    CryptoKeys clientKeys;
+    CryptoKeys serverKeys;
+
+    // the same static key pairs, as with a replayed handshake or a client reusing its keys
+    const auto    firstSalt = CryptoSession::MakeSalt();
+    CryptoSession first;
+    CryptoSession second;
+    first.Init(serverKeys, clientKeys.RawPublicKey(), AEADID::XChaCha20Poly1305, true, firstSalt);
+    second.Init(
+        serverKeys,
+        clientKeys.RawPublicKey(),
+        AEADID::XChaCha20Poly1305,
+        true,
+        CryptoSession::MakeSalt());
+    REQUIRE(first.Valid());
+    REQUIRE(second.Valid());
+
+    const std::vector<uint8_t> plaintext = {1, 2, 3, 4, 5, 6, 7, 8};
+
+    byte_view            encrypted = first.Encrypt(plaintext);
+    std::vector<uint8_t> fromFirst(encrypted.begin(), encrypted.end());
+    encrypted = second.Encrypt(plaintext);
+    std::vector<uint8_t> fromSecond(encrypted.begin(), encrypted.end());
+
+    // same counter, different keys
+    REQUIRE_EQ(fromFirst.size(), fromSecond.size());
+    CHECK(std::equal(
+        fromFirst.begin(),
+        fromFirst.begin() + CryptoSession::kCounterBytes,
+        fromSecond.begin()));
+    CHECK(fromFirst != fromSecond);
+
+    // only the client given the salt of a session opens it
+    CryptoSession client;
+    client.Init(clientKeys, serverKeys.RawPublicKey(), AEADID::XChaCha20Poly1305, false, firstSalt);
+    CHECK(client.Decrypt(fromSecond).empty());
+    CHECK_FALSE(client.Decrypt(fromFirst).empty());
+}
+
+TEST_CASE("crypto.replay_window")
+{
+    ReplayWindow window;
+
+    CHECK(window.Check(10));
+    window.Accept(10);
+    CHECK_FALSE(window.Check(10));
+    CHECK(window.Check(9));
+    CHECK(window.Check(11));
+
+    window.Accept(10 + ReplayWindow::kSize);
+    // slid out of the window
+    CHECK_FALSE(window.Check(10));
+    CHECK_FALSE(window.Check(9));
+    CHECK(window.Check(11));
+    CHECK_FALSE(window.Check(10 + ReplayWindow::kSize));
+
+    // a jump larger than the window forgets everything behind it
+    window.Accept(10 + 4 * ReplayWindow::kSize);
+    CHECK(window.Check(11 + 3 * ReplayWindow::kSize));
+    CHECK_FALSE(window.Check(10 + 3 * ReplayWindow::kSize));
+}
+
+TEST_CASE("crypto.session_encrypt_into")
+{
+    CryptoKeys clientKeys;
+    CryptoKeys serverKeys;
+
+    CryptoSession clientSession;
+    CryptoSession serverSession;
+
+    serverSession.Init(
+        serverKeys,
+        clientKeys.RawPublicKey(),
+        AEADID::XChaCha20Poly1305,
+        true,
+        kTestSalt);
+    clientSession.Init(
+        clientKeys,
+        serverKeys.RawPublicKey(),
+        AEADID::XChaCha20Poly1305,
+        false,
+        kTestSalt);
+
+    std::vector<uint8_t> plaintext = {1, 2, 3, 4, 5, 6};
+    std::vector<uint8_t> packet(plaintext.size() + clientSession.Overhead());
+
+    // the output must be sized exactly
+    std::vector<uint8_t> tooSmall(packet.size() - 1);
+    CHECK_FALSE(clientSession.EncryptInto(plaintext, tooSmall));
+
+    REQUIRE(clientSession.EncryptInto(plaintext, packet));
+
+    byte_view decrypted = serverSession.Decrypt(packet);
+    REQUIRE_FALSE(decrypted.empty());
+    CHECK(std::vector<uint8_t>(decrypted.begin(), decrypted.end()) == plaintext);
+}
+
+TEST_CASE("crypto.session_every_aead")
+{
+    for (std::uint8_t id = 0; id < std::uint8_t(AEADID::Count); ++id) {
+        const AEADID cipher = AEADID(id);
+        CAPTURE(AEADFromID(cipher)->Name);
+
+        CryptoKeys clientKeys;
+        CryptoKeys serverKeys;
+
+        CryptoSession clientSession;
+        CryptoSession serverSession;
+
+        serverSession.Init(serverKeys, clientKeys.RawPublicKey(), cipher, true, kTestSalt);
+        clientSession.Init(clientKeys, serverKeys.RawPublicKey(), cipher, false, kTestSalt);
+        REQUIRE(serverSession.Valid());
+
+        std::vector<uint8_t> plaintext(200, 0x5A);
+
+        byte_view encrypted = clientSession.Encrypt(plaintext);
+        REQUIRE_FALSE(encrypted.empty());
+        CHECK(encrypted.size() == plaintext.size() + clientSession.Overhead());
+
+        byte_view decrypted = serverSession.Decrypt(encrypted);
+        REQUIRE_FALSE(decrypted.empty());
+        CHECK(std::vector<uint8_t>(decrypted.begin(), decrypted.end()) == plaintext);
+    }
+}
+
+TEST_CASE("crypto.session_negotiation")
+{
+    CryptoKeys clientKeys;
+    CryptoKeys serverKeys;
+
+    CryptoSession clientSession;
+    CryptoSession serverSession;
+
+    // the server picked AEGIS-128L, the client guessed otherwise and offered all
+    serverSession.Init(serverKeys, clientKeys.RawPublicKey(), AEADID::AEGIS128L, true, kTestSalt);
+    clientSession.Init(
+        clientKeys,
+        serverKeys.RawPublicKey(),
+        AEADID::XChaCha20Poly1305,
+        false,
+        kTestSalt);
+    clientSession.Offer(kAllAEADs);
+    REQUIRE(clientSession.Negotiating());
+
+    std::vector<uint8_t> plaintext = {3, 1, 4, 1, 5};
+
+    byte_view            view = serverSession.Encrypt(plaintext);
+    std::vector<uint8_t> response(view.begin(), view.end());
+
+    SUBCASE("settles on the cipher of the first authenticated message")
+    {
+        byte_view decrypted = clientSession.Decrypt(response);
+        REQUIRE_FALSE(decrypted.empty());
+        CHECK(std::vector<uint8_t>(decrypted.begin(), decrypted.end()) == plaintext);
+        CHECK_FALSE(clientSession.Negotiating());
+        CHECK(clientSession.Cipher() == AEADID::AEGIS128L);
+
+        byte_view request = clientSession.Encrypt(plaintext);
+        CHECK_FALSE(serverSession.Decrypt(request).empty());
+    }
+
+    SUBCASE("ciphers that were not offered are never tried")
+    {
+        clientSession.Offer(AEADBit(AEADID::XChaCha20Poly1305) | AEADBit(AEADID::AEGIS256));
+        CHECK(clientSession.Decrypt(response).empty());
+        CHECK(clientSession.Negotiating());
+    }
+}
+
+TEST_CASE("crypto.aead_ranking")
+{
+    std::vector<AEADTiming> timings;
+    const std::size_t       sizes[] = {64};
+
+    auto ranking = RankAEADs(sizes, 16, &timings);
+
+    CHECK(ranking.size() == std::size_t(std::popcount(SupportedAEADs())));
+    CHECK(timings.size() == ranking.size());
+    for (const auto& timing : timings) {
+        CHECK(timing.RoundTrip);
+        CHECK(timing.MessageBytes == 64);
+    }
+}
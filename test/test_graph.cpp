@@ -1,8 +1,44 @@
 #include <input/action.hpp>
+#include <random>
+#include <taskflow/core/executor.hpp>
 
+#include "core/flow_field_jobs.hpp"
 #include "core/graph.hpp"
 #include "test.hpp"
 
+// same distances and steps as computing the paths of aGraph obstacles from scratch
+static void checkFullPaths(const Graph& aGraph, const GraphCell& aDest)
+{
+    Graph full(aGraph.Width(), aGraph.Height(), glm::vec2{0.0f, 0.0f});
+    for (GraphCell::size_type y = 0; y < aGraph.Height(); ++y) {
+        for (GraphCell::size_type x = 0; x < aGraph.Width(); ++x) {
+            if (aGraph.IsObstacle(GraphCell(x, y))) {
+                full.AddObstacle(GraphCell(x, y));
+            }
+        }
+    }
+    full.ComputePaths(aDest);
+
+    for (GraphCell::size_type y = 0; y < aGraph.Height(); ++y) {
+        for (GraphCell::size_type x = 0; x < aGraph.Width(); ++x) {
+            const GraphCell cell(x, y);
+            REQUIRE_EQ(full.Distance(cell), aGraph.Distance(cell));
+            REQUIRE_EQ(full.GetNextCell(cell), aGraph.GetNextCell(cell));
+        }
+    }
+}
+
+static void checkSamePaths(const Graph& aGraph, const Graph& aExpected)
+{
+    for (GraphCell::size_type y = 0; y < aGraph.Height(); ++y) {
+        for (GraphCell::size_type x = 0; x < aGraph.Width(); ++x) {
+            const GraphCell cell(x, y);
+            REQUIRE_EQ(aExpected.Distance(cell), aGraph.Distance(cell));
+            REQUIRE_EQ(aExpected.GetNextCell(cell), aGraph.GetNextCell(cell));
+        }
+    }
+}
+
 TEST_SUITE("graph")
 {
     TEST_CASE("graph.is_inside")
@@ -111,4 +147,167 @@ TEST_SUITE("graph")
         }
         CHECK_EQ(dest, current);
     }
+
+    TEST_CASE("graph.step_order")
+    {
+        Graph g(10, 10, glm::vec2{0.0f, 0.0f});
+        g.ComputePaths(GraphCell(5, 5));
+
+        CHECK_EQ(0U, g.Distance(GraphCell(5, 5)));
+        CHECK_EQ(2U, g.Distance(GraphCell(3, 5)));
+        CHECK_EQ(2U, g.Distance(GraphCell(7, 7)));
+        CHECK_EQ(std::nullopt, g.GetNextCell(GraphCell(5, 5)));
+
+        // (3, 4) can step E to (4, 4) or SE to (4, 5), E comes first
+        CHECK_EQ(GraphCell(4, 4), g.GetNextCell(GraphCell(3, 4)));
+        // straight steps come before diagonal ones
+        CHECK_EQ(GraphCell(5, 6), g.GetNextCell(GraphCell(5, 7)));
+
+        g.AddObstacle(GraphCell(5, 6));
+        g.ComputePaths(GraphCell(5, 5));
+        CHECK_EQ(Graph::kUnreachable, g.Distance(GraphCell(5, 6)));
+        // around it, NE comes before NW
+        CHECK_EQ(GraphCell(6, 6), g.GetNextCell(GraphCell(5, 7)));
+    }
+
+    TEST_CASE("graph.large_grid")
+    {
+        Graph g(600, 600, glm::vec2{0.0f, 0.0f});
+        for (GraphCell::size_type y = 0; y < 599; ++y) {
+            g.AddObstacle(GraphCell(300, y));
+        }
+        g.ComputePaths(GraphCell(599, 0));
+
+        CHECK(g.IsObstacle(GraphCell(300, 598)));
+        CHECK_FALSE(g.IsObstacle(GraphCell(300, 599)));
+        // around the wall through its only gap, at the bottom
+        CHECK_EQ(599U + 599U, g.Distance(GraphCell(0, 0)));
+        CHECK_EQ(Graph::kUnreachable, g.Distance(GraphCell(600, 0)));
+    }
+
+    TEST_CASE("graph.update_paths")
+    {
+        std::mt19937 rng(7);
+
+        for (int map = 0; map < 20; ++map) {
+            const auto width  = GraphCell::size_type(10 + rng() % 30);
+            const auto height = GraphCell::size_type(10 + rng() % 30);
+
+            auto randomCell = [&] {
+                const auto x = GraphCell::size_type(rng() % width);
+                return GraphCell(x, GraphCell::size_type(rng() % height));
+            };
+
+            Graph     g(width, height, glm::vec2{0.0f, 0.0f});
+            GraphCell dest = randomCell();
+            for (int i = 0; i < width * height / 5; ++i) {
+                g.AddObstacle(randomCell());
+            }
+            g.ComputePaths(dest);
+
+            for (int update = 0; update < 20; ++update) {
+                // towers cover 3x3 cells, and sold or predicted ones free them
+                const GraphCell corner = randomCell();
+                const bool      add    = rng() % 3 != 0;
+                for (GraphCell::size_type dx = 0; dx < 3; ++dx) {
+                    for (GraphCell::size_type dy = 0; dy < 3; ++dy) {
+                        const GraphCell cell(corner.Location.x + dx, corner.Location.y + dy);
+                        if (add) {
+                            g.AddObstacle(cell);
+                        } else {
+                            g.RemoveObstacle(cell);
+                        }
+                    }
+                }
+                g.UpdatePaths();
+                checkFullPaths(g, dest);
+            }
+        }
+    }
+
+    TEST_CASE("graph.copy_paths_from")
+    {
+        const GraphCell dest(10, 10);
+        Graph           g(20, 20, glm::vec2{0.0f, 0.0f});
+        g.ComputePaths(dest);
+        for (GraphCell::size_type y = 5; y < 16; ++y) {
+            g.AddObstacle(GraphCell(8, y));
+        }
+
+        // resized from another grid, the pending changes come along and are repaired on the copy
+        Graph copy(7, 3, glm::vec2{1.0f, 2.0f});
+        copy.CopyPathsFrom(g);
+        CHECK_EQ(g.Width(), copy.Width());
+        CHECK_EQ(g.Height(), copy.Height());
+        CHECK_EQ(g.CellFromWorld(5.0f, 5.0f), copy.CellFromWorld(5.0f, 5.0f));
+        CHECK_EQ(11U, copy.PendingChanges());
+        checkSamePaths(copy, g);
+
+        copy.UpdatePaths();
+        checkFullPaths(copy, dest);
+
+        // back over paths of the same size, the old ones are overwritten
+        g.UpdatePaths();
+        g.RemoveObstacle(GraphCell(8, 10));
+        copy.CopyPathsFrom(g);
+        CHECK_EQ(1U, copy.PendingChanges());
+        copy.UpdatePaths();
+        checkFullPaths(copy, dest);
+    }
+
+    TEST_CASE("graph.flow_field_jobs")
+    {
+        tf::Executor executor(1);
+
+        for (tf::Executor* exec : {static_cast<tf::Executor*>(nullptr), &executor}) {
+            CAPTURE(exec);
+            PlayerGraphMap  graphs;
+            const PlayerID  player = 1;
+            const GraphCell dest(10, 10);
+
+            auto& g = graphs.try_emplace(player, 20, 20, glm::vec2{0.0f, 0.0f}).first->second;
+            g.ComputePaths(dest);
+            const Graph before = g;
+
+            FlowFieldJobs jobs(exec);
+            for (GraphCell::size_type y = 5; y < 16; ++y) {
+                g.AddObstacle(GraphCell(8, y));
+            }
+            jobs.Submit(player, g, 100);
+            Graph firstWall = g;
+            firstWall.ComputePaths(dest);
+
+            for (GraphCell::size_type x = 5; x < 16; ++x) {
+                g.AddObstacle(GraphCell(x, 13));
+            }
+            jobs.Submit(player, g, 103);
+            CHECK_EQ(2U, jobs.Pending());
+
+            // old paths until the first repair is due, whether the worker is done or not
+            for (std::uint32_t tick = 100; tick < 100 + FlowFieldJobs::kDelay; ++tick) {
+                CHECK_EQ(0U, jobs.Publish(graphs, tick));
+            }
+            checkSamePaths(g, before);
+
+            // around the first wall only, the second one is still pending
+            CHECK_EQ(1U, jobs.Publish(graphs, 100 + FlowFieldJobs::kDelay));
+            CHECK(g.IsObstacle(GraphCell(5, 13)));
+            CHECK_EQ(10U, g.PendingChanges());
+            checkSamePaths(g, firstWall);
+
+            CHECK_EQ(1U, jobs.Publish(graphs, 103 + FlowFieldJobs::kDelay));
+            CHECK_EQ(0U, jobs.Pending());
+            CHECK_EQ(0U, g.PendingChanges());
+            checkFullPaths(g, dest);
+
+            // published buffers are reused, with the paths of the graph before the repairs
+            for (GraphCell::size_type y = 5; y < 16; ++y) {
+                g.RemoveObstacle(GraphCell(8, y));
+            }
+            jobs.Submit(player, g, 110);
+            CHECK_EQ(1U, jobs.Publish(graphs, 110 + FlowFieldJobs::kDelay));
+            CHECK_EQ(0U, g.PendingChanges());
+            checkFullPaths(g, dest);
+        }
+    }
 }
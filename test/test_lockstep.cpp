@@ -0,0 +1,202 @@
+#include <doctest.h>
+
+#include <glaze/glaze.hpp>
+
+#include "components/creep.hpp"
+#include "components/game.hpp"
+#include "components/health.hpp"
+#include "components/player.hpp"
+#include "components/rigid_body.hpp"
+#include "components/tower.hpp"
+#include "components/transform3d.hpp"
+#include "core/app/app.hpp"
+#include "core/graph.hpp"
+#include "core/physics/physics.hpp"
+#include "core/state.hpp"
+#include "core/state_hash.hpp"
+#include "input/action.hpp"
+#include "registry/registry.hpp"
+#include "systems/action.hpp"
+
+using namespace entt::literals;
+
+// a lockstep client's simulation, set up like GameClient does from the server's players
+class LockstepPeer : public Application
+{
+   public:
+    // last hitters of the creeps the towers killed, before Reg: its teardown may destroy creeps
+    std::vector<PlayerID> Kills;
+    Registry              Reg;
+
+    // aPhysicsNoise bodies are created first, outside the registry: the peers' physics worlds
+    // then differ in ids, and reactphysics3d may report the overlaps of a step in another order
+    LockstepPeer(const std::string& aName, uint32_t aPhysicsNoise) : Application(aName)
+    {
+        auto err = glz::read_file_json(mGameplayDef, TESTDATA_DIR "/gameplay.json", std::string{});
+        if (err) {
+            mLogger->critical(glz::format_error(err));
+        }
+
+        Reg.ctx().emplace<Logger>(mLogger);
+        StartGameInstance(Reg, 1);
+        GetSingletonComponent<GameInstance&>(Reg).Lockstep = true;
+
+        Reg.ctx().emplace<const GameplayDef&>(mGameplayDef);
+        Reg.ctx().emplace<CommonIncome>(mGameplayDef.Economy.StartingIncome);
+        Reg.ctx().emplace_as<std::vector<PlayerID>>("ranking"_hs);
+        Reg.ctx().emplace<TaggedActionsType>();
+        Reg.ctx().emplace<PlayerGraphMap>();
+        Reg.ctx().emplace<LockstepTurns>();
+        Reg.group<Player>(entt::get<Health>, entt::exclude<Eliminated>);
+        Reg.ctx().emplace<StateHash>().Watch(Reg);
+        Reg.on_destroy<Creep>().connect<&LockstepPeer::onCreepDestroyed>(*this);
+
+        addPhysicsNoise(aPhysicsNoise);
+        addPlayer(1, 0, 1, glm::vec2(0.0f, 0.0f));
+        addPlayer(2, 1, 0, glm::vec2(25.0f, 0.0f));
+
+        auto& fixedExec = GetSingletonComponent<FixedSystemExecutor>(Reg);
+        RegisterSimulationSystems(fixedExec);
+        fixedExec.Register<LockstepTurnSystem>();
+    }
+
+    int Run(tf::Executor&) override { return 0; }
+
+    void RunTurn(const LockstepTurn& aTurn)
+    {
+        auto& instance = GetSingletonComponent<GameInstance&>(Reg);
+
+        REQUIRE(GetSingletonComponent<LockstepTurns>(Reg).Push(LockstepTurn{aTurn}));
+        ++instance.Tick;
+        GetSingletonComponent<FixedSystemExecutor>(Reg).Update(instance.Tick, &Reg);
+    }
+
+    [[nodiscard]] std::uint64_t Hash() const { return Reg.ctx().get<StateHash>().Value(); }
+
+    [[nodiscard]] int GoldOf(PlayerID aID) const
+    {
+        return Reg.get<Gold>(FindPlayerEntity(Reg, aID)).Balance;
+    }
+
+   private:
+    static constexpr glm::uvec2 kMapSize{20, 20};
+
+    void addPhysicsNoise(uint32_t aCount)
+    {
+        auto& phy = GetSingletonComponent<Physics>(Reg);
+
+        for (uint32_t i = 0; i < aCount; ++i) {
+            auto* body = phy.CreateRigidBody(
+                RigidBodyParams{
+                    .Type           = rp3d::BodyType::STATIC,
+                    .Velocity       = 0.0f,
+                    .Direction      = glm::vec3(0.0f),
+                    .GravityEnabled = false,
+                },
+                Transform3D{glm::vec3(float(i), -100.0f, 0.0f)});
+            phy.AddCollider(
+                body,
+                ColliderParams{
+                    .CollisionCategoryBits = 0,
+                    .CollideWithMaskBits   = 0,
+                    .IsTrigger             = true,
+                    .ShapeParams = BoxShapeParams{.HalfExtents = glm::vec3(0.5f)},
+                });
+        }
+    }
+
+    void addPlayer(PlayerID aID, uint8_t aSlot, uint8_t aSender, glm::vec2 aOffset)
+    {
+        auto player = Reg.create();
+
+        Reg.emplace<Player>(player, aID, aSlot);
+        Reg.emplace<Health>(player, 10.0f);
+        Reg.emplace<Gold>(player, mGameplayDef.Economy.StartingGold);
+        auto& t3D = Reg.emplace<Transform3D>(
+            player,
+            glm::vec3(2.0f + aOffset.x, 0.004f, 2.0f + aOffset.y));
+        Reg.emplace<RigidBody>(
+            player,
+            RigidBody{
+                .Params =
+                    RigidBodyParams{
+                        .Type           = rp3d::BodyType::STATIC,
+                        .Velocity       = 0.0f,
+                        .Direction      = glm::vec3(0.0f),
+                        .GravityEnabled = false,
+                    },
+            });
+        Reg.emplace<Collider>(
+            player,
+            Collider{
+                .Params =
+                    ColliderParams{
+                        .CollisionCategoryBits = Category::Base,
+                        .CollideWithMaskBits   = CollidesWith(
+                            PlayerEntitiesCategory(aSender),
+                            Category::Terrain,
+                            Category::Tower),
+                        .IsTrigger = true,
+                        .ShapeParams =
+                            BoxShapeParams{
+                                .HalfExtents = GraphCell(1, 1).ToWorld() * 0.5f,
+                            },
+                    },
+            });
+        SpawnTerrain(Reg, player, kMapSize, aOffset);
+
+        auto [it, inserted] = GetSingletonComponent<PlayerGraphMap>(Reg).try_emplace(
+            aID,
+            kMapSize.x * GraphCell::kCellsPerAxis,
+            kMapSize.y * GraphCell::kCellsPerAxis,
+            aOffset);
+        it->second.ComputePaths(t3D.Position);
+    }
+
+    void onCreepDestroyed(Registry& aRegistry, entt::entity aCreep)
+    {
+        if (const auto* health = aRegistry.try_get<Health>(aCreep); health && health->Health <= 0) {
+            Kills.push_back(health->LastHitBy);
+        }
+    }
+};
+
+TEST_CASE("lockstep.peers_stay_in_sync")
+{
+    static constexpr std::uint32_t kCreeps = 5;
+
+    LockstepPeer a("lockstep_a", 0);
+    LockstepPeer b("lockstep_b", 64);
+
+    TaggedActionsType towers;
+    for (float x = 34.0f; x <= 40.0f; x += 2.0f) {
+        for (float z = 12.0f; z <= 14.0f; z += 2.0f) {
+            Action build = kBuildTowerAction;
+            std::get<BuildTowerPayload>(build.Payload).Position = glm::vec3(x, 0.0f, z);
+            towers.push_back({2, build});
+        }
+    }
+
+    std::uint32_t sent = 0;
+    for (std::uint32_t tick = 1; tick <= 1800; ++tick) {
+        LockstepTurn turn{.Tick = tick};
+        if (tick == 1) {
+            turn.Actions = towers;
+        } else if (tick % 30 == 0 && sent < kCreeps) {
+            turn.Actions.push_back({1, kSendCreepAction});
+            ++sent;
+        }
+
+        a.RunTurn(turn);
+        b.RunTurn(turn);
+        REQUIRE_MESSAGE(a.Hash() == b.Hash(), "peers diverged at tick ", tick);
+    }
+
+    // towers were built, creeps were sent and the towers killed some of them
+    CHECK_EQ(a.Reg.view<Tower>().size(), towers.size());
+    CHECK_EQ(a.Reg.view<Creep>().size(), 0);
+    CHECK_FALSE(a.Kills.empty());
+    CHECK_EQ(a.Kills, b.Kills);
+    CHECK_EQ(a.GoldOf(1), b.GoldOf(1));
+    CHECK_EQ(a.GoldOf(2), b.GoldOf(2));
+}
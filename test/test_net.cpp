@@ -1,6 +1,21 @@
 #include "test.hpp"
 
+#include <cstring>
+#include <map>
+#include <random>
+#include <thread>
+
+#include <components/interpolation.hpp>
+#include <core/net/decode_pool.hpp>
+#include <core/net/entity_sync_map.hpp>
+#include <core/net/handshake_guard.hpp>
+#include <core/net/interest.hpp>
+#include <core/net/link_conditioner.hpp>
 #include <core/net/net.hpp>
+#include <core/net/net_stats.hpp>
+#include <core/net/packet_batch.hpp>
+#include <core/net/state_snapshot.hpp>
+#include <core/net/token_cache.hpp>
 #include <core/snapshot.hpp>
 
 TEST_CASE("net.serialize")
@@ -31,3 +46,790 @@ TEST_CASE("net.serialize")
     delete ev;
     delete ev2;
 }
+
+TEST_CASE("net.input_payload")
+{
+    InputPayload input{.GameID = 3};
+    input.Inputs.push_back(TickActions{.Tick = 40, .Actions = {Action{MovePayload{}}}});
+    input.Inputs.push_back(TickActions{.Tick = 42, .Actions = {Action{SendCreepPayload{}}}});
+    input.SnapshotAck = 38;
+    input.Desync      = 30;
+    input.View        = ViewRegion{.Min = glm::vec2(-2.0f, 3.0f), .Max = glm::vec2(8.0f, 13.0f)};
+
+    NetworkRequest req{
+        .Type     = PacketType::ClientInput,
+        .PlayerID = 7,
+        .Tick     = 42,
+        .Payload  = input,
+    };
+    CHECK_EQ(DeliveryFor(req.Type), Delivery::Unreliable);
+
+    BitOutputArchive outAr;
+    REQUIRE(req.Archive(outAr));
+
+    BitInputArchive inAr(outAr.Data());
+    NetworkRequest  req2;
+    REQUIRE(req2.Archive(inAr));
+    CHECK_EQ(req2.Type, PacketType::ClientInput);
+    CHECK_EQ(req.Payload, req2.Payload);
+
+    NetworkResponse ack{
+        .Type     = PacketType::InputAck,
+        .PlayerID = 7,
+        .Tick     = 50,
+        .Payload  = InputAckResponse{.NextTick = 43},
+    };
+    REQUIRE(SupersedeKey(ack));
+    CHECK_EQ(*SupersedeKey(ack), kInputAckKey);
+}
+
+TEST_CASE("net.lockstep_turn")
+{
+    LockstepTurn turn{.Tick = 15, .Hash = 0xfedcba9876543210ULL};
+    turn.Actions.push_back(TaggedAction{.PlayerID = 7, .Action = Action{SendCreepPayload{}}});
+    turn.Actions.push_back(TaggedAction{.PlayerID = 3, .Action = Action{MovePayload{}}});
+
+    NetworkResponse resp{
+        .Type     = PacketType::ServerSync,
+        .PlayerID = 0,
+        .Tick     = 15,
+        .Payload  = turn,
+    };
+    CHECK_EQ(DeliveryFor(resp.Type), Delivery::Reliable);
+    CHECK_FALSE(SupersedeKey(resp));
+
+    BitOutputArchive outAr;
+    REQUIRE(resp.Archive(outAr));
+
+    BitInputArchive inAr(outAr.Data());
+    NetworkResponse resp2;
+    REQUIRE(resp2.Archive(inAr));
+    CHECK_EQ(resp.Payload, resp2.Payload);
+
+    SUBCASE("turns are queued in tick order")
+    {
+        LockstepTurns turns;
+        CHECK_FALSE(turns.Ready(1));
+        CHECK(turns.Push(LockstepTurn{.Tick = 1}));
+        CHECK(turns.Push(LockstepTurn{.Tick = 2}));
+        // a gap or a repeat is not the next tick
+        CHECK_FALSE(turns.Push(LockstepTurn{.Tick = 4}));
+        CHECK_FALSE(turns.Push(LockstepTurn{.Tick = 2}));
+
+        CHECK(turns.Ready(2));
+        CHECK_FALSE(turns.Ready(3));
+        CHECK_EQ(turns.Pending.size(), 2);
+        CHECK_EQ(turns.Pending.front().Tick, 1);
+    }
+}
+
+TEST_CASE("net.peer_traffic")
+{
+    PeerTraffic traffic;
+    traffic.CountIn(PacketType::ClientInput, 40);
+    traffic.CountIn(PacketType::ClientInput, 24);
+    traffic.CountOut(PacketType::StateUpdate, 100);
+    traffic.CountOut(PacketType::Count, 1000);
+
+    CHECK_EQ(PeerTraffic::Total(traffic.In).Packets, 2);
+    CHECK_EQ(PeerTraffic::Total(traffic.In).Bytes, 64);
+    CHECK_EQ(PeerTraffic::Total(traffic.Out).Bytes, 100);
+
+    NetworkStatsResponse stats{
+        .RTT                   = 42,
+        .RTTVariance           = 3,
+        .PacketLoss            = 0.25f,
+        .ReliableInFlight      = 2,
+        .ReliableBytesInFlight = 300,
+        .Retransmits           = 7,
+        .Traffic               = traffic.Summary(),
+    };
+    REQUIRE_EQ(stats.Traffic.size(), 2);
+    CHECK_EQ(DeliveryFor(PacketType::NetworkStats), Delivery::Unreliable);
+
+    NetworkResponse  resp{.Type = PacketType::NetworkStats, .Payload = stats};
+    BitOutputArchive outAr;
+    REQUIRE(resp.Archive(outAr));
+
+    BitInputArchive inAr(outAr.Data());
+    NetworkResponse resp2;
+    REQUIRE(resp2.Archive(inAr));
+    CHECK_EQ(resp.Payload, resp2.Payload);
+
+    NetTotals totals{.Peers = 1, .BytesIn = 10, .MaxRTT = 20};
+    totals += NetTotals{.Peers = 2, .BytesIn = 5, .MaxRTT = 15};
+    CHECK_EQ(totals.Peers, 3);
+    CHECK_EQ(totals.BytesIn, 15);
+    CHECK_EQ(totals.MaxRTT, 20);
+}
+
+TEST_CASE("net.packet_batch")
+{
+    PacketBatch batch;
+
+    NetworkResponse  first{.Type = PacketType::Ack, .PlayerID = 1, .Tick = 10};
+    NetworkResponse  second{.Type = PacketType::Nack, .PlayerID = 2, .Tick = 11};
+    BitOutputArchive ar1, ar2;
+    first.Archive(ar1);
+    second.Archive(ar2);
+
+    REQUIRE(batch.Append(ar1.Bytes()));
+    REQUIRE(batch.Append(ar2.Bytes()));
+    CHECK_EQ(batch.Count(), 2);
+
+    std::vector<NetworkResponse> received;
+    CHECK(PacketBatch::ForEach(batch.Bytes(), [&](byte_view aMsg) {
+        BitInputArchive  inAr(aMsg, true);
+        NetworkResponse& resp = received.emplace_back();
+        CHECK(resp.Archive(inAr));
+    }));
+    REQUIRE_EQ(received.size(), 2);
+    CHECK_EQ(received[0].PlayerID, 1);
+    CHECK_EQ(received[0].Tick, 10);
+    CHECK_EQ(received[1].Type, PacketType::Nack);
+    CHECK_EQ(received[1].Tick, 11);
+
+    SUBCASE("full batch rejects messages")
+    {
+        byte_buffer large(PacketBatch::kMaxBytes, 0);
+        CHECK_FALSE(batch.Append(large));
+        batch.Clear();
+        CHECK(batch.Empty());
+        CHECK(batch.Append(large));
+    }
+
+    SUBCASE("truncated batch is malformed")
+    {
+        byte_view truncated = batch.Bytes().first(batch.Bytes().size() - 1);
+        int       count     = 0;
+        CHECK_FALSE(PacketBatch::ForEach(truncated, [&](byte_view) { ++count; }));
+        CHECK_EQ(count, 1);
+    }
+}
+
+TEST_CASE("net.latest_state_queue")
+{
+    LatestStateQueue queue;
+
+    const byte_buffer first{1, 2, 3, 4};
+    const byte_buffer second{5, 6, 7, 8};
+    const byte_buffer newer{9, 10, 11, 12};
+
+    queue.Put(1, first);
+    queue.Put(2, second);
+    queue.Put(1, newer);
+
+    CHECK_EQ(queue.Size(), 2);
+    CHECK_EQ(queue.Superseded(), 1);
+
+    std::vector<byte_buffer> drained;
+    queue.Drain([&](byte_view aMsg) { drained.emplace_back(aMsg.begin(), aMsg.end()); });
+
+    REQUIRE_EQ(drained.size(), 2);
+    // superseded updates keep their original position
+    CHECK_EQ(drained[0], newer);
+    CHECK_EQ(drained[1], second);
+    CHECK(queue.Empty());
+
+    CHECK_EQ(DeliveryFor(PacketType::StateUpdate), Delivery::Unreliable);
+    CHECK_EQ(DeliveryFor(PacketType::Ack), Delivery::Reliable);
+}
+
+TEST_CASE("net.latest_state_queue.budget")
+{
+    LatestStateQueue queue;
+
+    const byte_buffer low(8, 1);
+    const byte_buffer urgent(8, 2);
+    const byte_buffer medium(8, 3);
+    const byte_buffer fresh(8, 4);
+
+    std::vector<uint8_t> sent;
+    auto                 record = [&](byte_view aMsg) { sent.push_back(aMsg[0]); };
+
+    queue.Put(1, low, 1);
+    queue.Put(2, urgent, 5);
+    queue.Put(3, medium, 2);
+
+    // room for two updates: the two most urgent go first
+    CHECK_EQ(queue.Drain(16, record), 16);
+    CHECK_EQ(sent, std::vector<uint8_t>{2, 3});
+    CHECK_EQ(queue.Size(), 1);
+    CHECK_EQ(queue.Deferred(), 1);
+
+    // the deferred update keeps accumulating and now beats a fresh one
+    sent.clear();
+    queue.Put(1, low, 1);
+    queue.Put(4, fresh, 1);
+    CHECK_EQ(queue.Drain(8, record), 8);
+    CHECK_EQ(sent, std::vector<uint8_t>{1});
+
+    sent.clear();
+    CHECK_EQ(queue.Drain(record), 8);
+    CHECK_EQ(sent, std::vector<uint8_t>{4});
+    CHECK(queue.Empty());
+
+    // the most urgent update goes out even when larger than the whole budget, alone
+    const byte_buffer large(64, 5);
+    sent.clear();
+    queue.Put(5, large, 3);
+    queue.Put(1, low, 1);
+    CHECK_EQ(queue.Drain(16, record), 64);
+    CHECK_EQ(sent, std::vector<uint8_t>{5});
+    CHECK_EQ(queue.Size(), 1);
+}
+
+TEST_CASE("net.latest_state_queue.many_keys")
+{
+    using key_type = LatestStateQueue::key_type;
+
+    LatestStateQueue queue;
+    // latest value queued for each pending key
+    std::map<key_type, key_type> pending;
+    std::mt19937                 rng(3);
+
+    // the key then the value, 4 bytes each
+    auto message = [](key_type aKey, key_type aValue) {
+        byte_buffer bytes(8);
+        std::memcpy(bytes.data(), &aKey, sizeof(aKey));
+        std::memcpy(bytes.data() + sizeof(aKey), &aValue, sizeof(aValue));
+        return bytes;
+    };
+
+    for (int round = 0; round < 200; ++round) {
+        for (int i = 0; i < 40; ++i) {
+            // entity like keys, versions in the high bits, enough to collide in the index
+            const auto key   = key_type((rng() % 64) | ((rng() % 2) << 20));
+            const auto value = key_type(rng());
+            queue.Put(key, message(key, value));
+            pending[key] = value;
+        }
+        REQUIRE_EQ(queue.Size(), pending.size());
+
+        // a budget for some of them only, the rest is deferred
+        queue.Drain(8 * (rng() % 20), [&](byte_view aMsg) {
+            key_type key   = 0;
+            key_type value = 0;
+            std::memcpy(&key, aMsg.data(), sizeof(key));
+            std::memcpy(&value, aMsg.data() + sizeof(key), sizeof(value));
+
+            auto it = pending.find(key);
+            REQUIRE(it != pending.end());
+            CHECK_EQ(it->second, value);
+            pending.erase(it);
+        });
+        REQUIRE_EQ(queue.Size(), pending.size());
+    }
+}
+
+using TestConditioner = LinkConditioner<int>;
+
+// submits one 100 bytes datagram per millisecond for a second, returns the delivery order
+static std::vector<int> RunLink(TestConditioner& aLink)
+{
+    const TestConditioner::time_point start{};
+    const byte_buffer                 datagram(100, 0);
+    std::vector<int>                  order;
+
+    auto collect = [&](const int& aFrom, byte_buffer&) { order.push_back(aFrom); };
+    for (int i = 0; i < 1000; ++i) {
+        const auto now = start + std::chrono::milliseconds(i);
+        aLink.Submit(now, i, datagram);
+        aLink.Deliver(now, collect);
+    }
+    aLink.Deliver(start + std::chrono::seconds(10), collect);
+    return order;
+}
+
+TEST_CASE("net.link_conditioner")
+{
+    using namespace std::chrono_literals;
+
+    const LinkConditions lossy{
+        .Latency       = 40ms,
+        .Jitter        = 5ms,
+        .LossChance    = 0.1,
+        .ReorderChance = 0.05,
+        .ReorderDelay  = 30ms,
+    };
+
+    SUBCASE("a seed replays the same link")
+    {
+        TestConditioner first(lossy, 42), second(lossy, 42), other(lossy, 43);
+
+        const auto order = RunLink(first);
+        CHECK_EQ(order, RunLink(second));
+        CHECK_NE(order, RunLink(other));
+
+        CHECK_EQ(first.Submitted(), 1000);
+        CHECK_EQ(first.Delivered() + first.Dropped(), 1000);
+        CHECK_EQ(first.Pending(), 0);
+        CHECK(first.Dropped() > 50);
+        CHECK(first.Dropped() < 150);
+        CHECK(first.Reordered() > 0);
+        CHECK_FALSE(std::ranges::is_sorted(order));
+    }
+
+    SUBCASE("fixed latency keeps order")
+    {
+        TestConditioner link(LinkConditions{.Latency = 20ms}, 1);
+
+        const TestConditioner::time_point start{};
+        const byte_buffer                 datagram(10, 0);
+        link.Submit(start, 1, datagram);
+        link.Submit(start + 1ms, 2, datagram);
+
+        auto none = [](const int&, byte_buffer&) { FAIL("delivered too early"); };
+        CHECK_EQ(link.Deliver(start + 19ms, none), 0);
+
+        std::vector<int> order;
+        link.Deliver(start + 21ms, [&](const int& aFrom, byte_buffer& aData) {
+            CHECK_EQ(aData.size(), 10);
+            order.push_back(aFrom);
+        });
+        CHECK_EQ(order, std::vector<int>{1, 2});
+    }
+
+    SUBCASE("bandwidth cap serializes and tail drops")
+    {
+        TestConditioner link(
+            LinkConditions{.BandwidthBytesPerSec = 1000, .QueueLimitBytes = 500},
+            1);
+
+        const TestConditioner::time_point start{};
+        const byte_buffer                 datagram(100, 0);
+
+        int accepted = 0;
+        for (int i = 0; i < 10; ++i) {
+            accepted += link.Submit(start, i, datagram) ? 1 : 0;
+        }
+        CHECK_EQ(accepted, 5);
+        CHECK_EQ(link.Dropped(), 5);
+
+        // one datagram leaves the link every 100ms
+        auto ignore = [](const int&, byte_buffer&) {};
+        CHECK_EQ(link.Deliver(start + 250ms, ignore), 2);
+        CHECK_EQ(link.Deliver(start + 1s, ignore), 3);
+    }
+}
+
+TEST_CASE("net.token_cache")
+{
+    using namespace std::chrono_literals;
+
+    std::vector<std::pair<std::string, AuthTokenCache::callback_type>> pending;
+    AuthTokenCache cache(
+        [&](const std::string& aToken, AuthTokenCache::callback_type aDone) {
+            pending.emplace_back(aToken, std::move(aDone));
+        },
+        60s);
+
+    std::vector<PlayerID> answered;
+    auto                  record = [&](const AuthTokenCache::result_type& aResult) {
+        answered.push_back(aResult ? aResult->ID : 0);
+    };
+
+    SUBCASE("concurrent requests share one verification")
+    {
+        CHECK_FALSE(cache.Resolve("token", record));
+        CHECK_FALSE(cache.Resolve("token", record));
+        REQUIRE_EQ(pending.size(), 1);
+        CHECK_EQ(cache.Coalesced(), 1);
+
+        pending[0].second(VerifiedToken{.ID = 7, .AccountName = "seven"});
+        CHECK_EQ(answered, std::vector<PlayerID>{7, 7});
+
+        CHECK(cache.Resolve("token", record));
+        CHECK_EQ(answered.size(), 3);
+        CHECK_EQ(cache.Hits(), 1);
+        CHECK_EQ(pending.size(), 1);
+
+        // expired entries go back to the backend
+        CHECK_FALSE(cache.Resolve("token", record, AuthTokenCache::clock_type::now() + 61s));
+        CHECK_EQ(pending.size(), 2);
+    }
+
+    SUBCASE("failures are not cached")
+    {
+        cache.Resolve("bad", record);
+        pending[0].second(std::unexpected(std::string("invalid token")));
+        CHECK_EQ(answered, std::vector<PlayerID>{0});
+
+        CHECK_FALSE(cache.Resolve("bad", record));
+        CHECK_EQ(pending.size(), 2);
+    }
+
+    SUBCASE("expired token claims are not cached")
+    {
+        // {"exp":1}, long past
+        const std::string token = "e30.eyJleHAiOjF9.sig";
+        CHECK_EQ(AuthTokenCache::ExpiryClaim(token), 1);
+
+        cache.Resolve(token, record);
+        pending[0].second(VerifiedToken{.ID = 3, .AccountName = "three"});
+        CHECK_FALSE(cache.Resolve(token, record));
+        CHECK_EQ(pending.size(), 2);
+    }
+
+    CHECK_FALSE(AuthTokenCache::ExpiryClaim("not a token"));
+}
+
+TEST_CASE("net.decode_pool")
+{
+    using namespace std::chrono_literals;
+
+    CryptoKeys clientKeys;
+    CryptoKeys serverKeys;
+
+    constexpr AEADID kCipher = AEADID::XChaCha20Poly1305;
+
+    CryptoSession client;
+    auto*         state = new PeerState{.ID = 9};
+    const auto salt = CryptoSession::MakeSalt();
+    client.Init(clientKeys, serverKeys.RawPublicKey(), kCipher, false, salt);
+    state->SecureSession.Init(serverKeys, clientKeys.RawPublicKey(), kCipher, true, salt);
+
+    DecodePool pool(2, WATO_NAMED_LOGGER("test"));
+
+    constexpr uint32_t kPackets = 100;
+    for (uint32_t tick = 0; tick < kPackets; ++tick) {
+        NetworkRequest req{
+            .Type     = PacketType::ClientInput,
+            .PlayerID = 0,
+            .Tick     = tick,
+            .Payload  = InputPayload{.GameID = 1},
+        };
+        BitOutputArchive archive;
+        REQUIRE(req.Archive(archive));
+
+        PacketBatch batch;
+        batch.Append(archive.Bytes());
+        byte_view   enc    = client.Encrypt(batch.Bytes());
+        ENetPacket* packet = enet_packet_create(enc.data(), enc.size(), 0);
+
+        REQUIRE(pool.Post(DecodeJob{.Packet = packet, .State = state, .ID = state->ID}));
+    }
+    // freed by the worker after the packets above
+    REQUIRE(pool.Post(DecodeJob{.State = state, .ID = 9, .Retire = true}));
+
+    std::vector<NetworkRequest> received;
+    const auto                  deadline = std::chrono::steady_clock::now() + 5s;
+    while (received.size() < kPackets && std::chrono::steady_clock::now() < deadline) {
+        pool.ConsumeRequests([&](NetworkRequest* aReq) { received.push_back(std::move(*aReq)); });
+        std::this_thread::yield();
+    }
+
+    REQUIRE_EQ(received.size(), kPackets);
+    for (uint32_t tick = 0; tick < kPackets; ++tick) {
+        CHECK_EQ(received[tick].Tick, tick);
+        CHECK_EQ(received[tick].PlayerID, 9);
+    }
+    CHECK_EQ(pool.Overflows(), 0);
+}
+
+TEST_CASE("net.handshake_guard")
+{
+    using namespace std::chrono_literals;
+
+    HandshakeGuard guard(2);
+    const auto     now = HandshakeGuard::clock_type::now();
+
+    ENetAddress alice{};
+    ENetAddress bob{};
+    enet_address_set_host(&alice, "10.0.0.1");
+    enet_address_set_host(&bob, "10.0.0.2");
+    alice.port = 4000;
+    bob.port   = 4000;
+
+    SUBCASE("cookies are bound to the address and expire")
+    {
+        const auto cookie = guard.Cookie(alice, now);
+
+        CHECK(guard.CheckCookie(alice, cookie, now));
+        CHECK(guard.CheckCookie(alice, cookie, now + HandshakeGuard::kCookieEpoch));
+        CHECK_FALSE(guard.CheckCookie(alice, cookie, now + 2 * HandshakeGuard::kCookieEpoch));
+        CHECK_FALSE(guard.CheckCookie(bob, cookie, now));
+        CHECK_FALSE(guard.CheckCookie(alice, byte_view(cookie).first(8), now));
+
+        ENetAddress otherPort = alice;
+        otherPort.port        = 4001;
+        CHECK_FALSE(guard.CheckCookie(otherPort, cookie, now));
+
+        // another server secret
+        HandshakeGuard other;
+        CHECK_FALSE(other.CheckCookie(alice, cookie, now));
+    }
+
+    SUBCASE("token buckets are per address and refill")
+    {
+        for (int i = 0; i < int(HandshakeGuard::kBurst); ++i) {
+            CHECK(guard.Allow(alice, now));
+        }
+        CHECK_FALSE(guard.Allow(alice, now));
+        CHECK(guard.Allow(bob, now));
+
+        CHECK(guard.Allow(alice, now + 1s));
+        CHECK_EQ(guard.Buckets(), 2);
+
+        guard.Prune(now + 1h);
+        CHECK_EQ(guard.Buckets(), 0);
+    }
+
+    SUBCASE("pending handshakes are capped")
+    {
+        CHECK(guard.BeginPending());
+        CHECK(guard.BeginPending());
+        CHECK_FALSE(guard.BeginPending());
+        guard.EndPending();
+        CHECK(guard.BeginPending());
+        CHECK_EQ(guard.Pending(), 2);
+    }
+
+    guard.Count(HandshakeDrop::BadCookie);
+    guard.Count(HandshakeDrop::BadCookie);
+    HandshakeDrops drops = guard.Drops();
+    CHECK_EQ(drops[HandshakeDrop::BadCookie], 2);
+    CHECK_EQ(drops[HandshakeDrop::RateLimited], 0);
+
+    drops += guard.Drops();
+    CHECK_EQ(drops[HandshakeDrop::BadCookie], 4);
+}
+
+TEST_CASE("net.snapshot_delta")
+{
+    auto state = [](std::uint32_t aEntity, float aX, float aHealth) {
+        return EntityState{
+            .Entity    = entt::entity{aEntity},
+            .Position  = glm::vec3(aX, 0.0f, 1.0f),
+            .Direction = glm::vec3(1.0f, 0.0f, 0.0f),
+            .Velocity  = 2.0f,
+            .Health    = aHealth,
+        };
+    };
+
+    StateSnapshot base{.Tick = 10, .Entities = {state(1, 0.0f, 50.0f), state(3, 4.0f, 20.0f)}};
+    // 1 moved, 3 is gone and 4 is new
+    StateSnapshot current{.Tick = 12, .Entities = {state(1, 0.5f, 50.0f), state(4, 8.0f, 30.0f)}};
+
+    SUBCASE("full snapshot without a baseline")
+    {
+        SnapshotResponse full = DiffSnapshots(nullptr, current);
+        CHECK_FALSE(full.Delta);
+        CHECK(full.Removed.empty());
+        REQUIRE_EQ(full.Changed.size(), 2);
+        CHECK_EQ(full.Changed[0].Fields, EntityDelta::All);
+
+        StateSnapshot out;
+        REQUIRE(ApplySnapshotDelta(nullptr, full, out));
+        CHECK_EQ(out.Tick, 12);
+        CHECK_EQ(out.Entities, current.Entities);
+    }
+
+    SUBCASE("delta against an acknowledged snapshot")
+    {
+        SnapshotResponse delta = DiffSnapshots(&base, current);
+        CHECK(delta.Delta);
+        CHECK_EQ(delta.BaseTick, 10);
+        REQUIRE_EQ(delta.Removed.size(), 1);
+        CHECK_EQ(delta.Removed[0], entt::entity{3});
+        REQUIRE_EQ(delta.Changed.size(), 2);
+        CHECK_EQ(delta.Changed[0].Fields, EntityDelta::Position);
+        CHECK_EQ(delta.Changed[1].Fields, EntityDelta::All);
+
+        BitOutputArchive outAr;
+        REQUIRE(delta.Archive(outAr));
+        BitInputArchive  inAr(outAr.Data());
+        SnapshotResponse decoded;
+        REQUIRE(decoded.Archive(inAr));
+        CHECK_EQ(decoded.Removed, delta.Removed);
+        REQUIRE_EQ(decoded.Changed.size(), 2);
+        CHECK_EQ(decoded.Changed[0].State.Position, current.Entities[0].Position);
+
+        StateSnapshot out;
+        REQUIRE(ApplySnapshotDelta(&base, decoded, out));
+        CHECK_EQ(out.Entities, current.Entities);
+
+        // unchanged state costs nothing
+        CHECK(DiffSnapshots(&current, current).Changed.empty());
+
+        // the client must decode against the baseline the server used
+        StateSnapshot other{.Tick = 8};
+        CHECK_FALSE(ApplySnapshotDelta(&other, decoded, out));
+        CHECK_FALSE(ApplySnapshotDelta(nullptr, decoded, out));
+    }
+
+    SUBCASE("history keeps the latest snapshots")
+    {
+        SnapshotHistory history;
+        for (std::uint32_t tick = 0; tick < SnapshotHistory::kCapacity + 2; ++tick) {
+            StateSnapshot snapshot{.Tick = tick};
+            history.Push(snapshot);
+        }
+        CHECK_EQ(history.Size(), SnapshotHistory::kCapacity);
+        CHECK_FALSE(history.Find(1));
+        REQUIRE(history.Find(2));
+        CHECK_EQ(history.Find(2)->Tick, 2);
+        CHECK(history.Find(SnapshotHistory::kCapacity + 1));
+    }
+}
+
+TEST_CASE("net.interest")
+{
+    PlayerInterest alice{.Map = ViewRegion{.Min = glm::vec2(0.0f), .Max = glm::vec2(20.0f)}};
+    PlayerInterest bob{
+        .Map = ViewRegion{.Min = glm::vec2(25.0f, 0.0f), .Max = glm::vec2(45.0f, 20.0f)},
+    };
+
+    const glm::vec3 onAlice(5.0f, 0.0f, 5.0f);
+    const glm::vec3 onBob(30.0f, 0.0f, 5.0f);
+
+    CHECK(alice.Relevant(onAlice));
+    CHECK_FALSE(alice.Relevant(onBob));
+
+    // looking at bob's map, the margin included
+    alice.Camera = ViewRegion{.Min = glm::vec2(32.0f, 0.0f), .Max = glm::vec2(40.0f, 10.0f)};
+    CHECK(alice.Relevant(onBob));
+    CHECK(alice.Relevant(onAlice));
+    CHECK_FALSE(alice.Relevant(glm::vec3(44.5f, 0.0f, 5.0f)));
+
+    InterestMap interest;
+    interest.Players.emplace(1, alice);
+    interest.Players.emplace(2, bob);
+    const std::vector<PlayerID> all{1, 2, 3};
+    CHECK_EQ(interest.Interested(all, onBob), std::vector<PlayerID>{1, 2, 3});
+    CHECK_EQ(interest.Interested(all, onAlice), std::vector<PlayerID>{1, 3});
+
+    SUBCASE("destroys go to the players sent the create")
+    {
+        const auto projectile = entt::entity{7};
+
+        // created for everyone, nothing to remember
+        CHECK_EQ(interest.CreateRecipients(projectile, all, onBob), all);
+        CHECK(interest.Recipients.empty());
+        CHECK_EQ(interest.DestroyRecipients(projectile, all), all);
+
+        CHECK_EQ(interest.CreateRecipients(projectile, all, onAlice), std::vector<PlayerID>{1, 3});
+        // the camera moved away since, the destroy still matches the create
+        interest.Players.at(1).Camera.reset();
+        CHECK_EQ(interest.DestroyRecipients(projectile, all), std::vector<PlayerID>{1, 3});
+        CHECK(interest.Recipients.empty());
+    }
+
+    SUBCASE("distant entities keep their acknowledged state between refreshes")
+    {
+        auto state = [](std::uint32_t aEntity, glm::vec3 aPos) {
+            return EntityState{.Entity = entt::entity{aEntity}, .Position = aPos};
+        };
+        const glm::vec3 step(0.5f, 0.0f, 0.0f);
+
+        const StateSnapshot base{.Tick = 10, .Entities = {state(1, onBob), state(2, onAlice)}};
+        const StateSnapshot world{
+            .Tick     = 12,
+            .Entities = {state(1, onBob + step), state(2, onAlice + step), state(3, onAlice)},
+        };
+
+        StateSnapshot out;
+        FilterSnapshot(bob, &base, world, 1, out);
+        CHECK_EQ(out.Tick, 12);
+        // entity 3 is unknown to the player and not relevant, left out
+        REQUIRE_EQ(out.Entities.size(), 2);
+        CHECK_EQ(out.Entities[0], world.Entities[0]);
+        CHECK_EQ(out.Entities[1], base.Entities[1]);
+
+        // entity 2 is refreshed once every kDistantInterval rounds
+        FilterSnapshot(bob, &base, world, InterestMap::kDistantInterval - 2, out);
+        REQUIRE_EQ(out.Entities.size(), 2);
+        CHECK_EQ(out.Entities[1], world.Entities[1]);
+
+        // and entity 3 first goes on its own round
+        FilterSnapshot(bob, &base, world, InterestMap::kDistantInterval - 3, out);
+        REQUIRE_EQ(out.Entities.size(), 3);
+        CHECK_EQ(out.Entities[1], base.Entities[1]);
+        CHECK_EQ(out.Entities[2], world.Entities[2]);
+
+        // without a baseline only the relevant entities go
+        FilterSnapshot(bob, nullptr, world, 1, out);
+        CHECK_EQ(out.Entities, std::vector<EntityState>{world.Entities[0]});
+
+        // the delta only carries what changed for this player
+        FilterSnapshot(bob, &base, world, 1, out);
+        CHECK_EQ(DiffSnapshots(&base, out).Changed.size(), 1);
+    }
+}
+
+TEST_CASE("net.interpolation")
+{
+    SUBCASE("buffer blends between the samples around a tick")
+    {
+        InterpolationBuffer buffer;
+        CHECK_FALSE(buffer.At(10.0f));
+
+        buffer.Push(10, glm::vec3(0.0f));
+        buffer.Push(14, glm::vec3(4.0f, 0.0f, 0.0f));
+        buffer.Push(18, glm::vec3(4.0f, 0.0f, 8.0f));
+        // late, dropped
+        buffer.Push(12, glm::vec3(100.0f));
+
+        CHECK_EQ(*buffer.At(5.0f), glm::vec3(0.0f));
+        CHECK_EQ(*buffer.At(11.0f), glm::vec3(1.0f, 0.0f, 0.0f));
+        CHECK_EQ(*buffer.At(16.0f), glm::vec3(4.0f, 0.0f, 4.0f));
+        // no extrapolation past the newest sample
+        CHECK_EQ(*buffer.At(40.0f), glm::vec3(4.0f, 0.0f, 8.0f));
+
+        for (std::uint32_t tick = 21; tick < 21 + 3 * InterpolationBuffer::kCapacity; tick += 3) {
+            buffer.Push(tick, glm::vec3(float(tick)));
+        }
+        CHECK_EQ(buffer.Count, InterpolationBuffer::kCapacity);
+        CHECK_EQ(*buffer.At(0.0f), glm::vec3(21.0f));
+    }
+
+    SUBCASE("clock trails the newest snapshot")
+    {
+        InterpolationClock clock;
+        clock.Advance(10.0f);
+        CHECK_FALSE(clock.Started);
+
+        clock.OnSnapshot(100);
+        CHECK(clock.Started);
+        CHECK_EQ(clock.Tick, doctest::Approx(100.0f - InterpolationClock::kDelaySnapshots));
+
+        clock.OnSnapshot(103);
+        CHECK_EQ(clock.Interval, 3);
+        clock.Advance(3.0f);
+        CHECK_LT(clock.Tick, 103.0f);
+
+        // never ahead of what was received
+        clock.Advance(100.0f);
+        CHECK_EQ(clock.Tick, doctest::Approx(103.0f));
+
+        // far behind after an outage, jumps
+        clock.OnSnapshot(1000);
+        CHECK_EQ(clock.Interval, 3);
+        CHECK_EQ(clock.Tick, doctest::Approx(994.0f));
+    }
+}
+
+TEST_CASE("net.entity_sync_map")
+{
+    using Traits = entt::entt_traits<entt::entity>;
+
+    EntitySyncMap      map;
+    const entt::entity server = Traits::construct(12, 0);
+    const entt::entity local  = Traits::construct(3, 0);
+
+    CHECK(map.Find(server) == entt::null);
+    map.Insert(server, local);
+    CHECK(map.Find(server) == local);
+    CHECK_EQ(map.Size(), 1);
+
+    // the index recycled by the server, the old version is gone
+    const entt::entity recycled = Traits::construct(12, 1);
+    CHECK(map.Find(recycled) == entt::null);
+
+    map.Insert(recycled, Traits::construct(4, 0));
+    CHECK_EQ(map.Size(), 1);
+    CHECK(map.Find(server) == entt::null);
+    CHECK(map.Erase(recycled) == Traits::construct(4, 0));
+    CHECK_EQ(map.Size(), 0);
+    CHECK(map.Erase(recycled) == entt::null);
+}
@@ -50,3 +50,20 @@ TEST_CASE("ring_buffer.round_trip")
         rb.Push();
     }
 }
+
+TEST_CASE("ring_buffer.from_latest")
+{
+    RingBuffer<uint32_t, 8> rb;
+
+    CHECK(!rb.FromLatest(1));
+    for (uint32_t i = 0; i < rb.kCapacity + 3; ++i) {
+        rb.Latest() = i;
+        rb.Push();
+    }
+    rb.Latest() = 100;
+
+    CHECK_EQ(*rb.FromLatest(0), 100);
+    CHECK_EQ(*rb.FromLatest(1), rb.kCapacity + 2);
+    CHECK_EQ(*rb.FromLatest(3), rb.kCapacity);
+    CHECK_EQ(rb.FromLatest(rb.kCapacity), rb.FromLatest(0));
+}
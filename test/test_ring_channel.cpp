@@ -0,0 +1,62 @@
+#include <doctest.h>
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <core/queue/ring_channel.hpp>
+
+TEST_CASE("ring_channel.spsc")
+{
+    SpscRingChannel<std::string, 4> chan;
+
+    for (int i = 0; i < 4; ++i) {
+        CHECK(chan.TrySend(std::to_string(i)));
+    }
+    CHECK_EQ(chan.Size(), 4);
+
+    // full: explicit backpressure
+    CHECK_FALSE(chan.TrySend("overflow"));
+    CHECK_EQ(chan.Overflows(), 1);
+
+    std::vector<std::string> received;
+    CHECK_EQ(chan.Drain([&](std::string* aMsg) { received.push_back(*aMsg); }), 4);
+    CHECK_EQ(received, std::vector<std::string>{"0", "1", "2", "3"});
+    CHECK_EQ(chan.Size(), 0);
+
+    // slots are reused once drained
+    CHECK(chan.TrySend("again"));
+    CHECK_EQ(chan.Drain([](std::string*) {}), 1);
+}
+
+TEST_CASE("ring_channel.mpsc")
+{
+    constexpr int kProducers = 4;
+    constexpr int kMessages  = 10000;
+
+    static MpscRingChannel<int, 256> chan;
+
+    std::vector<std::thread> producers;
+    for (int p = 0; p < kProducers; ++p) {
+        producers.emplace_back([]() {
+            for (int i = 1; i <= kMessages; ++i) {
+                while (!chan.TrySend(i)) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+
+    std::size_t received = 0;
+    long long   sum      = 0;
+    while (received < std::size_t(kProducers * kMessages)) {
+        received += chan.Drain([&](int* aMsg) { sum += *aMsg; });
+    }
+
+    for (auto& t : producers) {
+        t.join();
+    }
+
+    CHECK_EQ(sum, kProducers * (static_cast<long long>(kMessages) * (kMessages + 1) / 2));
+    CHECK_EQ(chan.Size(), 0);
+}
@@ -33,6 +33,24 @@ TEST_CASE("bitbuffer.multiple")
     CHECK_EQ(out, values);
 }
 
+TEST_CASE("bitbuffer.clear")
+{
+    BitWriter buf;
+    buf.Write(uint32_t(0xffff), 16);
+    buf.Data();
+    // a partial word left in the scratch must not leak into the next message
+    buf.Write(uint32_t(0b111), 3);
+
+    buf.Clear();
+    buf.Write(uint32_t(0b10), 2);
+    CHECK_EQ(buf.Data().size(), 1);
+
+    BitReader reader(buf.Data());
+    uint32_t  r = 0;
+    CHECK(reader.Read(r, 2));
+    CHECK_EQ(r, 0b10);
+}
+
 TEST_CASE("bitbuffer.edge_cases")
 {
     BitWriter buf;
@@ -0,0 +1,77 @@
+#include <doctest.h>
+
+#include "components/creep.hpp"
+#include "components/health.hpp"
+#include "components/player.hpp"
+#include "components/rigid_body.hpp"
+#include "components/tower.hpp"
+#include "components/transform3d.hpp"
+#include "core/state_hash.hpp"
+#include "registry/registry.hpp"
+
+static entt::entity spawnCreep(Registry& aRegistry, const glm::vec3& aPos, float aHealth)
+{
+    auto creep = aRegistry.create();
+    aRegistry.emplace<Creep>(creep, CreepType::Simple, 1.0f);
+    aRegistry.emplace<Owner>(creep, PlayerID(4), uint8_t(1));
+    aRegistry.emplace<Health>(creep, aHealth);
+    aRegistry.emplace<RigidBody>(creep);
+    aRegistry.emplace<Transform3D>(creep, aPos);
+    return creep;
+}
+
+TEST_CASE("state_hash.incremental")
+{
+    Registry reg;
+    auto&    hash = reg.ctx().emplace<StateHash>();
+    hash.Watch(reg);
+    CHECK_EQ(hash.Value(), 0U);
+
+    auto player = reg.create();
+    reg.emplace<Gold>(player, 100);
+    auto a = spawnCreep(reg, glm::vec3(1.0f, 0.0f, 2.0f), 10.0f);
+    spawnCreep(reg, glm::vec3(3.0f, 0.0f, 4.0f), 5.0f);
+    const auto before = hash.Value();
+
+    SUBCASE("same as watching from scratch")
+    {
+        StateHash fresh;
+        fresh.Watch(reg);
+        CHECK_EQ(fresh.Value(), before);
+        fresh.Unwatch(reg);
+    }
+
+    SUBCASE("ids and creation order do not matter")
+    {
+        Registry other;
+        other.create();
+        auto& otherHash = other.ctx().emplace<StateHash>();
+        otherHash.Watch(other);
+        spawnCreep(other, glm::vec3(3.0f, 0.0f, 4.0f), 5.0f);
+        spawnCreep(other, glm::vec3(1.0f, 0.0f, 2.0f), 10.0f);
+        other.emplace<Gold>(other.create(), 100);
+        CHECK_EQ(otherHash.Value(), before);
+    }
+
+    SUBCASE("changes are followed and undone")
+    {
+        reg.patch<Health>(a, [](Health& aHealth) { aHealth.Health = 7.0f; });
+        CHECK_NE(hash.Value(), before);
+        reg.patch<Health>(a, [](Health& aHealth) { aHealth.Health = 10.0f; });
+        CHECK_EQ(hash.Value(), before);
+
+        auto b = spawnCreep(reg, glm::vec3(5.0f, 0.0f, 6.0f), 10.0f);
+        CHECK_NE(hash.Value(), before);
+        reg.destroy(b);
+        CHECK_EQ(hash.Value(), before);
+    }
+
+    SUBCASE("transforms without a body are not gameplay")
+    {
+        reg.emplace<Transform3D>(reg.create(), glm::vec3(8.0f));
+        CHECK_EQ(hash.Value(), before);
+    }
+
+    hash.Unwatch(reg);
+    CHECK_EQ(hash.Value(), 0U);
+}